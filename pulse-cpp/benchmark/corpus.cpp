@@ -0,0 +1,67 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "notation.h"
+#include "movegenerator.h"
+
+#include <array>
+
+namespace pulse::corpus {
+
+namespace {
+
+constexpr std::array<const char*, 12> FENS = {
+		notation::STANDARDPOSITION,
+		"r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+		"rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"2r2rk1/pp1bqpp1/2n1pn1p/3p4/3P4/2PBPN2/PP1Q1PPP/R3R1K1 w - - 2 15",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"6k1/5pp1/4p2p/8/3P4/4P1P1/5PKP/8 w - - 0 40",
+		"8/8/4k3/3n4/8/2B5/4K3/8 w - - 0 60",
+		"4r1k1/1q3ppp/p7/1p1Qp3/4P3/1P3P2/P5PP/3R2K1 b - - 3 28"
+};
+}
+
+std::vector<Position> getPositions() {
+	std::vector<Position> positions;
+	for (auto fen: FENS) {
+		positions.push_back(notation::toPosition(fen));
+	}
+	return positions;
+}
+
+Position getRepetitionPosition() {
+	Position position = notation::toPosition(notation::STANDARDPOSITION);
+
+	// Shuffle the knights back and forth. Finally leave the cycle, so the
+	// check finds nothing and has to look through the whole history.
+	std::vector<std::string> notations;
+	const std::array<const char*, 4> shuffle = {"g1f3", "g8f6", "f3g1", "f6g8"};
+	for (int i = 0; i < 48; i++) {
+		notations.emplace_back(shuffle[i % shuffle.size()]);
+	}
+	notations.emplace_back("b1c3");
+
+	MoveGenerator moveGenerator;
+	for (auto& notation: notations) {
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		for (int j = 0; j < moves.size; j++) {
+			int move = moves.entries[j]->move;
+			if (notation::fromSquare(move::getOriginSquare(move)) + notation::fromSquare(move::getTargetSquare(move))
+				== notation) {
+				position.makeMove(move);
+				break;
+			}
+		}
+	}
+
+	return position;
+}
+}
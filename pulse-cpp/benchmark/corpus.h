@@ -0,0 +1,24 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "position.h"
+
+#include <vector>
+
+namespace pulse::corpus {
+
+/**
+ * Returns positions from all phases of the game, so a benchmark does not
+ * only measure the opening.
+ */
+std::vector<Position> getPositions();
+
+/**
+ * Returns a position with a long history of reversible moves, so
+ * repetition checks have to look back.
+ */
+Position getRepetitionPosition();
+}
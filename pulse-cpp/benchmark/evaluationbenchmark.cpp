@@ -0,0 +1,24 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "evaluation.h"
+
+#include "benchmark/benchmark.h"
+
+using namespace pulse;
+
+static void evaluate(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+
+	for (auto _: state) {
+		for (auto& position: positions) {
+			benchmark::DoNotOptimize(evaluation::evaluate(position));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+BENCHMARK(evaluate);
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+# Copyright 2013-2023 Phokham Nonava
+#
+# Use of this source code is governed by the MIT license that can be
+# found in the LICENSE file.
+
+"""Drives the engine over pipes and measures how fast it reacts to UCI
+commands. Every repetition plays the same script:
+
+    go infinite  -> first info     (go)
+    isready      -> readyok        (isready, while searching)
+    stop         -> bestmove       (stop)
+    go ponder    -> ...
+    ponderhit    -> timer started  (ponderhit)
+    stop         -> bestmove       (ponderstop)
+
+and prints percentiles in milliseconds. With --limit the script fails if the
+99th percentile of a latency is above the limit.
+
+Exit codes: 0 passed, 1 limit exceeded, 2 the engine misbehaved."""
+
+import argparse
+import queue
+import subprocess
+import sys
+import threading
+import time
+
+PERCENTILES = (50, 90, 99, 99.9)
+TIMEOUT = 10
+
+# The first lines a search sends. Other info lines, like the statistics
+# string, don't tell us that the search is running.
+SEARCH_INFO = ("info depth", "info currmove")
+
+
+class Engine:
+    """Runs the engine and timestamps every line it writes as soon as we can
+    read it."""
+
+    def __init__(self, pulse, options):
+        self.process = subprocess.Popen([pulse], stdin=subprocess.PIPE, stdout=subprocess.PIPE, bufsize=0)
+        self.lines = queue.Queue()
+        self.reader = threading.Thread(target=self.read, daemon=True)
+        self.reader.start()
+
+        self.send("uci")
+        self.expect("uciok")
+        for name, value in options:
+            self.send("setoption name %s value %s" % (name, value))
+        self.send("debug on")
+        self.send("isready")
+        self.expect("readyok")
+
+    def read(self):
+        for line in self.process.stdout:
+            self.lines.put((time.perf_counter_ns(), line.decode().strip()))
+        self.lines.put((time.perf_counter_ns(), None))
+
+    def send(self, command):
+        """Sends a command and returns the time it was written."""
+        self.process.stdin.write((command + "\n").encode())
+        self.process.stdin.flush()
+        return time.perf_counter_ns()
+
+    def drain(self):
+        """Drops the lines we have read so far, so a late line of an earlier
+        command is not taken for the answer to the next one."""
+        while True:
+            try:
+                _, line = self.lines.get_nowait()
+            except queue.Empty:
+                return
+            if line is None:
+                raise RuntimeError("engine exited")
+
+    def expect(self, prefix):
+        """Returns the time of the next line starting with prefix, or with one
+        of the prefixes of a tuple."""
+        deadline = time.monotonic() + TIMEOUT
+        while True:
+            try:
+                timestamp, line = self.lines.get(timeout=max(0.0, deadline - time.monotonic()))
+            except queue.Empty:
+                raise RuntimeError("no answer starting with %r within %d s" % (prefix, TIMEOUT))
+            if line is None:
+                raise RuntimeError("engine exited while waiting for %r" % (prefix,))
+            if line.startswith(prefix):
+                return timestamp
+
+    def close(self):
+        self.send("quit")
+        self.process.wait(timeout=TIMEOUT)
+
+
+def measure(engine, arguments, samples):
+    engine.send("position startpos")
+
+    engine.drain()
+    sent = engine.send("go infinite")
+    samples["go"].append(engine.expect(SEARCH_INFO) - sent)
+
+    engine.drain()
+    sent = engine.send("isready")
+    samples["isready"].append(engine.expect("readyok") - sent)
+
+    time.sleep(arguments.think / 1000)
+    engine.drain()
+    sent = engine.send("stop")
+    samples["stop"].append(engine.expect("bestmove") - sent)
+
+    # Make the clock long enough that the timer does not run out before we
+    # send stop.
+    engine.send("position startpos moves e2e4")
+    engine.drain()
+    engine.send("go ponder wtime 600000 btime 600000")
+    engine.expect(SEARCH_INFO)
+    engine.drain()
+    sent = engine.send("ponderhit")
+    samples["ponderhit"].append(engine.expect("info string ponderhit") - sent)
+
+    time.sleep(arguments.think / 1000)
+    engine.drain()
+    sent = engine.send("stop")
+    samples["ponderstop"].append(engine.expect("bestmove") - sent)
+
+
+def percentile(samples, rank):
+    ordered = sorted(samples)
+    index = min(len(ordered) - 1, max(0, int(round(rank / 100 * len(ordered) + 0.5)) - 1))
+    return ordered[index]
+
+
+def report(samples):
+    print("%-12s %8s" % ("latency", "samples") + "".join(" %9s" % ("p%g" % rank) for rank in PERCENTILES)
+          + " %9s" % "max")
+    for name, values in samples.items():
+        print("%-12s %8d" % (name, len(values))
+              + "".join(" %9.3f" % (percentile(values, rank) / 1e6) for rank in PERCENTILES)
+              + " %9.3f" % (max(values) / 1e6))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--pulse", required=True, help="the engine executable")
+    parser.add_argument("--repetitions", type=int, default=1000)
+    parser.add_argument("--think", type=float, default=0, help="milliseconds to search before stop")
+    parser.add_argument("--option", action="append", default=[], metavar="NAME=VALUE",
+                        help="UCI option to set, e.g. Hash=64")
+    parser.add_argument("--limit", action="append", default=[], metavar="LATENCY=MS",
+                        help="fail if the 99th percentile is above, e.g. stop=20")
+    arguments = parser.parse_args()
+
+    options = [option.split("=", 1) for option in arguments.option]
+    limits = {name: float(value) for name, value in (limit.split("=", 1) for limit in arguments.limit)}
+
+    samples = {name: [] for name in ("go", "isready", "stop", "ponderhit", "ponderstop")}
+    engine = Engine(arguments.pulse, options)
+    try:
+        for _ in range(arguments.repetitions):
+            measure(engine, arguments, samples)
+        engine.close()
+    except RuntimeError as error:
+        engine.process.kill()
+        print("failed: %s" % error)
+        return 2
+
+    report(samples)
+
+    exceeded = [name for name, limit in limits.items() if percentile(samples[name], 99) / 1e6 > limit]
+    if exceeded:
+        print("failed: %s above the limit" % ", ".join(exceeded))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,56 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "movegenerator.h"
+
+#include "benchmark/benchmark.h"
+
+using namespace pulse;
+
+static void getMoves(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+	MoveGenerator moveGenerator;
+
+	int64_t count = 0;
+	for (auto _: state) {
+		for (auto& position: positions) {
+			count += moveGenerator.getMoves(position, 1, position.isCheck()).size;
+		}
+	}
+	state.SetItemsProcessed(count);
+}
+
+BENCHMARK(getMoves);
+
+static void getLegalMoves(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+	MoveGenerator moveGenerator;
+
+	int64_t count = 0;
+	for (auto _: state) {
+		for (auto& position: positions) {
+			count += moveGenerator.getLegalMoves(position, 1, position.isCheck()).size;
+		}
+	}
+	state.SetItemsProcessed(count);
+}
+
+BENCHMARK(getLegalMoves);
+
+static void getQuiescentMoves(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+	MoveGenerator moveGenerator;
+
+	int64_t count = 0;
+	for (auto _: state) {
+		for (auto& position: positions) {
+			count += moveGenerator.getMoves(position, 0, position.isCheck()).size;
+		}
+	}
+	state.SetItemsProcessed(count);
+}
+
+BENCHMARK(getQuiescentMoves);
@@ -0,0 +1,49 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "movegenerator.h"
+
+#include "benchmark/benchmark.h"
+
+using namespace pulse;
+
+/**
+ * Sorts the moves of every position after rating them by MVV/LVA. Rating is
+ * part of the measurement, as it also restores the unsorted order.
+ */
+static void sort(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+	std::vector<MoveGenerator> moveGenerators(positions.size());
+	std::vector<MoveList<MoveEntry>*> moveLists;
+	for (unsigned int i = 0; i < positions.size(); i++) {
+		moveLists.push_back(&moveGenerators[i].getMoves(positions[i], 1, positions[i].isCheck()));
+	}
+
+	// Keep the generated order, so every iteration sorts the same input
+	std::vector<std::vector<int>> moves;
+	for (auto moveList: moveLists) {
+		moves.emplace_back();
+		for (int i = 0; i < moveList->size; i++) {
+			moves.back().push_back(moveList->entries[i]->move);
+		}
+	}
+
+	int64_t count = 0;
+	for (auto _: state) {
+		for (unsigned int i = 0; i < moveLists.size(); i++) {
+			MoveList<MoveEntry>& moveList = *moveLists[i];
+			for (int j = 0; j < moveList.size; j++) {
+				moveList.entries[j]->move = moves[i][j];
+			}
+			moveList.rateFromMVVLVA();
+			moveList.sort();
+			count += moveList.size;
+		}
+	}
+	state.SetItemsProcessed(count);
+}
+
+BENCHMARK(sort);
@@ -0,0 +1,27 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "notation.h"
+
+#include "benchmark/benchmark.h"
+
+using namespace pulse;
+
+static void toPosition(benchmark::State& state) {
+	std::vector<std::string> fens;
+	for (auto& position: corpus::getPositions()) {
+		fens.push_back(notation::fromPosition(position));
+	}
+
+	for (auto _: state) {
+		for (auto& fen: fens) {
+			benchmark::DoNotOptimize(notation::toPosition(fen));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * fens.size());
+}
+
+BENCHMARK(toPosition);
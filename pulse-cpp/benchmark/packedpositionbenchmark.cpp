@@ -0,0 +1,40 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "packedposition.h"
+
+#include "benchmark/benchmark.h"
+
+using namespace pulse;
+
+static void pack(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+
+	for (auto _: state) {
+		for (auto& position: positions) {
+			benchmark::DoNotOptimize(PackedPosition::pack(position));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * positions.size());
+}
+
+BENCHMARK(pack);
+
+static void unpack(benchmark::State& state) {
+	std::vector<PackedPosition> packedPositions;
+	for (auto& position: corpus::getPositions()) {
+		packedPositions.push_back(PackedPosition::pack(position));
+	}
+
+	for (auto _: state) {
+		for (auto& packedPosition: packedPositions) {
+			benchmark::DoNotOptimize(packedPosition.unpack());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * packedPositions.size());
+}
+
+BENCHMARK(unpack);
@@ -0,0 +1,66 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "corpus.h"
+#include "movegenerator.h"
+
+#include "benchmark/benchmark.h"
+
+using namespace pulse;
+
+static void makeMoveUndoMove(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+	std::vector<std::vector<int>> moves;
+	MoveGenerator moveGenerator;
+	for (auto& position: positions) {
+		MoveList<MoveEntry>& legalMoves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		moves.emplace_back();
+		for (int i = 0; i < legalMoves.size; i++) {
+			moves.back().push_back(legalMoves.entries[i]->move);
+		}
+	}
+
+	int64_t count = 0;
+	for (auto _: state) {
+		for (unsigned int i = 0; i < positions.size(); i++) {
+			for (auto move: moves[i]) {
+				positions[i].makeMove(move);
+				positions[i].undoMove(move);
+			}
+			count += moves[i].size();
+		}
+	}
+	state.SetItemsProcessed(count);
+}
+
+BENCHMARK(makeMoveUndoMove);
+
+static void isAttacked(benchmark::State& state) {
+	std::vector<Position> positions = corpus::getPositions();
+
+	int64_t count = 0;
+	for (auto _: state) {
+		for (auto& position: positions) {
+			for (auto square: square::values) {
+				benchmark::DoNotOptimize(position.isAttacked(square, position.activeColor));
+			}
+			count += square::VALUES_SIZE;
+		}
+	}
+	state.SetItemsProcessed(count);
+}
+
+BENCHMARK(isAttacked);
+
+static void isRepetition(benchmark::State& state) {
+	Position position = corpus::getRepetitionPosition();
+
+	for (auto _: state) {
+		benchmark::DoNotOptimize(position.isRepetition());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(isRepetition);
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+# Copyright 2013-2023 Phokham Nonava
+#
+# Use of this source code is governed by the MIT license that can be
+# found in the LICENSE file.
+
+"""Runs bench, perft and the microbenchmarks several times and compares the
+best runs with the baseline of this machine class. The best run is the one
+least disturbed by other processes. Suspected regressions are measured once
+more before we fail.
+
+Exit codes: 0 passed, 1 regression, 77 skipped (no baseline or not a
+Release build)."""
+
+import argparse
+import json
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+
+SKIPPED = 77
+
+
+def machine_class():
+    model = platform.processor() or platform.machine()
+    try:
+        with open("/proc/cpuinfo") as cpuinfo:
+            for line in cpuinfo:
+                if line.startswith("model name"):
+                    model = line.split(":", 1)[1]
+                    break
+    except OSError:
+        pass
+    model = re.sub(r"[^a-z0-9]+", "-", model.lower()).strip("-")
+    return "%s-%s-%dcpu" % (platform.system().lower(), model, os.cpu_count())
+
+
+def run_engine(pulse, mode, depth):
+    """Returns nodes and nodes per millisecond of one bench or perft run."""
+    output = subprocess.run([pulse, mode, str(depth)], check=True, capture_output=True, text=True).stdout
+    nodes = int(re.search(r"^Nodes: (\d+)", output, re.M).group(1))
+    speed = int(re.search(r"^n/ms: (\d+)", output, re.M).group(1))
+    return nodes, speed
+
+
+def run_microbenchmarks(microbenchmark, repetitions):
+    """Returns the CPU time in nanoseconds per iteration of every repetition."""
+    output = subprocess.run([microbenchmark,
+                             "--benchmark_format=json",
+                             "--benchmark_repetitions=%d" % repetitions,
+                             "--benchmark_min_time=0.2"],
+                            check=True, capture_output=True, text=True).stdout
+    samples = {}
+    for benchmark in json.loads(output)["benchmarks"]:
+        if benchmark.get("run_type", "iteration") != "iteration":
+            continue
+        scale = {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}[benchmark["time_unit"]]
+        samples.setdefault(benchmark["run_name"], []).append(benchmark["cpu_time"] * scale)
+    return samples
+
+
+def summarize(samples, unit, higher_is_better):
+    median = statistics.median(samples)
+    deviation = statistics.median([abs(sample - median) for sample in samples])
+    best = max(samples) if higher_is_better else min(samples)
+    return {"best": best, "median": median, "mad": deviation, "unit": unit, "higher_is_better": higher_is_better,
+            "samples": samples}
+
+
+def merge(first, second):
+    """Combines two measurements of the same thing."""
+    return summarize(first["samples"] + second["samples"], first["unit"], first["higher_is_better"])
+
+
+def measure(arguments):
+    results = {}
+    signatures = {}
+
+    for mode, depth in (("bench", arguments.bench_depth), ("perft", arguments.perft_depth)):
+        samples = []
+        for _ in range(arguments.repetitions):
+            nodes, speed = run_engine(arguments.pulse, mode, depth)
+            samples.append(speed)
+            signatures[mode] = nodes
+        results[mode] = summarize(samples, "n/ms", True)
+
+    if arguments.microbenchmark:
+        for name, samples in run_microbenchmarks(arguments.microbenchmark, arguments.repetitions).items():
+            results[name] = summarize(samples, "ns", False)
+
+    return results, signatures
+
+
+def compare(results, signatures, baseline, threshold):
+    """Returns the names of all measurements which got significantly slower."""
+    regressions = []
+
+    for mode, nodes in signatures.items():
+        expected = baseline.get("signatures", {}).get(mode)
+        if expected is not None and expected != nodes:
+            print("note: %s searched %d nodes instead of %d, the search has changed" % (mode, nodes, expected))
+
+    print("%-24s %14s %14s %8s" % ("measurement", "baseline", "current", "change"))
+    for name, result in sorted(results.items()):
+        reference = baseline["results"].get(name)
+        if reference is None:
+            print("%-24s %14s %14.1f %8s" % (name, "-", result["best"], "new"))
+            continue
+
+        if result["higher_is_better"]:
+            change = result["best"] / reference["best"] - 1
+        else:
+            change = reference["best"] / result["best"] - 1
+
+        # Don't fail on noise. The allowed slowdown is at least the threshold
+        # and at least three deviations of either measurement.
+        noise = 3 * max(result["mad"] / result["median"], reference["mad"] / reference["median"])
+        tolerance = max(threshold, noise)
+
+        verdict = ""
+        if change < -tolerance:
+            verdict = "REGRESSION"
+            regressions.append(name)
+        print("%-24s %14.1f %14.1f %+7.1f%% %s" % (name, reference["best"], result["best"], 100 * change, verdict))
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--pulse", required=True, help="the engine executable")
+    parser.add_argument("--microbenchmark", help="the microbenchmark executable")
+    parser.add_argument("--baselines", required=True, help="directory of the baseline files")
+    parser.add_argument("--machine-class", default=os.environ.get("PULSE_MACHINE_CLASS", machine_class()))
+    parser.add_argument("--build-type", default="Release")
+    parser.add_argument("--repetitions", type=int, default=5)
+    parser.add_argument("--bench-depth", type=int, default=5)
+    parser.add_argument("--perft-depth", type=int, default=5)
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed relative slowdown")
+    parser.add_argument("--update", action="store_true", help="write the baseline instead of comparing")
+    arguments = parser.parse_args()
+
+    if arguments.build_type != "Release":
+        print("skipped: baselines are measured with Release builds, not %s" % arguments.build_type)
+        return SKIPPED
+
+    path = os.path.join(arguments.baselines, arguments.machine_class + ".json")
+    if not arguments.update and not os.path.exists(path):
+        print("skipped: no baseline for machine class %s" % arguments.machine_class)
+        print("run with --update to create %s" % path)
+        return SKIPPED
+
+    results, signatures = measure(arguments)
+
+    if arguments.update:
+        with open(path, "w") as file:
+            json.dump({"machine_class": arguments.machine_class, "signatures": signatures, "results": results},
+                      file, indent=2, sort_keys=True)
+            file.write("\n")
+        print("wrote %s" % path)
+        return 0
+
+    with open(path) as file:
+        baseline = json.load(file)
+
+    regressions = compare(results, signatures, baseline, arguments.threshold)
+    if regressions:
+        print("measuring again")
+        again, _ = measure(arguments)
+        for name in results:
+            results[name] = merge(results[name], again[name])
+        regressions = compare(results, signatures, baseline, arguments.threshold)
+
+    if regressions:
+        print("failed: %s got slower" % ", ".join(regressions))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,195 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "allocationtracker.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace pulse::allocation {
+
+namespace {
+
+class Counters final {
+public:
+	std::atomic<uint64_t> allocations{0};
+	std::atomic<uint64_t> deallocations{0};
+	std::atomic<uint64_t> bytes{0};
+	std::atomic<uint64_t> peakBytes{0};
+	std::atomic<uint64_t> totalBytes{0};
+};
+
+// Plain arrays, so they are ready before the first static constructor
+// allocates anything.
+Counters counters[VALUES_SIZE];
+thread_local int currentSubsystem = OTHER;
+thread_local uint64_t threadAllocations = 0;
+
+/**
+ * We put this header in front of every allocation, so we know its size and
+ * subsystem when it is freed.
+ */
+class Header final {
+public:
+	uint64_t size;
+	int subsystem;
+};
+
+#ifdef PULSE_TRACK_ALLOCATIONS
+
+void* allocate(std::size_t size, std::size_t alignment) {
+	std::size_t offset = alignment < 16 ? 16 : alignment;
+	static_assert(sizeof(Header) <= 16, "Header does not fit");
+
+	void* memory;
+	if (alignment <= alignof(std::max_align_t)) {
+		memory = std::malloc(offset + size);
+	} else {
+		// aligned_alloc wants a size which is a multiple of the alignment
+		std::size_t total = (offset + size + alignment - 1) / alignment * alignment;
+		memory = std::aligned_alloc(alignment, total);
+	}
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	int subsystem = currentSubsystem;
+	auto* data = static_cast<char*>(memory) + offset;
+	auto* header = reinterpret_cast<Header*>(data) - 1;
+	header->size = size;
+	header->subsystem = subsystem;
+
+	threadAllocations++;
+	Counters& counter = counters[subsystem];
+	counter.allocations.fetch_add(1, std::memory_order_relaxed);
+	counter.totalBytes.fetch_add(size, std::memory_order_relaxed);
+	uint64_t bytes = counter.bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	uint64_t peakBytes = counter.peakBytes.load(std::memory_order_relaxed);
+	while (bytes > peakBytes && !counter.peakBytes.compare_exchange_weak(peakBytes, bytes)) {
+	}
+
+	return data;
+}
+
+void deallocate(void* data, std::size_t alignment) {
+	if (data == nullptr) {
+		return;
+	}
+
+	std::size_t offset = alignment < 16 ? 16 : alignment;
+	auto* header = static_cast<Header*>(data) - 1;
+
+	Counters& counter = counters[header->subsystem];
+	counter.deallocations.fetch_add(1, std::memory_order_relaxed);
+	counter.bytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+	std::free(static_cast<char*>(data) - offset);
+}
+
+#endif
+}
+
+bool isEnabled() {
+#ifdef PULSE_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+Statistics get(int subsystem) {
+	Statistics statistics;
+	statistics.allocations = counters[subsystem].allocations;
+	statistics.deallocations = counters[subsystem].deallocations;
+	statistics.bytes = counters[subsystem].bytes;
+	statistics.peakBytes = counters[subsystem].peakBytes;
+	statistics.totalBytes = counters[subsystem].totalBytes;
+	return statistics;
+}
+
+uint64_t getThreadAllocations() {
+	return threadAllocations;
+}
+
+std::string toString(int subsystem) {
+	switch (subsystem) {
+		case OTHER:
+			return "other";
+		case SEARCH:
+			return "search";
+		case MOVEGEN:
+			return "movegen";
+		case NOTATION:
+			return "notation";
+		case PROTOCOL:
+			return "protocol";
+		default:
+			throw std::exception();
+	}
+}
+
+Scope::Scope(int subsystem)
+		: previous(currentSubsystem) {
+	currentSubsystem = subsystem;
+}
+
+Scope::~Scope() {
+	currentSubsystem = previous;
+}
+}
+
+#ifdef PULSE_TRACK_ALLOCATIONS
+
+void* operator new(std::size_t size) {
+	return pulse::allocation::allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size) {
+	return pulse::allocation::allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return pulse::allocation::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return pulse::allocation::allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* data) noexcept {
+	pulse::allocation::deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete[](void* data) noexcept {
+	pulse::allocation::deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete(void* data, std::size_t) noexcept {
+	pulse::allocation::deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete[](void* data, std::size_t) noexcept {
+	pulse::allocation::deallocate(data, alignof(std::max_align_t));
+}
+
+void operator delete(void* data, std::align_val_t alignment) noexcept {
+	pulse::allocation::deallocate(data, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* data, std::align_val_t alignment) noexcept {
+	pulse::allocation::deallocate(data, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* data, std::size_t, std::align_val_t alignment) noexcept {
+	pulse::allocation::deallocate(data, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* data, std::size_t, std::align_val_t alignment) noexcept {
+	pulse::allocation::deallocate(data, static_cast<std::size_t>(alignment));
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * Counts heap allocations per subsystem. This is compiled in only if
+ * PULSE_TRACK_ALLOCATIONS is defined, which replaces the global operator
+ * new and delete. An allocation belongs to the innermost
+ * PULSE_ALLOCATION_SCOPE of its thread, and is freed from the same
+ * subsystem wherever the delete happens.
+ */
+namespace pulse::allocation {
+
+constexpr int OTHER = 0;
+constexpr int SEARCH = 1;
+constexpr int MOVEGEN = 2;
+constexpr int NOTATION = 3;
+constexpr int PROTOCOL = 4;
+
+constexpr int VALUES_SIZE = 5;
+constexpr std::array<int, VALUES_SIZE> values = {
+		OTHER, SEARCH, MOVEGEN, NOTATION, PROTOCOL
+};
+
+class Statistics final {
+public:
+	uint64_t allocations = 0;
+	uint64_t deallocations = 0;
+	uint64_t bytes = 0;
+	uint64_t peakBytes = 0;
+	uint64_t totalBytes = 0;
+};
+
+bool isEnabled();
+
+Statistics get(int subsystem);
+
+// The allocations of the calling thread in all subsystems
+uint64_t getThreadAllocations();
+
+std::string toString(int subsystem);
+
+class Scope final {
+public:
+	explicit Scope(int subsystem);
+
+	~Scope();
+
+	Scope(const Scope&) = delete;
+
+	Scope& operator=(const Scope&) = delete;
+
+private:
+	const int previous;
+};
+}
+
+#ifdef PULSE_TRACK_ALLOCATIONS
+#define PULSE_ALLOCATION_SCOPE(subsystem) \
+	pulse::allocation::Scope allocationScope(pulse::allocation::subsystem)
+#else
+#define PULSE_ALLOCATION_SCOPE(subsystem)
+#endif
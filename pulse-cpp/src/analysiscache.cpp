@@ -0,0 +1,244 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "analysiscache.h"
+#include "packedposition.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace pulse {
+
+AnalysisCache::AnalysisCache(const std::string& path, uint64_t sizeInMB) {
+	if (sizeInMB < 1) throw std::invalid_argument("Illegal cache size");
+
+	uint64_t _capacity = (sizeInMB * 1024 * 1024 - sizeof(Header)) / sizeof(Record);
+	_capacity -= _capacity % BUCKET_SIZE;
+
+	open(path, _capacity);
+
+	if (capacity != _capacity) {
+		// The file was created with a different size. Move all analyses into
+		// a new file, evicting the shallowest ones if it is smaller.
+		rebuild(path, _capacity);
+	}
+
+	header->generation++;
+}
+
+void AnalysisCache::open(const std::string& path, uint64_t _capacity) {
+	file = std::make_unique<MappedFile>(path, MappedFile::READWRITE);
+	if (file->size() == 0) {
+		file = std::make_unique<MappedFile>(path, MappedFile::READWRITE,
+				sizeof(Header) + _capacity * sizeof(Record));
+
+		header = reinterpret_cast<Header*>(file->data());
+		header->magic = MAGIC;
+		header->version = VERSION;
+		header->recordSize = sizeof(Record);
+		header->capacity = _capacity;
+		header->generation = 0;
+	}
+
+	header = reinterpret_cast<Header*>(file->data());
+	if (file->size() < sizeof(Header)
+		|| header->magic != MAGIC
+		|| header->version != VERSION
+		|| header->recordSize != sizeof(Record)
+		|| file->size() != sizeof(Header) + header->capacity * sizeof(Record)) {
+		file.reset();
+		throw std::runtime_error("Not an analysis cache: " + path);
+	}
+
+	records = reinterpret_cast<Record*>(file->data() + sizeof(Header));
+	capacity = header->capacity;
+}
+
+void AnalysisCache::rebuild(const std::string& path, uint64_t _capacity) {
+	std::string rebuildPath = path + ".rebuild";
+	std::remove(rebuildPath.c_str());
+
+	std::unique_ptr<MappedFile> source = std::move(file);
+	const Record* sourceRecords = records;
+	uint64_t sourceCapacity = capacity;
+	uint32_t generation = header->generation;
+
+	open(rebuildPath, _capacity);
+	header->generation = generation;
+	for (uint64_t i = 0; i < sourceCapacity; i++) {
+		if (isValid(sourceRecords[i])) {
+			store(sourceRecords[i]);
+		}
+	}
+	file->sync();
+
+	file.reset();
+	source.reset();
+	if (std::remove(path.c_str()) != 0 || std::rename(rebuildPath.c_str(), path.c_str()) != 0) {
+		throw std::runtime_error("Cannot replace " + path);
+	}
+
+	open(path, _capacity);
+}
+
+/**
+ * Looks up the analysis of the position. Returns false if we have never
+ * analysed it.
+ */
+bool AnalysisCache::get(const Position& position, int& depth, RootEntry& entry) {
+	if (!isPackable(position)) {
+		return false;
+	}
+	Record key = pack(position);
+
+	Record* bucket = bucketOf(key.zobristKey);
+	for (int i = 0; i < BUCKET_SIZE; i++) {
+		// Work on a copy, so another process cannot change it after we have
+		// checked it
+		Record record = bucket[i];
+		if (isValid(record) && matches(record, key)) {
+			depth = record.depth;
+			entry.value = record.value;
+			entry.move = record.pv[0];
+			entry.pv.size = record.pvSize;
+			for (int j = 0; j < record.pvSize; j++) {
+				entry.pv.moves[j] = record.pv[j];
+			}
+
+			// Refresh the generation, so popular positions are kept longer
+			bucket[i].generation = static_cast<uint16_t>(header->generation);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Stores the analysis of the position.
+ */
+void AnalysisCache::put(const Position& position, int depth, const RootEntry& entry) {
+	if (depth < 1 || entry.pv.size < 1 || !isPackable(position)) {
+		return;
+	}
+
+	Record record = pack(position);
+	record.depth = static_cast<uint8_t>(depth);
+	record.value = entry.value;
+	record.generation = static_cast<uint16_t>(header->generation);
+	record.pvSize = static_cast<uint16_t>(std::min(entry.pv.size, MAX_PV));
+	for (int i = 0; i < record.pvSize; i++) {
+		record.pv[i] = entry.pv.moves[i];
+	}
+	record.checksum = getChecksum(record);
+
+	store(record);
+}
+
+/**
+ * Writes the record into its bucket. An existing analysis of the same
+ * position is only replaced by a deeper one. Otherwise we evict the
+ * shallowest analysis, and among equals the oldest one.
+ */
+void AnalysisCache::store(const Record& record) {
+	Record* bucket = bucketOf(record.zobristKey);
+	Record* replace = nullptr;
+	for (int i = 0; i < BUCKET_SIZE; i++) {
+		if (isValid(bucket[i]) && matches(bucket[i], record)) {
+			if (bucket[i].depth > record.depth) {
+				return;
+			}
+			replace = &bucket[i];
+			break;
+		}
+
+		if (replace == nullptr
+			|| bucket[i].depth < replace->depth
+			|| (bucket[i].depth == replace->depth && bucket[i].generation < replace->generation)) {
+			replace = &bucket[i];
+		}
+	}
+
+	*replace = record;
+}
+
+uint64_t AnalysisCache::getCapacity() const {
+	return capacity;
+}
+
+void AnalysisCache::sync() {
+	file->sync();
+}
+
+AnalysisCache::Record* AnalysisCache::bucketOf(uint64_t zobristKey) const {
+	return &records[(zobristKey % (capacity / BUCKET_SIZE)) * BUCKET_SIZE];
+}
+
+/**
+ * Copies everything we need to tell two positions apart into a record.
+ */
+AnalysisCache::Record AnalysisCache::pack(const Position& position) {
+	PackedPosition packedPosition = PackedPosition::pack(position);
+
+	Record record{};
+	record.zobristKey = position.zobristKey;
+	record.occupancy = packedPosition.occupancy;
+	std::memcpy(record.pieces, packedPosition.pieces, sizeof(record.pieces));
+	record.castlingRights = packedPosition.castlingRights;
+	record.enPassantSquare = packedPosition.enPassantSquare;
+	record.activeColor = packedPosition.activeColor;
+
+	return record;
+}
+
+/**
+ * Returns whether the position fits into a record. Only illegal positions
+ * have more than 32 pieces.
+ */
+bool AnalysisCache::isPackable(const Position& position) {
+	int pieces = 0;
+	for (auto color: color::values) {
+		for (auto piecetype: piecetype::values) {
+			pieces += bitboard::size(position.pieces[color][piecetype]);
+		}
+	}
+	return pieces <= 32;
+}
+
+bool AnalysisCache::matches(const Record& record, const Record& key) {
+	return record.zobristKey == key.zobristKey
+		   && record.occupancy == key.occupancy
+		   && std::memcmp(record.pieces, key.pieces, sizeof(record.pieces)) == 0
+		   && record.castlingRights == key.castlingRights
+		   && record.enPassantSquare == key.enPassantSquare
+		   && record.activeColor == key.activeColor;
+}
+
+/**
+ * Hashes the record with FNV-1a.
+ */
+uint32_t AnalysisCache::getChecksum(const Record& record) {
+	Record copy = record;
+	copy.generation = 0;
+	copy.checksum = 0;
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&copy);
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < sizeof(Record); i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+	}
+	return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+/**
+ * Returns whether the record holds an analysis, which nobody has written
+ * to at the same time.
+ */
+bool AnalysisCache::isValid(const Record& record) {
+	return record.depth > 0 && record.pvSize <= MAX_PV && record.checksum == getChecksum(record);
+}
+}
@@ -0,0 +1,95 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "position.h"
+#include "movelist.h"
+#include "mappedfile.h"
+
+#include <memory>
+
+namespace pulse {
+
+/**
+ * This class stores finished analyses in a memory-mapped file, so they
+ * survive the engine process. Positions are looked up by their zobrist key
+ * and verified against a packed copy of the board. When a bucket is full,
+ * the shallowest analysis is evicted. Several processes may share the file
+ * without locking, so every record carries a checksum. A record torn by a
+ * concurrent write fails it and counts as empty.
+ */
+class AnalysisCache final {
+public:
+	static const int MAX_PV = 20;
+
+	AnalysisCache(const std::string& path, uint64_t sizeInMB);
+
+	bool get(const Position& position, int& depth, RootEntry& entry);
+
+	void put(const Position& position, int depth, const RootEntry& entry);
+
+	uint64_t getCapacity() const;
+
+	void sync();
+
+private:
+	class Header final {
+	public:
+		uint64_t magic;
+		uint32_t version;
+		uint32_t recordSize;
+		uint64_t capacity;
+		uint32_t generation;
+		uint32_t reserved[9];
+	};
+
+	class Record final {
+	public:
+		uint64_t zobristKey;
+		uint64_t occupancy;
+		uint8_t pieces[16];
+		uint8_t castlingRights;
+		uint8_t enPassantSquare;
+		uint8_t activeColor;
+		uint8_t depth;
+		int32_t value;
+		uint16_t generation;
+		uint16_t pvSize;
+		// Covers everything but the generation, which we refresh in place
+		uint32_t checksum;
+		int32_t pv[MAX_PV];
+	};
+
+	static_assert(sizeof(Header) == 64, "Unexpected header layout");
+	static_assert(sizeof(Record) == 128, "Unexpected record layout");
+
+	static const uint64_t MAGIC = 0x31434145534c5550ULL; // "PULSEAC1"
+	static const uint32_t VERSION = 2;
+	static const int BUCKET_SIZE = 4;
+
+	std::unique_ptr<MappedFile> file;
+	Header* header = nullptr;
+	Record* records = nullptr;
+	uint64_t capacity = 0;
+
+	void open(const std::string& path, uint64_t _capacity);
+
+	void rebuild(const std::string& path, uint64_t _capacity);
+
+	void store(const Record& record);
+
+	Record* bucketOf(uint64_t zobristKey) const;
+
+	static Record pack(const Position& position);
+
+	static bool isPackable(const Position& position);
+
+	static bool matches(const Record& record, const Record& key);
+
+	static uint32_t getChecksum(const Record& record);
+
+	static bool isValid(const Record& record);
+};
+}
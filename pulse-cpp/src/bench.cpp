@@ -0,0 +1,109 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "bench.h"
+#include "notation.h"
+#include "perfcounters.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace pulse {
+
+const std::array<const char*, 8> Bench::FENS = {
+		notation::STANDARDPOSITION,
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"2r2rk1/pp1bqpp1/2n1pn1p/3p4/3P4/2PBPN2/PP1Q1PPP/R3R1K1 w - - 2 15",
+		"4r1k1/1q3ppp/p7/1p1Qp3/4P3/1P3P2/P5PP/3R2K1 b - - 3 28",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"6k1/5pp1/4p2p/8/3P4/4P1P1/5PKP/8 w - - 0 40"
+};
+
+void Bench::run(int depth, bool useCounters) {
+	// Open the counters before the search creates its thread, so they cover
+	// the search thread as well.
+	std::unique_ptr<PerfCounters> counters;
+	if (useCounters) {
+		counters = std::make_unique<PerfCounters>();
+	}
+
+	Search search(*this);
+	uint64_t totalNodes = 0;
+
+	if (counters) {
+		counters->start();
+	}
+	auto startTime = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < FENS.size(); i++) {
+		Position position = notation::toPosition(FENS[i]);
+		std::cout << "Position " << (i + 1) << "/" << FENS.size() << ": " << FENS[i] << std::endl;
+
+		// Every position starts from scratch, so the node count does not
+		// depend on the order of the positions.
+		search.clearHash();
+		search.newDepthSearch(position, depth);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		finished = false;
+		nodes = 0;
+		lock.unlock();
+
+		search.start();
+
+		lock.lock();
+		condition.wait(lock, [this] { return finished; });
+		totalNodes += nodes;
+		lock.unlock();
+
+		// Wait until the search thread is ready for the next position
+		search.stop();
+	}
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+	if (counters) {
+		counters->stop();
+	}
+
+	search.quit();
+
+	std::cout << "Nodes: " << totalNodes << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+	std::cout << "n/ms: " << totalNodes / std::max<int64_t>(duration, 1) << std::endl;
+
+	if (counters) {
+		counters->print(std::cout, totalNodes);
+	}
+}
+
+void Bench::sendBestMove(int bestMove, int ponderMove) {
+	std::unique_lock<std::mutex> lock(mutex);
+	finished = true;
+	condition.notify_all();
+}
+
+void Bench::sendStatus(
+		int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove, int currentMoveNumber) {
+}
+
+void Bench::sendStatus(
+		bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+		int currentMoveNumber) {
+	if (force) {
+		std::unique_lock<std::mutex> lock(mutex);
+		nodes = totalNodes;
+	}
+}
+
+void Bench::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) {
+}
+
+void Bench::sendInfo(const std::string& message) {
+}
+
+void Bench::sendDebug(const std::string& message) {
+}
+}
@@ -0,0 +1,50 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "search.h"
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+
+namespace pulse {
+
+/**
+ * This class searches a fixed set of positions to a fixed depth. The node
+ * count tells whether the search has changed, the speed tells whether it
+ * got slower.
+ */
+class Bench final : public Protocol {
+public:
+	static const int DEFAULT_DEPTH = 6;
+
+	static const std::array<const char*, 8> FENS;
+
+	void run(int depth, bool useCounters);
+
+	void sendBestMove(int bestMove, int ponderMove) override;
+
+	void sendStatus(
+			int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+			int currentMoveNumber) override;
+
+	void sendStatus(
+			bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+			int currentMoveNumber) override;
+
+	void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override;
+
+	void sendInfo(const std::string& message) override;
+
+	void sendDebug(const std::string& message) override;
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool finished = false;
+	uint64_t nodes = 0;
+};
+}
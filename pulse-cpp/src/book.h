@@ -0,0 +1,52 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "position.h"
+#include "mappedfile.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class reads an opening book in Polyglot format. The file is mapped
+ * into memory and searched in place, so large books don't use private
+ * memory. Entries are sorted by key, and a move is chosen at random
+ * according to its weight.
+ */
+class Book final {
+public:
+	class Entry final {
+	public:
+		int move;
+		int weight;
+	};
+
+	explicit Book(const std::string& path);
+
+	static uint64_t getKey(const Position& position);
+
+	std::vector<Entry> getEntries(Position& position) const;
+
+	int probe(Position& position);
+
+	uint64_t size() const;
+
+	static int toPolyglotMove(int move);
+
+private:
+	static const int ENTRY_SIZE = 16;
+
+	std::unique_ptr<MappedFile> mappedFile;
+	uint64_t count = 0;
+	std::mt19937_64 random{std::random_device()()};
+
+	uint64_t read(uint64_t index, int offset, int length) const;
+};
+}
@@ -0,0 +1,160 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "datasetfilter.h"
+#include "threadpool.h"
+#include "model/color.h"
+#include "model/move.h"
+#include "model/movetype.h"
+#include "model/piece.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace pulse {
+
+bool DatasetFilter::Criteria::accepts(const PackedPosition& packedPosition, Position& position) const {
+	int ply = (packedPosition.fullmoveNumber - 1) * 2 + (packedPosition.activeColor == color::BLACK ? 1 : 0);
+	if (ply < minPly || ply > maxPly) {
+		return false;
+	}
+	if (maxScore != value::NOVALUE && std::abs(packedPosition.score) > maxScore) {
+		return false;
+	}
+	if (skipCapture && packedPosition.move != move::NOMOVE
+		&& (move::getTargetPiece(packedPosition.move) != piece::NOPIECE
+			|| move::getType(packedPosition.move) == movetype::ENPASSANT)) {
+		return false;
+	}
+	if (skipCheck && position.isCheck()) {
+		return false;
+	}
+	return true;
+}
+
+bool DatasetFilter::Entry::operator<(const Entry& entry) const {
+	return zobristKey < entry.zobristKey || (zobristKey == entry.zobristKey && index < entry.index);
+}
+
+/**
+ * Removes all but the first occurrence of every key from the entries and
+ * from the positions we keep. Returns the number of removed entries.
+ */
+uint64_t DatasetFilter::removeDuplicates(std::vector<Entry>& entries, std::vector<uint64_t>& keep) {
+	// Equal keys are sorted by index, so the first occurrence stays
+	std::sort(entries.begin(), entries.end());
+	size_t size = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (size > 0 && entries[i].zobristKey == entries[size - 1].zobristKey) {
+			keep[entries[i].index / 64] &= ~(uint64_t(1) << (entries[i].index % 64));
+		} else {
+			entries[size++] = entries[i];
+		}
+	}
+
+	uint64_t removed = entries.size() - size;
+	entries.resize(size);
+	return removed;
+}
+
+DatasetFilter::Result DatasetFilter::run(const std::string& inputPath, const std::string& outputPath,
+										 const Criteria& criteria, uint64_t memory, int threadCount) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	PackedPositionReader reader(inputPath);
+	uint64_t size = reader.size();
+
+	Result result;
+	result.positions = size;
+
+	// Every entry of a shard is held once in the chunks and once sorted
+	uint64_t shardMemory = std::max<uint64_t>(memory / (2 * sizeof(Entry)), 1);
+	result.shards = static_cast<int>(std::max<uint64_t>((size + shardMemory - 1) / shardMemory, 1));
+
+	// One bit per position we keep
+	std::vector<uint64_t> keep((size + 63) / 64, 0);
+	uint64_t chunkCount = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	std::atomic<uint64_t> filtered{0};
+	std::atomic<uint64_t> duplicates{0};
+
+	for (int shard = 0; shard < result.shards; shard++) {
+		// Collect the keys of this shard in the order of the file
+		std::vector<std::vector<Entry>> chunks(chunkCount);
+		std::atomic<uint64_t> nextChunk{0};
+		{
+			ThreadPool threadPool(threadCount);
+			std::vector<std::future<void>> futures;
+			for (int i = 0; i < threadCount; i++) {
+				futures.push_back(threadPool.submit([&, shard] {
+					for (uint64_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+						uint64_t end = std::min((chunk + 1) * CHUNK_SIZE, size);
+						for (uint64_t index = chunk * CHUNK_SIZE; index < end; index++) {
+							uint64_t& word = keep[index / 64];
+							uint64_t bit = uint64_t(1) << (index % 64);
+							if (shard > 0 && (word & bit) == 0) {
+								continue;
+							}
+
+							Position position = reader[index].unpack();
+							if (shard == 0) {
+								if (!criteria.accepts(reader[index], position)) {
+									filtered++;
+									continue;
+								}
+								word |= bit;
+							}
+
+							if (static_cast<int>(position.zobristKey % result.shards) == shard) {
+								chunks[chunk].push_back({position.zobristKey, index});
+							}
+						}
+
+						// Only the first occurrence in this chunk can be the first in the file
+						duplicates += removeDuplicates(chunks[chunk], keep);
+						chunks[chunk].shrink_to_fit();
+					}
+				}));
+			}
+			for (auto& future: futures) {
+				future.get();
+			}
+		}
+
+		std::vector<Entry> entries;
+		for (auto& chunk: chunks) {
+			entries.insert(entries.end(), chunk.begin(), chunk.end());
+			std::vector<Entry>().swap(chunk);
+		}
+
+		result.shardEntries = std::max<uint64_t>(result.shardEntries, entries.size());
+		duplicates += removeDuplicates(entries, keep);
+	}
+	result.filtered = filtered;
+	result.duplicates = duplicates;
+
+	PackedPositionWriter writer(outputPath);
+	for (uint64_t index = 0; index < size; index++) {
+		if ((keep[index / 64] & (uint64_t(1) << (index % 64))) != 0) {
+			writer.write(reader[index]);
+		}
+	}
+	writer.close();
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Positions: " << result.positions << std::endl;
+	std::cout << "Filtered: " << result.filtered << std::endl;
+	std::cout << "Duplicates: " << result.duplicates << std::endl;
+	std::cout << "Written: " << result.positions - result.filtered - result.duplicates << std::endl;
+	std::cout << "Shards: " << result.shards << " (largest " << result.shardEntries << " entries)" << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+
+	return result;
+}
+}
@@ -0,0 +1,70 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "packedposition.h"
+#include "model/value.h"
+
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class filters a file of packed positions and removes all but the
+ * first occurrence of every position. Duplicates are found by sorting the
+ * zobrist keys. If the keys don't fit into the memory limit, the key space
+ * is split into shards and we pass over the file once per shard. Every
+ * chunk of the file drops its own duplicates first, so a common position
+ * takes at most one entry per chunk.
+ */
+class DatasetFilter final {
+public:
+	static const uint64_t DEFAULT_MEMORY = 1024 * 1024 * 1024;
+
+	class Criteria final {
+	public:
+		bool skipCheck = false;
+		bool skipCapture = false;
+		int minPly = 0;
+		int maxPly = INT_MAX;
+
+		// Positions without a score only pass with the default
+		int maxScore = value::NOVALUE;
+
+		bool accepts(const PackedPosition& packedPosition, Position& position) const;
+	};
+
+	class Result final {
+	public:
+		uint64_t positions = 0;
+		uint64_t filtered = 0;
+		uint64_t duplicates = 0;
+		int shards = 0;
+		// The most entries we have held for one shard
+		uint64_t shardEntries = 0;
+	};
+
+	Result run(const std::string& inputPath, const std::string& outputPath, const Criteria& criteria,
+			   uint64_t memory, int threadCount);
+
+private:
+	// Chunks are a multiple of 64 positions, so every thread owns the words
+	// of the bitmap it writes.
+	static const uint64_t CHUNK_SIZE = 1 << 16;
+
+	class Entry final {
+	public:
+		uint64_t zobristKey;
+		uint64_t index;
+
+		bool operator<(const Entry& entry) const;
+	};
+
+	static uint64_t removeDuplicates(std::vector<Entry>& entries, std::vector<uint64_t>& keep);
+};
+}
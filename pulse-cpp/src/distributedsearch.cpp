@@ -0,0 +1,528 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "distributedsearch.h"
+#include "movegenerator.h"
+#include "notation.h"
+#include "pulse.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <climits>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace pulse {
+
+#ifdef _WIN32
+
+DistributedSearch::DistributedSearch(Protocol& protocol, int workerCount, const std::string& executable)
+		: protocol(protocol) {
+	throw std::runtime_error("Workers are not supported on this platform");
+}
+
+DistributedSearch::~DistributedSearch() = default;
+
+bool DistributedSearch::Worker::send(const std::string& line) {
+	return false;
+}
+
+void DistributedSearch::spawn(Worker& worker) {
+}
+
+void DistributedSearch::read(Worker& worker) {
+}
+
+#else
+
+DistributedSearch::DistributedSearch(Protocol& protocol, int workerCount, const std::string& executable)
+		: protocol(protocol), executable(executable) {
+	if (workerCount < 1) throw std::invalid_argument("Illegal number of workers");
+
+	if (this->executable.empty()) {
+		// Our workers run the same binary we are running
+		char path[PATH_MAX];
+		ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+		if (length <= 0) {
+			throw std::runtime_error("Cannot find the engine executable");
+		}
+		this->executable = std::string(path, static_cast<size_t>(length));
+	}
+
+	for (int i = 0; i < workerCount; i++) {
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->number = i + 1;
+		spawn(*workers.back());
+	}
+}
+
+DistributedSearch::~DistributedSearch() {
+	stop();
+
+	for (auto& worker: workers) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (worker->alive) {
+				worker->send("quit");
+			}
+		}
+		if (worker->reader.joinable()) {
+			worker->reader.join();
+		}
+	}
+}
+
+/**
+ * Writes a line to the worker. We never want to die from a SIGPIPE because
+ * a worker has crashed.
+ */
+bool DistributedSearch::Worker::send(const std::string& line) {
+	std::string data = line + "\n";
+	size_t sent = 0;
+	while (sent < data.size()) {
+		ssize_t count = ::send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (count <= 0) {
+			return false;
+		}
+		sent += static_cast<size_t>(count);
+	}
+	return true;
+}
+
+/**
+ * Starts a worker process with its stdin and stdout connected to our end
+ * of a Unix socket pair.
+ */
+void DistributedSearch::spawn(Worker& worker) {
+	if (worker.reader.joinable()) {
+		worker.reader.join();
+	}
+
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+		throw std::runtime_error("Cannot create socket for worker");
+	}
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(sockets[0]);
+		close(sockets[1]);
+		throw std::runtime_error("Cannot start worker");
+	}
+
+	if (pid == 0) {
+		// We are the worker
+		dup2(sockets[1], STDIN_FILENO);
+		dup2(sockets[1], STDOUT_FILENO);
+		close(sockets[0]);
+		close(sockets[1]);
+		execl(executable.c_str(), executable.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	close(sockets[1]);
+	worker.pid = pid;
+	worker.socket = sockets[0];
+	worker.alive = true;
+	worker.searching = false;
+
+	for (auto& option: options) {
+		worker.send(option);
+	}
+
+	worker.reader = std::thread(&DistributedSearch::read, this, std::ref(worker));
+}
+
+void DistributedSearch::read(Worker& worker) {
+	std::string buffer;
+	char data[4096];
+	while (true) {
+		ssize_t count = recv(worker.socket, data, sizeof(data), 0);
+		if (count <= 0) {
+			break;
+		}
+		buffer.append(data, static_cast<size_t>(count));
+
+		size_t end;
+		while ((end = buffer.find('\n')) != std::string::npos) {
+			std::istringstream input(buffer.substr(0, end));
+			buffer.erase(0, end + 1);
+
+			std::string token;
+			input >> token;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			if (token == "info") {
+				receiveInfo(worker, input);
+			} else if (token == "bestmove") {
+				receiveBestMove(worker);
+			}
+		}
+	}
+
+	// The worker is gone, either because we told it to quit or because it
+	// crashed.
+	close(worker.socket);
+	waitpid(worker.pid, nullptr, 0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	worker.alive = false;
+	if (worker.searching) {
+		protocol.sendInfo("Worker " + std::to_string(worker.number) + " died");
+		receiveBestMove(worker);
+	}
+}
+
+#endif
+
+/**
+ * Remembers an option for all workers, including the ones we will restart.
+ */
+void DistributedSearch::setOption(const std::string& line) {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	options.push_back(line);
+	for (auto& worker: workers) {
+		if (worker->alive) {
+			worker->send(line);
+		}
+	}
+}
+
+void DistributedSearch::newGame() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	for (auto& worker: workers) {
+		if (worker->alive) {
+			worker->send("ucinewgame");
+		}
+	}
+}
+
+void DistributedSearch::start(const Position& _position, const std::string& parameters,
+							  const std::vector<int>& searchMoves) {
+	stop();
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	position = _position;
+
+	// Restart crashed workers
+	for (auto& worker: workers) {
+		if (!worker->alive) {
+			try {
+				spawn(*worker);
+			} catch (std::runtime_error& e) {
+				protocol.sendInfo(e.what());
+			}
+		}
+	}
+
+	// Collect the root moves
+	std::vector<int> rootMoves;
+	MoveGenerator moveGenerator;
+	MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+	for (int i = 0; i < moves.size; i++) {
+		int move = moves.entries[i]->move;
+		if (searchMoves.empty() || std::find(searchMoves.begin(), searchMoves.end(), move) != searchMoves.end()) {
+			rootMoves.push_back(move);
+		}
+	}
+	fallbackMove = rootMoves.empty() ? +move::NOMOVE : rootMoves[0];
+	reportedDepth = 0;
+
+	// Deal the root moves to the live workers. The move list is sorted by
+	// MVV/LVA, so every worker gets a fair share of promising moves.
+	std::vector<Worker*> liveWorkers;
+	for (auto& worker: workers) {
+		if (worker->alive) {
+			liveWorkers.push_back(worker.get());
+		}
+	}
+
+	std::vector<std::string> shares(liveWorkers.size());
+	for (unsigned int i = 0; i < rootMoves.size() && !liveWorkers.empty(); i++) {
+		shares[i % liveWorkers.size()] += " " + Pulse::fromMove(rootMoves[i]);
+	}
+
+	std::string fen = notation::fromPosition(position);
+	for (unsigned int i = 0; i < liveWorkers.size(); i++) {
+		Worker& worker = *liveWorkers[i];
+		worker.nodes = 0;
+		worker.depth = 0;
+		worker.maxDepth = 0;
+		worker.value = 0;
+		worker.pv.clear();
+		worker.values.clear();
+
+		if (!shares[i].empty()
+			&& worker.send("position fen " + fen)
+			&& worker.send("go " + parameters + " searchmoves" + shares[i])) {
+			worker.searching = true;
+			running = true;
+		}
+	}
+
+	if (!running) {
+		// Either there is nothing to search or no worker is left
+		protocol.sendBestMove(fallbackMove, move::NOMOVE);
+	}
+}
+
+/**
+ * Stops all workers and waits until we have sent the best move.
+ */
+void DistributedSearch::stop() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (running) {
+		for (auto& worker: workers) {
+			if (worker->searching) {
+				worker->send("stop");
+			}
+		}
+
+		condition.wait(lock, [this] { return !running; });
+	}
+}
+
+void DistributedSearch::ponderhit() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (running) {
+		for (auto& worker: workers) {
+			if (worker->searching) {
+				worker->send("ponderhit");
+			}
+		}
+	}
+}
+
+void DistributedSearch::receiveInfo(Worker& worker, std::istringstream& input) {
+	if (!worker.searching) {
+		return;
+	}
+
+	int depth = worker.depth;
+	int maxDepth = worker.maxDepth;
+	int value = worker.value;
+	std::vector<std::string> pv;
+
+	std::string token;
+	while (input >> token) {
+		if (token == "depth") {
+			input >> depth;
+		} else if (token == "seldepth") {
+			input >> maxDepth;
+		} else if (token == "nodes") {
+			input >> worker.nodes;
+		} else if (token == "score") {
+			std::string type;
+			int score;
+			input >> type >> score;
+			value = toValue(type, score);
+		} else if (token == "pv") {
+			while (input >> token) {
+				pv.push_back(token);
+			}
+		} else if (token == "string") {
+			return;
+		}
+	}
+
+	worker.maxDepth = std::max(worker.maxDepth, maxDepth);
+
+	uint64_t totalNodes = 0;
+	int totalMaxDepth = 0;
+	for (auto& w: workers) {
+		totalNodes += w->nodes;
+		totalMaxDepth = std::max(totalMaxDepth, w->maxDepth);
+	}
+
+	if (!pv.empty()) {
+		worker.depth = depth;
+		worker.value = value;
+		worker.pv = pv;
+		if (worker.values.size() <= static_cast<size_t>(depth)) {
+			worker.values.resize(depth + 1, value::NOVALUE);
+		}
+		worker.values[depth] = value;
+
+		if (depth >= MIN_SHARED_DEPTH) {
+			share(worker);
+		}
+
+		// Don't go back to a shallower depth, if a worker with a weaker share
+		// is ahead of the others.
+		if (getBestWorker() == &worker && worker.depth >= reportedDepth) {
+			reportedDepth = worker.depth;
+			protocol.sendMove(toEntry(worker), worker.depth, totalMaxDepth, totalNodes);
+		}
+	} else {
+		protocol.sendStatus(depth, totalMaxDepth, totalNodes, move::NOMOVE, 0);
+	}
+}
+
+/**
+ * Sends the principal variation of a worker to the other workers. Must be
+ * called with the mutex held.
+ */
+void DistributedSearch::share(const Worker& worker) {
+	std::string line = "hash depth " + std::to_string(worker.depth)
+					   + " value " + std::to_string(worker.value) + " pv";
+	for (auto& move: worker.pv) {
+		line += " " + move;
+	}
+
+	for (auto& w: workers) {
+		if (w.get() != &worker && w->alive && w->searching) {
+			w->send(line);
+		}
+	}
+}
+
+void DistributedSearch::receiveBestMove(Worker& worker) {
+	if (!worker.searching) {
+		return;
+	}
+	worker.searching = false;
+
+	for (auto& w: workers) {
+		if (w->searching) {
+			return;
+		}
+	}
+
+	finish();
+}
+
+/**
+ * All workers are done. Send the best result as ours.
+ */
+void DistributedSearch::finish() {
+	uint64_t totalNodes = 0;
+	int totalMaxDepth = 0;
+	for (auto& worker: workers) {
+		totalNodes += worker->nodes;
+		totalMaxDepth = std::max(totalMaxDepth, worker->maxDepth);
+	}
+
+	int bestMove = fallbackMove;
+	int ponderMove = move::NOMOVE;
+	Worker* bestWorker = getBestWorker();
+	if (bestWorker != nullptr) {
+		RootEntry entry = toEntry(*bestWorker);
+		if (entry.pv.size >= 1) {
+			bestMove = entry.pv.moves[0];
+		}
+		if (entry.pv.size >= 2) {
+			ponderMove = entry.pv.moves[1];
+		}
+		protocol.sendStatus(true, bestWorker->depth, totalMaxDepth, totalNodes, move::NOMOVE, 0);
+	}
+
+	protocol.sendBestMove(bestMove, ponderMove);
+
+	running = false;
+	condition.notify_all();
+}
+
+/**
+ * Returns the worker with the best value so far. The workers search
+ * different root moves, so their values are independent of each other.
+ * However a worker which is behind has seen less of its moves, so we
+ * compare the values at the depth all workers have reached.
+ */
+DistributedSearch::Worker* DistributedSearch::getBestWorker() {
+	int commonDepth = depth::MAX_DEPTH;
+	for (auto& worker: workers) {
+		if (!worker->pv.empty()) {
+			commonDepth = std::min(commonDepth, worker->depth);
+		}
+	}
+
+	Worker* bestWorker = nullptr;
+	int bestValue = -value::INFINITE;
+	for (auto& worker: workers) {
+		if (worker->pv.empty()) {
+			continue;
+		}
+
+		int value = getValue(*worker, commonDepth);
+		if (bestWorker == nullptr
+			|| value > bestValue
+			|| (value == bestValue && worker->depth > bestWorker->depth)) {
+			bestWorker = worker.get();
+			bestValue = value;
+		}
+	}
+	return bestWorker;
+}
+
+/**
+ * Returns the value of the worker at this depth. If the worker didn't
+ * send a principal variation at this depth, we take the one before.
+ */
+int DistributedSearch::getValue(const Worker& worker, int depth) {
+	for (int i = std::min<int>(depth, static_cast<int>(worker.values.size()) - 1); i >= 0; i--) {
+		if (worker.values[i] != value::NOVALUE) {
+			return worker.values[i];
+		}
+	}
+	return worker.value;
+}
+
+/**
+ * Converts the principal variation of the worker back into our moves.
+ */
+RootEntry DistributedSearch::toEntry(const Worker& worker) {
+	RootEntry entry;
+	entry.value = worker.value;
+
+	Position current(position);
+	MoveGenerator moveGenerator;
+	for (auto& notation: worker.pv) {
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(current, 1, current.isCheck());
+		int move = move::NOMOVE;
+		for (int i = 0; i < moves.size; i++) {
+			if (Pulse::fromMove(moves.entries[i]->move) == notation) {
+				move = moves.entries[i]->move;
+				break;
+			}
+		}
+
+		if (move == move::NOMOVE || entry.pv.size == depth::MAX_PLY) {
+			break;
+		}
+
+		entry.pv.moves[entry.pv.size++] = move;
+		current.makeMove(move);
+	}
+
+	entry.move = entry.pv.size > 0 ? entry.pv.moves[0] : +move::NOMOVE;
+	return entry;
+}
+
+/**
+ * Converts a UCI score back into our value. This is the inverse of
+ * Pulse::sendMove().
+ */
+int DistributedSearch::toValue(const std::string& type, int score) {
+	if (type == "mate") {
+		if (score > 0) {
+			return value::CHECKMATE - (2 * score - 1);
+		} else {
+			return -value::CHECKMATE + 2 * -score;
+		}
+	} else {
+		return score;
+	}
+}
+}
@@ -0,0 +1,102 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "protocol.h"
+#include "position.h"
+
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class distributes a search over worker processes. Every worker is a
+ * normal Pulse process talking UCI over a Unix socket. The root moves are
+ * split among the workers, each worker searches its share with searchmoves
+ * and we send the best result as our own. A crashing worker only loses its
+ * share of the current search and is restarted for the next one. Workers
+ * run our own executable unless we are given another one. Deep principal
+ * variations of one worker are sent to the others with a hash command, so
+ * they can use them in their transposition tables.
+ */
+class DistributedSearch final {
+public:
+	// The minimum depth of a principal variation we share with the workers
+	static const int MIN_SHARED_DEPTH = 4;
+
+	DistributedSearch(Protocol& protocol, int workerCount, const std::string& executable = "");
+
+	~DistributedSearch();
+
+	void setOption(const std::string& line);
+
+	void newGame();
+
+	void start(const Position& _position, const std::string& parameters, const std::vector<int>& searchMoves);
+
+	void stop();
+
+	void ponderhit();
+
+private:
+	class Worker final {
+	public:
+		int number = 0;
+		int pid = -1;
+		int socket = -1;
+		std::thread reader;
+		bool alive = false;
+		bool searching = false;
+
+		// Progress of the current search
+		uint64_t nodes = 0;
+		int depth = 0;
+		int maxDepth = 0;
+		int value = 0;
+		std::vector<std::string> pv;
+		// The value of the last principal variation of every depth
+		std::vector<int> values;
+
+		bool send(const std::string& line);
+	};
+
+	Protocol& protocol;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::string> options;
+	std::string executable;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool running = false;
+	Position position;
+	int fallbackMove;
+	int reportedDepth;
+
+	void spawn(Worker& worker);
+
+	void read(Worker& worker);
+
+	void receiveInfo(Worker& worker, std::istringstream& input);
+
+	void receiveBestMove(Worker& worker);
+
+	void share(const Worker& worker);
+
+	void finish();
+
+	Worker* getBestWorker();
+
+	static int getValue(const Worker& worker, int depth);
+
+	RootEntry toEntry(const Worker& worker);
+
+	static int toValue(const std::string& type, int score);
+};
+}
@@ -4,6 +4,7 @@
 // found in the LICENSE file.
 
 #include "evaluation.h"
+#include "profile.h"
 
 namespace pulse::evaluation {
 namespace {
@@ -87,6 +88,8 @@ int evaluateMobility(int color, Position& position) {
  * @return the evaluation value in centipawns.
  */
 int evaluate(Position& position) {
+	PULSE_PROFILE_SCOPE(EVALUATE);
+
 	// Initialize
 	int myColor = position.activeColor;
 	int oppositeColor = color::opposite(myColor);
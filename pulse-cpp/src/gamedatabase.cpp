@@ -0,0 +1,395 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "gamedatabase.h"
+#include "book.h"
+#include "movegenerator.h"
+#include "notation.h"
+#include "packedposition.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+
+namespace pulse {
+
+namespace {
+constexpr char MAGIC[8] = {'P', 'U', 'L', 'S', 'E', 'G', 'D', 'B'};
+constexpr std::streamsize BUFFER_SIZE = 1 << 20;
+constexpr size_t WRITE_SIZE = 1 << 16;
+
+template<class T>
+void append(std::vector<uint8_t>& bytes, const T& value) {
+	const auto* begin = reinterpret_cast<const uint8_t*>(&value);
+	bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+template<class T>
+T get(const uint8_t* bytes) {
+	T value;
+	std::memcpy(&value, bytes, sizeof(T));
+	return value;
+}
+}
+
+bool GameDatabase::Entry::operator<(const Entry& entry) const {
+	return key < entry.key || (key == entry.key && (game < entry.game || (game == entry.game && ply < entry.ply)));
+}
+
+GameDatabase::GameDatabase(const std::string& path)
+		: mappedFile(new MappedFile(path, MappedFile::READONLY)) {
+	if (mappedFile->size() < sizeof(Header)) {
+		throw std::runtime_error("Invalid game database " + path);
+	}
+
+	header = reinterpret_cast<const Header*>(mappedFile->data());
+	if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION
+		|| header->gameTableOffset + header->gameCount * sizeof(uint64_t) > header->indexOffset
+		|| header->indexOffset + header->entryCount * sizeof(Entry) != mappedFile->size()) {
+		throw std::runtime_error("Invalid game database " + path);
+	}
+	entries = reinterpret_cast<const Entry*>(mappedFile->data() + header->indexOffset);
+}
+
+/**
+ * Builds a database from a PGN archive. The archive is split into one chunk
+ * per thread. Every thread encodes its games and sorts its index entries,
+ * and we merge the sorted entries into the file.
+ */
+GameDatabase::Result GameDatabase::build(const std::string& inputPath, const std::string& outputPath,
+										 int threadCount) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::ifstream input(inputPath, std::ios::binary | std::ios::ate);
+	if (!input) {
+		throw std::runtime_error("Cannot open " + inputPath);
+	}
+	uint64_t size = static_cast<uint64_t>(input.tellg());
+
+	std::vector<Chunk> chunks(threadCount);
+	for (int i = 1; i < threadCount; i++) {
+		chunks[i].begin = std::min(PgnReader::findGameStart(input, size * i / threadCount), size);
+		chunks[i].begin = std::max(chunks[i].begin, chunks[i - 1].begin);
+	}
+	for (int i = 0; i < threadCount; i++) {
+		chunks[i].end = i + 1 < threadCount ? chunks[i + 1].begin : size;
+	}
+
+	{
+		ThreadPool threadPool(threadCount);
+		std::vector<std::future<void>> futures;
+		for (int i = 0; i < threadCount; i++) {
+			futures.push_back(threadPool.submit([&, i] {
+				read(inputPath, chunks[i]);
+			}));
+		}
+		for (auto& future: futures) {
+			future.get();
+		}
+	}
+
+	Result result;
+	for (auto& chunk: chunks) {
+		result.games += chunk.result.games;
+		result.positions += chunk.result.positions;
+		result.errors += chunk.result.errors;
+	}
+	if (result.games > UINT32_MAX) {
+		throw std::runtime_error("Too many games in " + inputPath);
+	}
+
+	std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.gameCount = result.games;
+	header.entryCount = result.positions;
+	header.gamesOffset = sizeof(Header);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	uint64_t gamesSize = 0;
+	for (auto& chunk: chunks) {
+		output.write(reinterpret_cast<const char*>(chunk.games.data()),
+					 static_cast<std::streamsize>(chunk.games.size()));
+		gamesSize += chunk.games.size();
+	}
+
+	// Keep the tables aligned
+	uint64_t padding = (8 - (header.gamesOffset + gamesSize) % 8) % 8;
+	output.write("\0\0\0\0\0\0\0", static_cast<std::streamsize>(padding));
+	header.gameTableOffset = header.gamesOffset + gamesSize + padding;
+
+	std::vector<uint64_t> gameBases(chunks.size());
+	uint64_t gameBase = 0;
+	uint64_t byteBase = 0;
+	for (size_t i = 0; i < chunks.size(); i++) {
+		gameBases[i] = gameBase;
+		for (uint64_t offset: chunks[i].offsets) {
+			uint64_t globalOffset = byteBase + offset;
+			output.write(reinterpret_cast<const char*>(&globalOffset), sizeof(globalOffset));
+		}
+		gameBase += chunks[i].offsets.size();
+		byteBase += chunks[i].games.size();
+		std::vector<uint8_t>().swap(chunks[i].games);
+	}
+	header.indexOffset = header.gameTableOffset + result.games * sizeof(uint64_t);
+
+	// Merge the sorted entries of all chunks. Adding the first game number
+	// of a chunk keeps its entries sorted.
+	using Head = std::pair<Entry, size_t>;
+	auto isAfter = [](const Head& a, const Head& b) { return b.first < a.first; };
+	std::priority_queue<Head, std::vector<Head>, decltype(isAfter)> heads(isAfter);
+	std::vector<size_t> positions(chunks.size(), 0);
+	auto push = [&](size_t i) {
+		if (positions[i] < chunks[i].entries.size()) {
+			Entry entry = chunks[i].entries[positions[i]++];
+			entry.game = static_cast<uint32_t>(entry.game + gameBases[i]);
+			heads.push({entry, i});
+		}
+	};
+	for (size_t i = 0; i < chunks.size(); i++) {
+		push(i);
+	}
+
+	std::vector<Entry> buffer;
+	buffer.reserve(WRITE_SIZE);
+	while (!heads.empty()) {
+		Head head = heads.top();
+		heads.pop();
+		buffer.push_back(head.first);
+		push(head.second);
+
+		if (buffer.size() == WRITE_SIZE || heads.empty()) {
+			output.write(reinterpret_cast<const char*>(buffer.data()),
+						 static_cast<std::streamsize>(buffer.size() * sizeof(Entry)));
+			buffer.clear();
+		}
+	}
+
+	output.seekp(0);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.close();
+	if (!output) {
+		throw std::runtime_error("Cannot write " + outputPath);
+	}
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Games: " << result.games << std::endl;
+	std::cout << "Positions: " << result.positions << std::endl;
+	std::cout << "Errors: " << result.errors << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+
+	return result;
+}
+
+uint64_t GameDatabase::getGameCount() const {
+	return header->gameCount;
+}
+
+uint64_t GameDatabase::size() const {
+	return header->entryCount;
+}
+
+/**
+ * Returns the numbers of the games which reached the position in
+ * ascending order.
+ */
+std::vector<uint64_t> GameDatabase::findGames(const Position& position, uint64_t limit) const {
+	std::vector<uint64_t> games;
+
+	uint64_t key = Book::getKey(position);
+	const Entry* end = entries + header->entryCount;
+	for (const Entry* entry = findFirst(key); entry != end && entry->key == key && games.size() < limit; entry++) {
+		if (games.empty() || games.back() != entry->game) {
+			games.push_back(entry->game);
+		}
+	}
+
+	return games;
+}
+
+GameDatabase::Statistics GameDatabase::getStatistics(Position& position) const {
+	Statistics statistics;
+
+	// Count the results and the moves by their Polyglot encoding first
+	std::vector<Continuation> continuations;
+	uint64_t key = Book::getKey(position);
+	const Entry* end = entries + header->entryCount;
+	uint64_t lastGame = UINT64_MAX;
+	for (const Entry* entry = findFirst(key); entry != end && entry->key == key; entry++) {
+		if (entry->game == lastGame) {
+			continue;
+		}
+		lastGame = entry->game;
+
+		int result = getResult(entry->game);
+		statistics.games++;
+		statistics.whiteWins += result == PackedPosition::WHITEWINS;
+		statistics.draws += result == PackedPosition::DRAW;
+		statistics.blackWins += result == PackedPosition::BLACKWINS;
+		if (entry->move == 0) {
+			continue;
+		}
+
+		auto continuation = std::find_if(continuations.begin(), continuations.end(),
+										 [&](const Continuation& c) { return c.move == entry->move; });
+		if (continuation == continuations.end()) {
+			continuations.push_back({entry->move});
+			continuation = continuations.end() - 1;
+		}
+		continuation->games++;
+		continuation->whiteWins += result == PackedPosition::WHITEWINS;
+		continuation->draws += result == PackedPosition::DRAW;
+		continuation->blackWins += result == PackedPosition::BLACKWINS;
+	}
+
+	// Decode the moves in this position
+	MoveGenerator moveGenerator;
+	MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+	for (auto& continuation: continuations) {
+		for (int i = 0; i < moves.size; i++) {
+			if (Book::toPolyglotMove(moves.entries[i]->move) == continuation.move) {
+				continuation.move = moves.entries[i]->move;
+				statistics.continuations.push_back(continuation);
+				break;
+			}
+		}
+	}
+	std::stable_sort(statistics.continuations.begin(), statistics.continuations.end(),
+					 [](const Continuation& a, const Continuation& b) { return a.games > b.games; });
+
+	return statistics;
+}
+
+/**
+ * Decodes a game. The tags are not stored.
+ */
+Game GameDatabase::getGame(uint64_t number) const {
+	if (number >= header->gameCount) {
+		throw std::out_of_range("No game " + std::to_string(number));
+	}
+
+	const uint8_t* data = getGameData(number);
+	int moveCount = get<uint16_t>(data);
+	int flags = data[3];
+	data += GAME_HEADER_SIZE;
+
+	Game game;
+	game.result = getResult(number);
+	if ((flags & STARTPOSITION) != 0) {
+		game.position = get<PackedPosition>(data).unpack();
+		data += sizeof(PackedPosition);
+	} else {
+		game.position = notation::toPosition(notation::STANDARDPOSITION);
+	}
+
+	Position position = game.position;
+	MoveGenerator moveGenerator;
+	for (int i = 0; i < moveCount; i++) {
+		int polyglotMove = get<uint16_t>(data + 2 * i);
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		int move = move::NOMOVE;
+		for (int j = 0; j < moves.size; j++) {
+			if (Book::toPolyglotMove(moves.entries[j]->move) == polyglotMove) {
+				move = moves.entries[j]->move;
+				break;
+			}
+		}
+		if (move == move::NOMOVE) {
+			game.error = "Invalid move " + std::to_string(polyglotMove);
+			break;
+		}
+
+		game.moves.push_back(move);
+		position.makeMove(move);
+	}
+
+	return game;
+}
+
+/**
+ * Reads the games of a chunk. A game is stored as
+ *
+ *   uint16 number of moves, int8 result, uint8 flags,
+ *   a packed start position if the game has one,
+ *   uint16 Polyglot move for every move.
+ */
+void GameDatabase::read(const std::string& inputPath, Chunk& chunk) {
+	std::vector<char> buffer(BUFFER_SIZE);
+	std::ifstream input;
+	input.rdbuf()->pubsetbuf(buffer.data(), BUFFER_SIZE);
+	input.open(inputPath, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Cannot open " + inputPath);
+	}
+	input.seekg(static_cast<std::streamoff>(chunk.begin));
+
+	PgnReader reader(input, chunk.begin, chunk.end);
+	Game game;
+	while (reader.next(game)) {
+		// The moves before an error are still good
+		if (!game.error.empty()) {
+			chunk.result.errors++;
+		}
+
+		// Without its start position the game is meaningless
+		if (game.error.rfind("Illegal FEN", 0) == 0) {
+			continue;
+		}
+
+		bool hasStartPosition = !game.getTag("FEN").empty();
+		PackedPosition startPosition;
+		if (hasStartPosition) {
+			startPosition = PackedPosition::pack(game.position);
+		}
+
+		auto number = static_cast<uint32_t>(chunk.offsets.size());
+		chunk.offsets.push_back(chunk.games.size());
+		append(chunk.games, static_cast<uint16_t>(game.moves.size()));
+		append(chunk.games, static_cast<int8_t>(game.result));
+		append(chunk.games, static_cast<uint8_t>(hasStartPosition ? STARTPOSITION : 0));
+		if (hasStartPosition) {
+			append(chunk.games, startPosition);
+		}
+
+		Position position = game.position;
+		for (size_t ply = 0; ply <= game.moves.size(); ply++) {
+			int move = ply < game.moves.size() ? game.moves[ply] : move::NOMOVE;
+			auto polyglotMove = static_cast<uint16_t>(move == move::NOMOVE ? 0 : Book::toPolyglotMove(move));
+			chunk.entries.push_back({Book::getKey(position), number, static_cast<uint16_t>(ply), polyglotMove});
+			if (move != move::NOMOVE) {
+				append(chunk.games, polyglotMove);
+				position.makeMove(move);
+			}
+		}
+
+		chunk.result.games++;
+		chunk.result.positions += game.moves.size() + 1;
+	}
+
+	std::sort(chunk.entries.begin(), chunk.entries.end());
+}
+
+const GameDatabase::Entry* GameDatabase::findFirst(uint64_t key) const {
+	return std::lower_bound(entries, entries + header->entryCount, key,
+							[](const Entry& entry, uint64_t value) { return entry.key < value; });
+}
+
+const uint8_t* GameDatabase::getGameData(uint64_t number) const {
+	uint64_t offset = get<uint64_t>(mappedFile->data() + header->gameTableOffset + number * sizeof(uint64_t));
+	return mappedFile->data() + header->gamesOffset + offset;
+}
+
+int GameDatabase::getResult(uint64_t number) const {
+	return get<int8_t>(getGameData(number) + 2);
+}
+}
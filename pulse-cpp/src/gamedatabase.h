@@ -0,0 +1,120 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "pgn.h"
+#include "position.h"
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class is a database of games which we can search by position. The
+ * games are stored as sequences of 16-bit moves. The index holds one entry
+ * per position of every game, sorted by the Polyglot key of the position,
+ * so we find all games of a position with a binary search in the mapped
+ * file. Polyglot keys don't change between versions of the engine.
+ */
+class GameDatabase final {
+public:
+	static const uint32_t VERSION = 1;
+
+	class Continuation final {
+	public:
+		int move;
+		uint64_t games = 0;
+		uint64_t whiteWins = 0;
+		uint64_t draws = 0;
+		uint64_t blackWins = 0;
+	};
+
+	// Every game is counted once, even if it repeats the position
+	class Statistics final {
+	public:
+		uint64_t games = 0;
+		uint64_t whiteWins = 0;
+		uint64_t draws = 0;
+		uint64_t blackWins = 0;
+		// The most popular move first
+		std::vector<Continuation> continuations;
+	};
+
+	class Result final {
+	public:
+		uint64_t games = 0;
+		uint64_t positions = 0;
+		uint64_t errors = 0;
+	};
+
+	explicit GameDatabase(const std::string& path);
+
+	static Result build(const std::string& inputPath, const std::string& outputPath, int threadCount);
+
+	uint64_t getGameCount() const;
+
+	uint64_t size() const;
+
+	std::vector<uint64_t> findGames(const Position& position, uint64_t limit = UINT64_MAX) const;
+
+	Statistics getStatistics(Position& position) const;
+
+	Game getGame(uint64_t number) const;
+
+private:
+	class Header final {
+	public:
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+		uint64_t gameCount;
+		uint64_t entryCount;
+		uint64_t gamesOffset;
+		uint64_t gameTableOffset;
+		uint64_t indexOffset;
+	};
+
+	class Entry final {
+	public:
+		uint64_t key;
+		uint32_t game;
+		uint16_t ply;
+		// The Polyglot encoding of the move played, 0 after the last move
+		uint16_t move;
+
+		bool operator<(const Entry& entry) const;
+	};
+
+	// Every game starts with its number of moves, its result and flags
+	static const int GAME_HEADER_SIZE = 4;
+	static const int STARTPOSITION = 1;
+
+	class Chunk final {
+	public:
+		uint64_t begin = 0;
+		uint64_t end = 0;
+		std::vector<uint8_t> games;
+		std::vector<uint64_t> offsets;
+		std::vector<Entry> entries;
+		Result result;
+	};
+
+	std::unique_ptr<MappedFile> mappedFile;
+	const Header* header = nullptr;
+	const Entry* entries = nullptr;
+
+	static void read(const std::string& inputPath, Chunk& chunk);
+
+	const Entry* findFirst(uint64_t key) const;
+
+	const uint8_t* getGameData(uint64_t number) const;
+
+	int getResult(uint64_t number) const;
+};
+}
@@ -0,0 +1,335 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "generatedtable.h"
+#include "bitboard.h"
+#include "model/castling.h"
+#include "model/color.h"
+#include "model/piece.h"
+#include "model/piecetype.h"
+#include "model/square.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace pulse {
+
+const std::string GeneratedTable::EXTENSION = ".ptb";
+
+namespace {
+constexpr char MAGIC[8] = {'P', 'U', 'L', 'S', 'E', 'T', 'B', '\0'};
+
+// The letters of a table name in the order of their value
+const std::string LETTERS = "KQRBNP";
+constexpr std::array<int, 6> LETTER_TYPES = {
+		piecetype::KING, piecetype::QUEEN, piecetype::ROOK, piecetype::BISHOP, piecetype::KNIGHT, piecetype::PAWN
+};
+
+// The slots of the white king in the a1-d1-d4 triangle
+constexpr std::array<int, 64> TRIANGLE = {
+		0, 1, 2, 3, -1, -1, -1, -1,
+		-1, 4, 5, 6, -1, -1, -1, -1,
+		-1, -1, 7, 8, -1, -1, -1, -1,
+		-1, -1, -1, 9, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1
+};
+constexpr std::array<int, 10> TRIANGLE_SQUARES = {0, 1, 2, 3, 9, 10, 11, 18, 19, 27};
+
+/**
+ * Splits a name like KRPvKR into its sides. Returns false if the name is
+ * not valid.
+ */
+bool split(const std::string& name, std::string& first, std::string& second) {
+	if (Tablebases::getMaterialKey(name) == 0) {
+		return false;
+	}
+
+	size_t separator = name.find('v');
+	first = name.substr(0, separator);
+	second = name.substr(separator + 1);
+	return true;
+}
+
+int getMaterial(const std::string& side) {
+	int material = 0;
+	for (char letter: side) {
+		if (letter != 'K') {
+			material += piecetype::getValue(LETTER_TYPES[LETTERS.find(letter)]);
+		}
+	}
+	return material;
+}
+
+std::string sortSide(std::string side) {
+	std::sort(side.begin(), side.end(), [](char a, char b) { return LETTERS.find(a) < LETTERS.find(b); });
+	return side;
+}
+}
+
+GeneratedTable::GeneratedTable(const std::string& name, const uint8_t* values)
+		: name(name), values(values) {
+	std::string first;
+	std::string second;
+	if (!split(name, first, second) || first.size() + second.size() > MAX_PIECES) {
+		throw std::invalid_argument("Invalid table " + name);
+	}
+
+	pieces.push_back(piece::WHITE_KING);
+	pieces.push_back(piece::BLACK_KING);
+	for (int color: {color::WHITE, color::BLACK}) {
+		for (char letter: (color == color::WHITE ? first : second).substr(1)) {
+			int piecetype = LETTER_TYPES[LETTERS.find(letter)];
+			pieces.push_back(piece::valueOf(color, piecetype));
+			hasPawns = hasPawns || piecetype == piecetype::PAWN;
+		}
+	}
+
+	size = 2 * getKingSquares();
+	for (unsigned int i = 1; i < pieces.size(); i++) {
+		size *= 64;
+	}
+}
+
+const std::string& GeneratedTable::getName() const {
+	return name;
+}
+
+uint64_t GeneratedTable::getSize() const {
+	return size;
+}
+
+void GeneratedTable::setValues(const uint8_t* _values) {
+	values = _values;
+}
+
+/**
+ * Returns the index of the position, or NOINDEX if the pieces don't match
+ * the table. If flipped is true, black plays the first side of the name.
+ */
+uint64_t GeneratedTable::getIndex(const Position& position, bool flipped) const {
+	int first = flipped ? color::BLACK : color::WHITE;
+
+	std::array<std::array<uint64_t, piecetype::VALUES_SIZE>, color::VALUES_SIZE> remaining = position.pieces;
+	std::array<int, MAX_PIECES> squares;
+	for (unsigned int i = 0; i < pieces.size(); i++) {
+		int color = piece::getColor(pieces[i]) == color::WHITE ? first : color::opposite(first);
+		uint64_t& bitboard = remaining[color][piece::getType(pieces[i])];
+		if (bitboard == 0) {
+			return NOINDEX;
+		}
+
+		// Bitboards are indexed by rank * 8 + file
+		squares[i] = bitboard::numberOfTrailingZeros(bitboard) ^ (flipped ? 56 : 0);
+		bitboard = bitboard::remainder(bitboard);
+	}
+
+	// Move the white king into its part of the board
+	int file = squares[0] & 7;
+	int rank = squares[0] >> 3;
+	bool flipFile = file > 3;
+	bool flipRank = !hasPawns && rank > 3;
+	bool flipDiagonal = !hasPawns && (flipRank ? 7 - rank : rank) > (flipFile ? 7 - file : file);
+	for (unsigned int i = 0; i < pieces.size(); i++) {
+		int squareFile = flipFile ? 7 - (squares[i] & 7) : squares[i] & 7;
+		int squareRank = flipRank ? 7 - (squares[i] >> 3) : squares[i] >> 3;
+		squares[i] = flipDiagonal ? squareFile * 8 + squareRank : squareRank * 8 + squareFile;
+	}
+
+	uint64_t index = position.activeColor == first ? 0 : 1;
+	index = index * getKingSquares()
+			+ (hasPawns ? (squares[0] >> 3) * 4 + (squares[0] & 7) : TRIANGLE[squares[0]]);
+	for (unsigned int i = 1; i < pieces.size(); i++) {
+		index = index * 64 + squares[i];
+	}
+
+	return index;
+}
+
+/**
+ * Puts the pieces of the index onto the empty position and stores their
+ * squares. Returns false and leaves the position alone if the pieces cannot
+ * stand like that.
+ */
+bool GeneratedTable::setup(uint64_t index, Position& position, std::array<int, MAX_PIECES>& squares) const {
+	for (int i = static_cast<int>(pieces.size()) - 1; i > 0; i--) {
+		squares[i] = static_cast<int>(index % 64);
+		index /= 64;
+	}
+	int kingSlot = static_cast<int>(index % getKingSquares());
+	int side = static_cast<int>(index / getKingSquares());
+	squares[0] = hasPawns ? (kingSlot / 4) * 8 + kingSlot % 4 : TRIANGLE_SQUARES[kingSlot];
+
+	// The kings may not touch
+	if (std::abs((squares[0] & 7) - (squares[1] & 7)) <= 1 && std::abs((squares[0] >> 3) - (squares[1] >> 3)) <= 1) {
+		return false;
+	}
+	for (unsigned int i = 0; i < pieces.size(); i++) {
+		if (piece::getType(pieces[i]) == piecetype::PAWN && (squares[i] < 8 || squares[i] >= 56)) {
+			return false;
+		}
+		for (unsigned int j = 0; j < i; j++) {
+			if (squares[i] == squares[j]) {
+				return false;
+			}
+		}
+	}
+
+	for (unsigned int i = 0; i < pieces.size(); i++) {
+		squares[i] = square::valueOf(squares[i] & 7, squares[i] >> 3);
+		position.put(pieces[i], squares[i]);
+	}
+	position.setActiveColor(side == 0 ? color::WHITE : color::BLACK);
+
+	return true;
+}
+
+/**
+ * Returns the stored value of the position, or UNKNOWN if the table does
+ * not cover it.
+ */
+int GeneratedTable::getValue(const Position& position, bool flipped) const {
+	if (position.enPassantSquare != square::NOSQUARE || position.castlingRights != castling::NOCASTLING) {
+		return UNKNOWN;
+	}
+
+	uint64_t index = getIndex(position, flipped);
+	return index == NOINDEX ? +UNKNOWN : values[index];
+}
+
+bool GeneratedTable::probeWdl(const Position& position, bool flipped, int& wdl) const {
+	int value = getValue(position, flipped);
+	if (value == UNKNOWN) {
+		return false;
+	}
+
+	wdl = value == DRAW ? Tablebases::DRAW : (value < LOSS ? Tablebases::WIN : Tablebases::LOSS);
+	return true;
+}
+
+/**
+ * Returns the distance to mate in plies. It is never shorter than the
+ * distance to the next capture or pawn move.
+ */
+int GeneratedTable::probeDtz(const Position& position, bool flipped, int wdl, int& dtz) const {
+	int value = getValue(position, flipped);
+	if (value == UNKNOWN || value == LOSS) {
+		// We are checkmated. There is nothing to play for.
+		return Tablebases::NOTFOUND;
+	}
+
+	dtz = value == DRAW ? 0 : (value < LOSS ? 2 * value - 1 : 2 * (value - LOSS));
+	return Tablebases::FOUND;
+}
+
+bool GeneratedTable::isExact() const {
+	return true;
+}
+
+/**
+ * Returns the name with the stronger side first and the pieces of every
+ * side in the order KQRBNP.
+ */
+std::string GeneratedTable::getCanonicalName(const std::string& name) {
+	std::string first;
+	std::string second;
+	if (!split(name, first, second)) {
+		throw std::invalid_argument("Invalid table " + name);
+	}
+
+	first = sortSide(first);
+	second = sortSide(second);
+	if (getMaterial(second) > getMaterial(first)
+		|| (getMaterial(second) == getMaterial(first) && first.size() < second.size())
+		|| (getMaterial(second) == getMaterial(first) && first.size() == second.size() && second < first)) {
+		std::swap(first, second);
+	}
+	return first + "v" + second;
+}
+
+/**
+ * Returns true if neither side has the material to force a checkmate.
+ */
+bool GeneratedTable::isDrawn(const std::string& name) {
+	std::string first;
+	std::string second;
+	if (!split(name, first, second)) {
+		return false;
+	}
+
+	for (const std::string& side: {first, second}) {
+		if (side.find_first_of("QRP") != std::string::npos || side.size() > 2) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Returns the tables which we can reach by a capture or a promotion.
+ */
+std::vector<std::string> GeneratedTable::getSuccessors(const std::string& name) {
+	std::string first;
+	std::string second;
+	if (!split(name, first, second)) {
+		throw std::invalid_argument("Invalid table " + name);
+	}
+
+	std::vector<std::string> successors;
+	auto add = [&](const std::string& mover, const std::string& opponent) {
+		std::string successor = getCanonicalName(mover + "v" + opponent);
+		if (!isDrawn(successor) && std::find(successors.begin(), successors.end(), successor) == successors.end()) {
+			successors.push_back(successor);
+		}
+	};
+
+	for (int side = 0; side < 2; side++) {
+		const std::string& mover = side == 0 ? first : second;
+		const std::string& opponent = side == 0 ? second : first;
+
+		// Captures
+		for (size_t i = 1; i < opponent.size(); i++) {
+			add(mover, opponent.substr(0, i) + opponent.substr(i + 1));
+		}
+
+		// Promotions with and without a capture
+		size_t pawn = mover.find('P');
+		if (pawn != std::string::npos) {
+			for (char promotion: std::string("QRBN")) {
+				std::string promoted = mover;
+				promoted[pawn] = promotion;
+				add(promoted, opponent);
+				for (size_t i = 1; i < opponent.size(); i++) {
+					add(promoted, opponent.substr(0, i) + opponent.substr(i + 1));
+				}
+			}
+		}
+	}
+
+	return successors;
+}
+
+GeneratedTable::Header GeneratedTable::createHeader(const std::string& name) {
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.pieceCount = static_cast<uint32_t>(name.size() - 1);
+	std::strncpy(header.name, name.c_str(), sizeof(header.name) - 1);
+	return header;
+}
+
+bool GeneratedTable::isValid(const Header& header, const std::string& name) {
+	return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION
+		   && std::string(header.name, strnlen(header.name, sizeof(header.name))) == name;
+}
+
+uint64_t GeneratedTable::getKingSquares() const {
+	return hasPawns ? 32 : 10;
+}
+}
@@ -0,0 +1,90 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "tablebases.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class is an endgame table built by our tablebase generator. It
+ * stores one byte per position with the distance to mate. The first side
+ * of the name plays white. Without pawns, the white king is mapped into
+ * the a1-d1-d4 triangle, with pawns onto the files a-d. Positions with en
+ * passant or castling rights are not covered.
+ */
+class GeneratedTable final : public Tablebases::Table {
+public:
+	static const int MAX_PIECES = 5;
+
+	// A win in n moves is stored as n, a loss in n moves as LOSS + n
+	static const int DRAW = 0;
+	static const int LOSS = 128;
+	static const int MAX_MOVES = 126;
+
+	// Only used while generating
+	static const int UNKNOWN = 255;
+
+	static const uint64_t NOINDEX = UINT64_MAX;
+
+	static const uint32_t VERSION = 1;
+
+	class Header final {
+	public:
+		char magic[8];
+		uint32_t version;
+		uint32_t pieceCount;
+		char name[16];
+	};
+
+	static const std::string EXTENSION;
+
+	explicit GeneratedTable(const std::string& name, const uint8_t* values = nullptr);
+
+	const std::string& getName() const;
+
+	uint64_t getSize() const;
+
+	void setValues(const uint8_t* _values);
+
+	uint64_t getIndex(const Position& position, bool flipped) const;
+
+	bool setup(uint64_t index, Position& position, std::array<int, MAX_PIECES>& squares) const;
+
+	int getValue(const Position& position, bool flipped) const;
+
+	bool probeWdl(const Position& position, bool flipped, int& wdl) const override;
+
+	int probeDtz(const Position& position, bool flipped, int wdl, int& dtz) const override;
+
+	bool isExact() const override;
+
+	static std::string getCanonicalName(const std::string& name);
+
+	static bool isDrawn(const std::string& name);
+
+	static std::vector<std::string> getSuccessors(const std::string& name);
+
+	static Header createHeader(const std::string& name);
+
+	static bool isValid(const Header& header, const std::string& name);
+
+private:
+	std::string name;
+
+	// The pieces in index order. The kings come first.
+	std::vector<int> pieces;
+	bool hasPawns = false;
+	uint64_t size = 0;
+	const uint8_t* values = nullptr;
+
+	uint64_t getKingSquares() const;
+};
+}
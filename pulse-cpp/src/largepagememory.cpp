@@ -0,0 +1,137 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "largepagememory.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace pulse {
+namespace {
+uint64_t roundUp(uint64_t size, uint64_t alignment) {
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+#if defined(__linux__)
+bool isTransparentHugePagesEnabled() {
+	// The kernel ignores our advice if transparent huge pages are disabled
+	std::ifstream input("/sys/kernel/mm/transparent_hugepage/enabled");
+	std::string line;
+	return std::getline(input, line) && line.find("[never]") == std::string::npos;
+}
+#endif
+}
+
+#ifdef _WIN32
+
+LargePageMemory::LargePageMemory(uint64_t size)
+		: length(size) {
+	// Large pages need the "Lock pages in memory" privilege. Without it
+	// VirtualAlloc fails and we use normal pages.
+	SIZE_T largePageSize = GetLargePageMinimum();
+	if (largePageSize > 0) {
+		allocatedLength = roundUp(size, largePageSize);
+		address = static_cast<uint8_t*>(VirtualAlloc(nullptr, allocatedLength,
+				MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+		kind = EXPLICIT;
+	}
+
+	if (address == nullptr) {
+		allocatedLength = roundUp(size, CACHE_LINE_SIZE);
+		address = static_cast<uint8_t*>(VirtualAlloc(nullptr, allocatedLength,
+				MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		kind = NORMAL;
+	}
+
+	if (address == nullptr) {
+		throw std::bad_alloc();
+	}
+}
+
+LargePageMemory::~LargePageMemory() {
+	VirtualFree(address, 0, MEM_RELEASE);
+}
+
+#else
+
+LargePageMemory::LargePageMemory(uint64_t size)
+		: length(size) {
+#if defined(__linux__)
+	// Explicit huge pages are only available if they have been reserved
+	allocatedLength = roundUp(size, LARGE_PAGE_SIZE);
+	void* mapping = mmap(nullptr, allocatedLength, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mapping != MAP_FAILED) {
+		address = static_cast<uint8_t*>(mapping);
+		kind = EXPLICIT;
+		return;
+	}
+
+	// Align to the huge page size, so the kernel can back the whole table
+	// with huge pages.
+	address = static_cast<uint8_t*>(std::aligned_alloc(LARGE_PAGE_SIZE, allocatedLength));
+	if (address != nullptr) {
+		if (isTransparentHugePagesEnabled() && madvise(address, allocatedLength, MADV_HUGEPAGE) == 0) {
+			kind = TRANSPARENT;
+		}
+		std::memset(address, 0, allocatedLength);
+		return;
+	}
+#endif
+
+	allocatedLength = roundUp(size, CACHE_LINE_SIZE);
+	address = static_cast<uint8_t*>(std::aligned_alloc(CACHE_LINE_SIZE, allocatedLength));
+	if (address == nullptr) {
+		throw std::bad_alloc();
+	}
+	std::memset(address, 0, allocatedLength);
+	kind = NORMAL;
+}
+
+LargePageMemory::~LargePageMemory() {
+#if defined(__linux__)
+	if (kind == EXPLICIT) {
+		munmap(address, allocatedLength);
+		return;
+	}
+#endif
+	std::free(address);
+}
+
+#endif
+
+uint8_t* LargePageMemory::data() const {
+	return address;
+}
+
+uint64_t LargePageMemory::size() const {
+	return length;
+}
+
+int LargePageMemory::getKind() const {
+	return kind;
+}
+
+std::string LargePageMemory::toString(int kind) {
+	switch (kind) {
+		case NORMAL:
+			return "normal pages";
+		case TRANSPARENT:
+			return "transparent huge pages";
+		case EXPLICIT:
+			return "huge pages";
+		default:
+			throw std::exception();
+	}
+}
+}
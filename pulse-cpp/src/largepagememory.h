@@ -0,0 +1,51 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace pulse {
+
+/**
+ * This class allocates zeroed memory for big, long-lived tables. Random
+ * probes into multi-gigabyte tables miss the TLB a lot, so we try to get
+ * huge pages first and fall back to normal pages aligned to a cache line.
+ */
+class LargePageMemory final {
+public:
+	// Normal pages
+	static const int NORMAL = 0;
+	// Normal pages, which the kernel may promote to huge pages
+	static const int TRANSPARENT = 1;
+	// Huge pages reserved by the system administrator
+	static const int EXPLICIT = 2;
+
+	explicit LargePageMemory(uint64_t size);
+
+	LargePageMemory(const LargePageMemory&) = delete;
+
+	LargePageMemory& operator=(const LargePageMemory&) = delete;
+
+	~LargePageMemory();
+
+	uint8_t* data() const;
+
+	uint64_t size() const;
+
+	int getKind() const;
+
+	static std::string toString(int kind);
+
+private:
+	static const uint64_t CACHE_LINE_SIZE = 64;
+	static const uint64_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	uint8_t* address = nullptr;
+	uint64_t length = 0;
+	uint64_t allocatedLength = 0;
+	int kind = NORMAL;
+};
+}
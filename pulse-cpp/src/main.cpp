@@ -5,22 +5,405 @@
 
 #include "pulse.h"
 #include "perft.h"
+#include "bench.h"
+#include "scaling.h"
+#include "suite.h"
+#include "pgnconverter.h"
+#include "selfplay.h"
+#include "datasetfilter.h"
+#include "tablebasegenerator.h"
+#include "gamedatabase.h"
+#include "match.h"
+#include "notation.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 void printUsage() {
-	std::cerr << "Usage: pulse-cpp [perft]" << std::endl;
+	std::cerr << "Usage: pulse-cpp [perft [depth] [counters] | bench [depth] [counters] | smp [threads]" << std::endl;
+	std::cerr << "                 | suite <file> [movetime <ms> | nodes <nodes>] [threads <threads>]" << std::endl;
+	std::cerr << "                 | pgn2bin <pgn file> <output file> [threads <threads>]" << std::endl;
+	std::cerr << "                 | selfplay <output file> [games <games>] [nodes <nodes> | depth <depth>]" << std::endl;
+	std::cerr << "                   [threads <threads>] [seed <seed>]" << std::endl;
+	std::cerr << "                 | filter <input file> <output file> [memory <mb>] [threads <threads>]" << std::endl;
+	std::cerr << "                   [minply <ply>] [maxply <ply>] [maxscore <cp>] [nocheck] [nocapture]" << std::endl;
+	std::cerr << "                 | tbgen <directory> <table>... [threads <threads>] [memory <mb>]" << std::endl;
+	std::cerr << "                 | gamedb build <pgn file> <database> [threads <threads>]" << std::endl;
+	std::cerr << "                 | gamedb query <database> <fen> [games <games>]" << std::endl;
+	std::cerr << "                 | match <options> <options> [games <games>] [openings <file>]" << std::endl;
+	std::cerr << "                   [nodes <nodes> | depth <depth> | tc <ms>+<increment>] [threads <threads>]" << std::endl;
+	std::cerr << "                   [sprt <elo0> <elo1>]]" << std::endl;
+}
+
+int runSuite(int argc, char* argv[]) {
+	uint64_t searchTime = pulse::Suite::DEFAULT_TIME;
+	uint64_t searchNodes = 0;
+	int threads = 1;
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string name(argv[i]);
+		try {
+			if (name == "movetime") {
+				searchTime = std::stoull(argv[i + 1]);
+			} else if (name == "nodes") {
+				searchNodes = std::stoull(argv[i + 1]);
+			} else if (name == "threads") {
+				threads = std::stoi(argv[i + 1]);
+			} else {
+				printUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			printUsage();
+			return 1;
+		}
+	}
+	if (argc % 2 == 0 || searchTime < 1 || threads < 1) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		std::unique_ptr<pulse::Suite> suite(new pulse::Suite());
+		suite->run(argv[2], searchTime, searchNodes, threads);
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int runPgnConverter(int argc, char* argv[]) {
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	if (argc == 6 && std::string(argv[4]) == "threads") {
+		try {
+			threads = std::stoi(argv[5]);
+		} catch (std::exception&) {
+			threads = 0;
+		}
+	}
+	if ((argc != 4 && argc != 6) || threads < 1) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		std::unique_ptr<pulse::PgnConverter> pgnConverter(new pulse::PgnConverter());
+		pgnConverter->run(argv[2], argv[3], threads);
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int runSelfPlay(int argc, char* argv[]) {
+	int games = 100;
+	int searchDepth = 0;
+	uint64_t searchNodes = pulse::SelfPlay::DEFAULT_NODES;
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	uint64_t seed = 0;
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string name(argv[i]);
+		try {
+			if (name == "games") {
+				games = std::stoi(argv[i + 1]);
+			} else if (name == "nodes") {
+				searchNodes = std::stoull(argv[i + 1]);
+			} else if (name == "depth") {
+				searchDepth = std::stoi(argv[i + 1]);
+			} else if (name == "threads") {
+				threads = std::stoi(argv[i + 1]);
+			} else if (name == "seed") {
+				seed = std::stoull(argv[i + 1]);
+			} else {
+				printUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			printUsage();
+			return 1;
+		}
+	}
+	if (argc % 2 == 0 || games < 1 || searchDepth < 0 || searchDepth > pulse::depth::MAX_DEPTH || searchNodes < 1
+		|| threads < 1) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		std::unique_ptr<pulse::SelfPlay> selfPlay(new pulse::SelfPlay());
+		selfPlay->run(argv[2], games, searchDepth, searchNodes, threads, seed);
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int runDatasetFilter(int argc, char* argv[]) {
+	pulse::DatasetFilter::Criteria criteria;
+	uint64_t memory = pulse::DatasetFilter::DEFAULT_MEMORY;
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	for (int i = 4; i < argc; i++) {
+		std::string name(argv[i]);
+		try {
+			if (name == "nocheck") {
+				criteria.skipCheck = true;
+			} else if (name == "nocapture") {
+				criteria.skipCapture = true;
+			} else if (i + 1 >= argc) {
+				printUsage();
+				return 1;
+			} else if (name == "memory") {
+				memory = std::stoull(argv[++i]) * 1024 * 1024;
+			} else if (name == "threads") {
+				threads = std::stoi(argv[++i]);
+			} else if (name == "minply") {
+				criteria.minPly = std::stoi(argv[++i]);
+			} else if (name == "maxply") {
+				criteria.maxPly = std::stoi(argv[++i]);
+			} else if (name == "maxscore") {
+				criteria.maxScore = std::stoi(argv[++i]);
+			} else {
+				printUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			printUsage();
+			return 1;
+		}
+	}
+	if (memory < 1 || threads < 1) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		std::unique_ptr<pulse::DatasetFilter> datasetFilter(new pulse::DatasetFilter());
+		datasetFilter->run(argv[2], argv[3], criteria, memory, threads);
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int runTablebaseGenerator(int argc, char* argv[]) {
+	std::vector<std::string> names;
+	uint64_t memory = pulse::TablebaseGenerator::DEFAULT_MEMORY;
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	for (int i = 3; i < argc; i++) {
+		std::string name(argv[i]);
+		try {
+			if (name == "threads" && i + 1 < argc) {
+				threads = std::stoi(argv[++i]);
+			} else if (name == "memory" && i + 1 < argc) {
+				memory = std::stoull(argv[++i]) * 1024 * 1024;
+			} else {
+				names.push_back(name);
+			}
+		} catch (std::exception&) {
+			printUsage();
+			return 1;
+		}
+	}
+	if (names.empty() || memory < 1 || threads < 1) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		std::unique_ptr<pulse::TablebaseGenerator> tablebaseGenerator(new pulse::TablebaseGenerator());
+		tablebaseGenerator->run(argv[2], names, threads, memory);
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int runGameDatabase(int argc, char* argv[]) {
+	std::string command(argv[2]);
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	uint64_t games = 10;
+	bool isValid = argc == 5 && (command == "build" || command == "query");
+	if (argc == 7) {
+		std::string name(argv[5]);
+		try {
+			if (command == "build" && name == "threads") {
+				threads = std::stoi(argv[6]);
+				isValid = true;
+			} else if (command == "query" && name == "games") {
+				games = std::stoull(argv[6]);
+				isValid = true;
+			}
+		} catch (std::exception&) {
+			isValid = false;
+		}
+	}
+	if (!isValid || threads < 1) {
+		printUsage();
+		return 1;
+	}
+
+	try {
+		if (command == "build") {
+			pulse::GameDatabase::build(argv[3], argv[4], threads);
+			return 0;
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+		pulse::GameDatabase gameDatabase(argv[3]);
+		pulse::Position position = pulse::notation::toPosition(argv[4]);
+		pulse::GameDatabase::Statistics statistics = gameDatabase.getStatistics(position);
+		std::vector<uint64_t> numbers = gameDatabase.findGames(position, games);
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - startTime).count();
+
+		std::cout << "Games: " << statistics.games << " (+" << statistics.whiteWins << " =" << statistics.draws
+				  << " -" << statistics.blackWins << ")" << std::endl;
+		for (auto& continuation: statistics.continuations) {
+			std::cout << pulse::notation::fromMove(position, continuation.move) << ": " << continuation.games
+					  << " (+" << continuation.whiteWins << " =" << continuation.draws << " -"
+					  << continuation.blackWins << ")" << std::endl;
+		}
+		std::cout << "First games:";
+		for (uint64_t number: numbers) {
+			std::cout << " " << number;
+		}
+		std::cout << std::endl;
+		std::cout << "Time: " << duration / 1000.0 << " ms" << std::endl;
+	} catch (std::invalid_argument&) {
+		std::cerr << "Invalid position " << argv[4] << std::endl;
+		return 1;
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+int runMatch(int argc, char* argv[]) {
+	int games = 1000;
+	std::string openingsPath;
+	pulse::Match::Limits limits;
+	pulse::Match::Sprt sprt;
+	int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+	int i = 4;
+	for (; i + 1 < argc; i += 2) {
+		std::string name(argv[i]);
+		try {
+			if (name == "games") {
+				games = std::stoi(argv[i + 1]);
+			} else if (name == "openings") {
+				openingsPath = argv[i + 1];
+			} else if (name == "nodes") {
+				limits.nodes = std::stoull(argv[i + 1]);
+			} else if (name == "depth") {
+				limits.depth = std::stoi(argv[i + 1]);
+			} else if (name == "tc") {
+				std::string value(argv[i + 1]);
+				size_t separator = value.find('+');
+				limits.time = std::stoull(value.substr(0, separator));
+				limits.increment = separator == std::string::npos ? 0 : std::stoull(value.substr(separator + 1));
+			} else if (name == "threads") {
+				threads = std::stoi(argv[i + 1]);
+			} else if (name == "sprt" && i + 2 < argc) {
+				sprt.elo0 = std::stod(argv[i + 1]);
+				sprt.elo1 = std::stod(argv[i + 2]);
+				i++;
+			} else {
+				printUsage();
+				return 1;
+			}
+		} catch (std::exception&) {
+			printUsage();
+			return 1;
+		}
+	}
+	if (i != argc || games < 1 || limits.depth < 0 || limits.depth > pulse::depth::MAX_DEPTH || threads < 1
+		|| sprt.elo1 <= sprt.elo0) {
+		printUsage();
+		return 1;
+	}
+	if (limits.depth == 0 && limits.nodes == 0 && limits.time == 0) {
+		limits.nodes = pulse::SelfPlay::DEFAULT_NODES;
+	}
+
+	try {
+		pulse::Match::Engine first = pulse::Match::Engine::parse(argv[2]);
+		pulse::Match::Engine second = pulse::Match::Engine::parse(argv[3]);
+		std::vector<pulse::Position> openings = openingsPath.empty()
+												? pulse::Match::createOpenings((games + 1) / 2, 0)
+												: pulse::Match::loadOpenings(openingsPath);
+
+		std::unique_ptr<pulse::Match> match(new pulse::Match());
+		match->run(first, second, openings, games, limits, sprt, threads);
+	} catch (std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	} catch (std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
 }
 
 int main(int argc, char* argv[]) {
 	if (argc == 1) {
 		std::unique_ptr<pulse::Pulse> pulse(new pulse::Pulse());
 		pulse->run();
-	} else if (argc == 2) {
+	} else if (std::string(argv[1]) == "suite" && argc >= 3) {
+		return runSuite(argc, argv);
+	} else if (std::string(argv[1]) == "pgn2bin" && argc >= 4) {
+		return runPgnConverter(argc, argv);
+	} else if (std::string(argv[1]) == "selfplay" && argc >= 3) {
+		return runSelfPlay(argc, argv);
+	} else if (std::string(argv[1]) == "filter" && argc >= 4) {
+		return runDatasetFilter(argc, argv);
+	} else if (std::string(argv[1]) == "tbgen" && argc >= 4) {
+		return runTablebaseGenerator(argc, argv);
+	} else if (std::string(argv[1]) == "gamedb" && argc >= 5) {
+		return runGameDatabase(argc, argv);
+	} else if (std::string(argv[1]) == "match" && argc >= 4) {
+		return runMatch(argc, argv);
+	} else if (argc <= 4) {
 		std::string token(argv[1]);
+		int depth = 0;
+		bool useCounters = false;
+		for (int i = 2; i < argc; i++) {
+			std::string argument(argv[i]);
+			if (argument == "counters") {
+				useCounters = true;
+			} else {
+				try {
+					depth = std::stoi(argument);
+				} catch (std::exception&) {
+					printUsage();
+					return 1;
+				}
+			}
+		}
+
+		// Our move generators and plies end somewhere
+		if (depth < 0
+			|| (token == "perft" && depth > pulse::Perft::MAX_DEPTH)
+			|| (token == "bench" && depth > pulse::depth::MAX_DEPTH)) {
+			printUsage();
+			return 1;
+		}
+
 		if (token == "perft") {
 			std::unique_ptr<pulse::Perft> perft(new pulse::Perft());
-			perft->run();
+			perft->run(depth > 0 ? depth : +pulse::Perft::MAX_DEPTH, useCounters);
+		} else if (token == "bench") {
+			std::unique_ptr<pulse::Bench> bench(new pulse::Bench());
+			bench->run(depth > 0 ? depth : +pulse::Bench::DEFAULT_DEPTH, useCounters);
+		} else if (token == "smp") {
+			std::unique_ptr<pulse::Scaling> scaling(new pulse::Scaling());
+			scaling->run(depth > 0 ? depth : std::max<int>(std::thread::hardware_concurrency(), 1));
 		} else {
 			printUsage();
 			return 1;
@@ -0,0 +1,134 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "mappedfile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pulse {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path, int mode, uint64_t size) {
+	HANDLE file = CreateFileA(path.c_str(),
+			mode == READWRITE ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+			mode == READWRITE ? OPEN_ALWAYS : OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Cannot open " + path);
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		throw std::runtime_error("Cannot read size of " + path);
+	}
+
+	if (size > 0 && mode == READWRITE && static_cast<uint64_t>(fileSize.QuadPart) != size) {
+		fileSize.QuadPart = static_cast<LONGLONG>(size);
+		if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+			CloseHandle(file);
+			throw std::runtime_error("Cannot resize " + path);
+		}
+	}
+	length = static_cast<uint64_t>(fileSize.QuadPart);
+
+	if (length > 0) {
+		DWORD protection = mode == READONLY ? PAGE_READONLY : (mode == READWRITE ? PAGE_READWRITE : PAGE_WRITECOPY);
+		HANDLE mapping = CreateFileMappingA(file, nullptr, protection, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			DWORD access = mode == READONLY ? FILE_MAP_READ : (mode == READWRITE ? FILE_MAP_WRITE : FILE_MAP_COPY);
+			address = static_cast<uint8_t*>(MapViewOfFile(mapping, access, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+
+	if (length > 0 && address == nullptr) {
+		throw std::runtime_error("Cannot map " + path);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (address != nullptr) {
+		UnmapViewOfFile(address);
+	}
+}
+
+void MappedFile::sync() {
+	if (address != nullptr) {
+		FlushViewOfFile(address, 0);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path, int mode, uint64_t size) {
+	int fd = ::open(path.c_str(), mode == READWRITE ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("Cannot open " + path);
+	}
+
+	struct stat status{};
+	if (fstat(fd, &status) != 0) {
+		::close(fd);
+		throw std::runtime_error("Cannot read size of " + path);
+	}
+
+	length = static_cast<uint64_t>(status.st_size);
+	if (size > 0 && mode == READWRITE && length != size) {
+		if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+			::close(fd);
+			throw std::runtime_error("Cannot resize " + path);
+		}
+		length = size;
+	}
+
+	if (length > 0) {
+		int protection = mode == READONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+		void* mapping = mmap(nullptr, length, protection, mode == READWRITE ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			address = static_cast<uint8_t*>(mapping);
+		}
+	}
+	::close(fd);
+
+	if (length > 0 && address == nullptr) {
+		throw std::runtime_error("Cannot map " + path);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (address != nullptr) {
+		munmap(address, length);
+	}
+}
+
+void MappedFile::sync() {
+	if (address != nullptr) {
+		msync(address, length, MS_SYNC);
+	}
+}
+
+#endif
+
+uint8_t* MappedFile::data() const {
+	return address;
+}
+
+uint64_t MappedFile::size() const {
+	return length;
+}
+}
@@ -0,0 +1,47 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace pulse {
+
+/**
+ * This class maps a file into memory. The mapping is released when the
+ * object is destroyed.
+ */
+class MappedFile final {
+public:
+	// The file is mapped read-only.
+	static const int READONLY = 0;
+	// The file is created if necessary and changes are written back.
+	static const int READWRITE = 1;
+	// Changes stay private to this process and are never written back.
+	static const int COPYONWRITE = 2;
+
+	/**
+	 * Maps the file at path. If size is not zero and the file is opened
+	 * READWRITE, the file is resized to size bytes first.
+	 */
+	MappedFile(const std::string& path, int mode, uint64_t size = 0);
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile();
+
+	uint8_t* data() const;
+
+	uint64_t size() const;
+
+	void sync();
+
+private:
+	uint8_t* address = nullptr;
+	uint64_t length = 0;
+};
+}
@@ -0,0 +1,448 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "match.h"
+#include "notation.h"
+#include "selfplay.h"
+#include "threadpool.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace pulse {
+
+namespace {
+double toElo(double score) {
+	if (score <= 0) {
+		return -std::numeric_limits<double>::infinity();
+	} else if (score >= 1) {
+		return std::numeric_limits<double>::infinity();
+	}
+	return 400 * std::log10(score / (1 - score));
+}
+
+double toScore(double elo) {
+	return 1 / (1 + std::pow(10, -elo / 400));
+}
+
+/**
+ * Returns the variance of the score of a single game.
+ */
+double getVariance(uint64_t wins, uint64_t draws, uint64_t losses) {
+	double games = static_cast<double>(wins + draws + losses);
+	double score = (wins + draws / 2.0) / games;
+	return (wins * (1 - score) * (1 - score) + draws * (0.5 - score) * (0.5 - score) + losses * score * score)
+		   / games;
+}
+}
+
+Match::Engine Match::Engine::parse(const std::string& options) {
+	Engine engine;
+	engine.name = options;
+	if (options == "default") {
+		return engine;
+	}
+
+	std::istringstream input(options);
+	std::string option;
+	while (std::getline(input, option, ',')) {
+		size_t separator = option.find('=');
+		if (separator == std::string::npos) {
+			throw std::invalid_argument("Missing value of " + option);
+		}
+
+		std::string name = option.substr(0, separator);
+		std::string value = option.substr(separator + 1);
+		if (name == "Hash") {
+			engine.hashSize = std::stoull(value);
+		} else if (name == "SearchMode" && value == "AlphaBeta") {
+			engine.searchMode = ALPHABETA;
+		} else if (name == "SearchMode" && value == "MonteCarlo") {
+			engine.searchMode = MONTECARLO;
+		} else if (name == "Threads") {
+			engine.threads = std::stoi(value);
+		} else if (name == "SyzygyPath") {
+			engine.tablebasePath = value;
+		} else {
+			throw std::invalid_argument("Unknown option " + option);
+		}
+	}
+
+	if (engine.hashSize < 1 || engine.threads < 1 || engine.threads > MonteCarloSearch::MAX_THREADS) {
+		throw std::invalid_argument("Invalid options " + options);
+	}
+	return engine;
+}
+
+double Match::Sprt::getLowerBound() const {
+	return std::log(beta / (1 - alpha));
+}
+
+double Match::Sprt::getUpperBound() const {
+	return std::log((1 - beta) / alpha);
+}
+
+/**
+ * Returns the log-likelihood ratio of elo1 against elo0. We approximate the
+ * distribution of the score with a normal distribution of the same
+ * variance as our results.
+ */
+double Match::Sprt::getLlr(uint64_t wins, uint64_t draws, uint64_t losses) const {
+	if (wins + losses == 0) {
+		return 0;
+	}
+
+	double games = static_cast<double>(wins + draws + losses);
+	double score = (wins + draws / 2.0) / games;
+	double variance = getVariance(wins, draws, losses);
+	if (variance <= 0) {
+		return 0;
+	}
+
+	double score0 = toScore(elo0);
+	double score1 = toScore(elo1);
+	return games * (score1 - score0) * (2 * score - score0 - score1) / (2 * variance);
+}
+
+uint64_t Match::Result::getGames() const {
+	return wins + draws + losses;
+}
+
+double Match::Result::getScore() const {
+	return getGames() == 0 ? 0.5 : (wins + draws / 2.0) / static_cast<double>(getGames());
+}
+
+double Match::Result::getElo() const {
+	return toElo(getScore());
+}
+
+double Match::Result::getEloError() const {
+	if (getGames() == 0) {
+		return std::numeric_limits<double>::infinity();
+	}
+
+	double error = 1.96 * std::sqrt(getVariance(wins, draws, losses) / static_cast<double>(getGames()));
+	return (toElo(getScore() + error) - toElo(getScore() - error)) / 2;
+}
+
+std::string Match::Result::toString() const {
+	std::ostringstream output;
+	output << std::fixed << std::setprecision(1);
+	output << "Games " << getGames() << ": +" << wins << " =" << draws << " -" << losses;
+	output << ", Elo " << getElo() << " +/- " << getEloError();
+	output << std::setprecision(2) << ", LLR " << llr;
+	return output.str();
+}
+
+/**
+ * Reads the openings from a file with one FEN or EPD position per line.
+ * Operations after the position are ignored.
+ */
+std::vector<Position> Match::loadOpenings(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Cannot open " + path);
+	}
+
+	std::vector<Position> openings;
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream input(line);
+		std::string fen;
+		std::string field;
+		for (int i = 0; i < 4 && input >> field; i++) {
+			fen += (i > 0 ? " " : "") + field;
+		}
+		try {
+			openings.push_back(notation::toPosition(fen));
+		} catch (std::exception& e) {
+			std::cerr << path << ":" << lineNumber << ": " << e.what() << std::endl;
+		}
+	}
+
+	if (openings.empty()) {
+		throw std::runtime_error("No openings in " + path);
+	}
+	return openings;
+}
+
+/**
+ * Returns openings of random legal moves from the start position, so we
+ * can play a match without an opening suite.
+ */
+std::vector<Position> Match::createOpenings(int count, uint64_t seed) {
+	MoveGenerator moveGenerator;
+	Position start = notation::toPosition(notation::STANDARDPOSITION);
+
+	std::vector<Position> openings;
+	for (int i = 0; i < count; i++) {
+		std::mt19937_64 random(seed + static_cast<uint64_t>(i));
+		Position position = start;
+		for (int ply = 0; ply < SelfPlay::RANDOM_PLIES; ply++) {
+			MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+			if (moves.size == 0) {
+				// The game is over already, so we start over
+				position = start;
+				ply = -1;
+				continue;
+			}
+
+			std::uniform_int_distribution<int> distribution(0, moves.size - 1);
+			position.makeMove(moves.entries[distribution(random)]->move);
+		}
+		openings.push_back(position);
+	}
+	return openings;
+}
+
+Match::Result Match::run(const Engine& first, const Engine& second, const std::vector<Position>& openings,
+						 int games, const Limits& limits, const Sprt& sprt, int threadCount) {
+	if (openings.empty()) throw std::exception();
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	Result result;
+	{
+		ThreadPool threadPool(threadCount);
+		std::vector<std::future<void>> futures;
+		for (int i = 0; i < threadCount; i++) {
+			futures.push_back(threadPool.submit([&] {
+				auto firstPlayer = std::make_unique<Player>(first);
+				auto secondPlayer = std::make_unique<Player>(second);
+				for (int game = nextGame++; game < games && !stopped; game = nextGame++) {
+					// Both games of a pair start from the same opening
+					const Position& opening = openings[(game / 2) % openings.size()];
+					bool firstIsWhite = game % 2 == 0;
+					Outcome outcome = firstIsWhite
+									  ? play(*firstPlayer, *secondPlayer, opening, limits)
+									  : play(*secondPlayer, *firstPlayer, opening, limits);
+					int score = firstIsWhite ? outcome.result : -outcome.result;
+
+					std::unique_lock<std::mutex> lock(mutex);
+					if (score > 0) {
+						result.wins++;
+					} else if (score < 0) {
+						result.losses++;
+					} else {
+						result.draws++;
+					}
+					result.timeLosses += outcome.isTimeLoss;
+
+					result.llr = sprt.getLlr(result.wins, result.draws, result.losses);
+					if (result.verdict == UNDECIDED && result.llr >= sprt.getUpperBound()) {
+						result.verdict = H1;
+						stopped = true;
+					} else if (result.verdict == UNDECIDED && result.llr <= sprt.getLowerBound()) {
+						result.verdict = H0;
+						stopped = true;
+					}
+
+					if (result.getGames() % PROGRESS_GAMES == 0) {
+						std::cout << result.toString() << std::endl;
+					}
+				}
+			}));
+		}
+		for (auto& future: futures) {
+			future.get();
+		}
+	}
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << first.name << " vs " << second.name << std::endl;
+	std::cout << "Games: " << result.getGames() << std::endl;
+	std::cout << "Wins: " << result.wins << std::endl;
+	std::cout << "Draws: " << result.draws << std::endl;
+	std::cout << "Losses: " << result.losses << std::endl;
+	std::cout << "Time losses: " << result.timeLosses << std::endl;
+	std::cout << "Elo: " << result.getElo() << " +/- " << result.getEloError() << std::endl;
+	std::cout << std::setprecision(2);
+	std::cout << "LLR: " << result.llr << " (" << sprt.getLowerBound() << ", " << sprt.getUpperBound() << ")"
+			  << std::defaultfloat << " for elo " << sprt.elo0 << " against " << sprt.elo1 << std::endl;
+	std::cout << "SPRT: " << (result.verdict == H1 ? "H1 accepted" : result.verdict == H0 ? "H0 accepted"
+																							 : "undecided")
+			  << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+
+	return result;
+}
+
+/**
+ * Plays one game. Games are adjudicated like in self-play.
+ */
+Match::Outcome Match::play(Player& white, Player& black, Position position, const Limits& limits) {
+	white.newGame();
+	black.newGame();
+
+	MoveGenerator moveGenerator;
+	Outcome outcome;
+	int64_t whiteTime = static_cast<int64_t>(limits.time);
+	int64_t blackTime = static_cast<int64_t>(limits.time);
+	int resignPlies = 0;
+	int drawPlies = 0;
+	for (int ply = 0;; ply++) {
+		int activeColor = position.activeColor;
+		if (moveGenerator.getLegalMoves(position, 1, position.isCheck()).size == 0) {
+			if (position.isCheck()) {
+				outcome.result = activeColor == color::WHITE ? PackedPosition::BLACKWINS : PackedPosition::WHITEWINS;
+			}
+			break;
+		}
+		if (position.halfmoveClock >= 100 || position.isRepetition() || position.hasInsufficientMaterial()
+			|| ply >= SelfPlay::MAX_PLIES) {
+			break;
+		}
+
+		Player& player = activeColor == color::WHITE ? white : black;
+		int value;
+		auto startTime = std::chrono::steady_clock::now();
+		int move = player.think(position, limits, std::max<int64_t>(whiteTime, 1), std::max<int64_t>(blackTime, 1),
+								value);
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - startTime).count();
+
+		if (limits.time > 0) {
+			int64_t& time = activeColor == color::WHITE ? whiteTime : blackTime;
+			time -= duration;
+			if (time < 0) {
+				outcome.result = activeColor == color::WHITE ? PackedPosition::BLACKWINS : PackedPosition::WHITEWINS;
+				outcome.isTimeLoss = true;
+				break;
+			}
+			time += static_cast<int64_t>(limits.increment);
+		}
+
+		// Adjudicate clear wins and dead draws
+		if (value != value::NOVALUE) {
+			resignPlies = std::abs(value) >= SelfPlay::RESIGN_SCORE ? resignPlies + 1 : 0;
+			drawPlies = ply >= SelfPlay::DRAW_MIN_PLY && std::abs(value) <= SelfPlay::DRAW_SCORE ? drawPlies + 1 : 0;
+			if (resignPlies >= SelfPlay::RESIGN_PLIES) {
+				bool whiteIsWinning = (value > 0) == (activeColor == color::WHITE);
+				outcome.result = whiteIsWinning ? PackedPosition::WHITEWINS : PackedPosition::BLACKWINS;
+				break;
+			} else if (drawPlies >= SelfPlay::DRAW_PLIES) {
+				break;
+			}
+		}
+
+		position.makeMove(move);
+	}
+
+	return outcome;
+}
+
+Match::Player::Player(const Engine& engine)
+		: searchMode(engine.searchMode), search(*this), monteCarloSearch(*this) {
+	search.setHashSize(engine.hashSize);
+	monteCarloSearch.setThreads(engine.threads);
+	if (!engine.tablebasePath.empty()) {
+		tablebases.setPath(engine.tablebasePath);
+		if (tablebases.getTableCount() > 0) {
+			search.setTablebases(&tablebases);
+		}
+	}
+}
+
+Match::Player::~Player() {
+	search.quit();
+}
+
+void Match::Player::newGame() {
+	search.clearHash();
+}
+
+/**
+ * Searches the position and returns the best move. The score of the move
+ * from our point of view is stored in value.
+ */
+int Match::Player::think(Position& position, const Limits& limits, uint64_t whiteTime, uint64_t blackTime,
+						 int& value) {
+	if (searchMode == MONTECARLO) {
+		prepare(monteCarloSearch, position, limits, whiteTime, blackTime);
+	} else {
+		prepare(search, position, limits, whiteTime, blackTime);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished = false;
+	bestMove = move::NOMOVE;
+	bestValue = value::NOVALUE;
+	lock.unlock();
+
+	if (searchMode == MONTECARLO) {
+		monteCarloSearch.start();
+	} else {
+		search.start();
+	}
+
+	lock.lock();
+	condition.wait(lock, [this] { return finished; });
+	value = bestValue;
+	lock.unlock();
+
+	// Wait until the search thread is ready for the next move
+	if (searchMode == MONTECARLO) {
+		monteCarloSearch.stop();
+	} else {
+		search.stop();
+	}
+
+	return bestMove;
+}
+
+template<class T>
+void Match::Player::prepare(T& engine, Position& position, const Limits& limits, uint64_t whiteTime,
+							uint64_t blackTime) {
+	if (limits.depth > 0) {
+		engine.newDepthSearch(position, limits.depth);
+	} else if (limits.nodes > 0) {
+		engine.newNodesSearch(position, limits.nodes);
+	} else {
+		engine.newClockSearch(position, whiteTime, limits.increment, blackTime, limits.increment, 40);
+	}
+}
+
+void Match::Player::sendBestMove(int _bestMove, int ponderMove) {
+	std::unique_lock<std::mutex> lock(mutex);
+	bestMove = _bestMove;
+	finished = true;
+	condition.notify_all();
+}
+
+void Match::Player::sendStatus(
+		int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove, int currentMoveNumber) {
+}
+
+void Match::Player::sendStatus(
+		bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+		int currentMoveNumber) {
+}
+
+void Match::Player::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) {
+	std::unique_lock<std::mutex> lock(mutex);
+	bestValue = entry.value;
+}
+
+void Match::Player::sendInfo(const std::string& message) {
+}
+
+void Match::Player::sendDebug(const std::string& message) {
+}
+}
@@ -0,0 +1,168 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "search.h"
+#include "montecarlosearch.h"
+#include "tablebases.h"
+#include "packedposition.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class plays a match between two engine configurations in this
+ * process. Games run concurrently on a pool of threads. Every opening is
+ * played twice with the colors reversed. A sequential probability ratio
+ * test stops the match as soon as the result is clear.
+ */
+class Match final {
+public:
+	static const int ALPHABETA = 0;
+	static const int MONTECARLO = 1;
+
+	// The verdicts of the test
+	static const int H0 = -1;
+	static const int UNDECIDED = 0;
+	static const int H1 = 1;
+
+	/**
+	 * The settings of an engine. They are parsed from UCI options like
+	 * "Hash=64,SearchMode=MonteCarlo".
+	 */
+	class Engine final {
+	public:
+		std::string name;
+		uint64_t hashSize = 16;
+		int searchMode = ALPHABETA;
+		int threads = 1;
+		std::string tablebasePath;
+
+		static Engine parse(const std::string& options);
+	};
+
+	class Limits final {
+	public:
+		int depth = 0;
+		uint64_t nodes = 0;
+		// Clock and increment per move in milliseconds
+		uint64_t time = 0;
+		uint64_t increment = 0;
+	};
+
+	/**
+	 * We test whether the first engine is elo1 rather than elo0 stronger.
+	 * The log-likelihood ratio is approximated from the game results.
+	 */
+	class Sprt final {
+	public:
+		double elo0 = 0;
+		double elo1 = 5;
+		double alpha = 0.05;
+		double beta = 0.05;
+
+		double getLowerBound() const;
+
+		double getUpperBound() const;
+
+		double getLlr(uint64_t wins, uint64_t draws, uint64_t losses) const;
+	};
+
+	// From the first engine's point of view
+	class Result final {
+	public:
+		uint64_t wins = 0;
+		uint64_t draws = 0;
+		uint64_t losses = 0;
+		uint64_t timeLosses = 0;
+		double llr = 0;
+		int verdict = UNDECIDED;
+
+		uint64_t getGames() const;
+
+		double getScore() const;
+
+		double getElo() const;
+
+		// Half the width of the 95% confidence interval
+		double getEloError() const;
+
+		std::string toString() const;
+	};
+
+	static const int PROGRESS_GAMES = 100;
+
+	static std::vector<Position> loadOpenings(const std::string& path);
+
+	static std::vector<Position> createOpenings(int count, uint64_t seed);
+
+	Result run(const Engine& first, const Engine& second, const std::vector<Position>& openings, int games,
+			   const Limits& limits, const Sprt& sprt, int threadCount);
+
+private:
+	/**
+	 * A player owns the searches of one engine configuration.
+	 */
+	class Player final : public Protocol {
+	public:
+		explicit Player(const Engine& engine);
+
+		~Player() override;
+
+		void newGame();
+
+		int think(Position& position, const Limits& limits, uint64_t whiteTime, uint64_t blackTime, int& value);
+
+		void sendBestMove(int bestMove, int ponderMove) override;
+
+		void sendStatus(
+				int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+				int currentMoveNumber) override;
+
+		void sendStatus(
+				bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+				int currentMoveNumber) override;
+
+		void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override;
+
+		void sendInfo(const std::string& message) override;
+
+		void sendDebug(const std::string& message) override;
+
+	private:
+		int searchMode;
+		Search search;
+		MonteCarloSearch monteCarloSearch;
+		Tablebases tablebases;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool finished = false;
+		int bestMove = move::NOMOVE;
+		int bestValue = value::NOVALUE;
+
+		template<class T>
+		void prepare(T& engine, Position& position, const Limits& limits, uint64_t whiteTime, uint64_t blackTime);
+	};
+
+	class Outcome final {
+	public:
+		// From White's point of view
+		int result = PackedPosition::DRAW;
+		bool isTimeLoss = false;
+	};
+
+	static Outcome play(Player& white, Player& black, Position position, const Limits& limits);
+
+	std::mutex mutex;
+	std::atomic<int> nextGame{0};
+	std::atomic<bool> stopped{false};
+};
+}
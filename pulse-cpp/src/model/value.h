@@ -11,6 +11,8 @@ namespace pulse::value {
 constexpr int INFINITE = 200000;
 constexpr int CHECKMATE = 100000;
 constexpr int CHECKMATE_THRESHOLD = CHECKMATE - depth::MAX_PLY;
+// Proven wins from a tablebase rank below all checkmates
+constexpr int TABLEBASE_WIN = CHECKMATE_THRESHOLD - depth::MAX_PLY;
 constexpr int DRAW = 0;
 
 constexpr int NOVALUE = 300000;
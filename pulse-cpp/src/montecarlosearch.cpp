@@ -0,0 +1,495 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "montecarlosearch.h"
+#include "search.h"
+#include "evaluation.h"
+#include "trace.h"
+#include "allocationtracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace pulse {
+
+MonteCarloSearch::MonteCarloSearch(Protocol& protocol)
+		: protocol(protocol) {
+	reset();
+}
+
+MonteCarloSearch::~MonteCarloSearch() {
+	stop();
+}
+
+void MonteCarloSearch::newDepthSearch(Position& _position, int _searchDepth) {
+	if (_searchDepth < 1 || _searchDepth > depth::MAX_DEPTH) throw std::exception();
+
+	reset();
+
+	position = _position;
+	searchDepth = _searchDepth;
+}
+
+void MonteCarloSearch::newNodesSearch(Position& _position, uint64_t _searchNodes) {
+	if (_searchNodes < 1) throw std::exception();
+
+	reset();
+
+	position = _position;
+	searchNodes = _searchNodes;
+}
+
+void MonteCarloSearch::newTimeSearch(Position& _position, uint64_t _searchTime) {
+	if (_searchTime < 1) throw std::exception();
+
+	reset();
+
+	position = _position;
+	searchTime = _searchTime;
+	runTimer = true;
+}
+
+void MonteCarloSearch::newInfiniteSearch(Position& _position) {
+	reset();
+
+	position = _position;
+}
+
+void MonteCarloSearch::newClockSearch(Position& _position,
+									  uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement,
+									  uint64_t blackTimeLeft, uint64_t blackTimeIncrement, int movesToGo) {
+	newPonderSearch(_position,
+			whiteTimeLeft, whiteTimeIncrement, blackTimeLeft, blackTimeIncrement, movesToGo
+	);
+
+	runTimer = true;
+}
+
+void MonteCarloSearch::newPonderSearch(Position& _position,
+									   uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement,
+									   uint64_t blackTimeLeft, uint64_t blackTimeIncrement, int movesToGo) {
+	if (whiteTimeLeft < 1 && _position.activeColor == color::WHITE) throw std::exception();
+	if (blackTimeLeft < 1 && _position.activeColor == color::BLACK) throw std::exception();
+	if (movesToGo < 1) throw std::exception();
+
+	reset();
+
+	position = _position;
+	searchTime = Search::getClockTime(_position,
+			whiteTimeLeft, whiteTimeIncrement, blackTimeLeft, blackTimeIncrement, movesToGo);
+	doTimeManagement = true;
+}
+
+/**
+ * Restricts the root moves of the next search. An empty list means all
+ * legal moves.
+ */
+void MonteCarloSearch::setSearchMoves(const std::vector<int>& _searchMoves) {
+	if (thread.joinable()) throw std::exception();
+
+	searchMoves = _searchMoves;
+}
+
+void MonteCarloSearch::setThreads(int _threads) {
+	if (_threads < 1 || _threads > MAX_THREADS) throw std::exception();
+	if (thread.joinable()) throw std::exception();
+
+	threads = _threads;
+}
+
+void MonteCarloSearch::reset() {
+	if (thread.joinable()) throw std::exception();
+
+	searchDepth = depth::MAX_DEPTH;
+	searchNodes = std::numeric_limits<uint64_t>::max();
+	searchTime = 0;
+	doTimeManagement = false;
+	runTimer = false;
+	searchMoves.clear();
+	root.reset();
+	nodeCount = 0;
+	abort = false;
+	totalNodes = 0;
+	currentMaxDepth = 0;
+}
+
+void MonteCarloSearch::start() {
+	std::unique_lock<std::mutex> lock(sync);
+
+	if (!thread.joinable()) {
+		timerStart = std::chrono::steady_clock::now();
+		thread = std::thread(&MonteCarloSearch::run, this);
+	}
+}
+
+/**
+ * Stops the search and waits until we have sent the best move.
+ */
+void MonteCarloSearch::stop() {
+	std::unique_lock<std::mutex> lock(sync);
+
+	if (thread.joinable()) {
+		Trace::instant("control", "stop");
+		abort = true;
+		thread.join();
+	}
+}
+
+void MonteCarloSearch::ponderhit() {
+	std::unique_lock<std::mutex> lock(sync);
+
+	if (thread.joinable()) {
+		// Enable time management
+		Trace::instant("control", "ponderhit");
+		timerStart = std::chrono::steady_clock::now();
+		runTimer = true;
+	}
+}
+
+void MonteCarloSearch::run() {
+	Trace::setThreadName("montecarlo");
+	PULSE_ALLOCATION_SCOPE(SEARCH);
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (int i = 0; i < threads; i++) {
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->position = position;
+	}
+
+	root = std::make_unique<Node>();
+	nodeCount = 1;
+	expand(*root, *workers[0], true);
+
+	if (root->childCount > 0) {
+		std::vector<std::thread> helpers;
+		for (int i = 1; i < threads; i++) {
+			helpers.emplace_back([this, &workers, i] {
+				Trace::setThreadName("montecarlo helper " + std::to_string(i));
+				PULSE_ALLOCATION_SCOPE(SEARCH);
+				runWorker(*workers[i], false);
+			});
+		}
+
+		runWorker(*workers[0], true);
+
+		for (auto& helper: helpers) {
+			helper.join();
+		}
+	}
+
+	RootEntry entry = getPrincipalVariation();
+	if (entry.pv.size > 0) {
+		protocol.sendMove(entry, entry.pv.size, currentMaxDepth, totalNodes);
+	}
+	protocol.sendStatus(true, entry.pv.size, currentMaxDepth, totalNodes, move::NOMOVE, 0);
+
+	// Send the best move and ponder move
+	Trace::instant("montecarlo", "bestmove");
+	protocol.sendBestMove(entry.move, entry.pv.size >= 2 ? entry.pv.moves[1] : +move::NOMOVE);
+}
+
+/**
+ * Runs playouts until we are told to stop. The main thread also watches the
+ * stop conditions and reports our progress.
+ */
+void MonteCarloSearch::runWorker(Worker& worker, bool isMain) {
+	Trace::Span span("montecarlo", "playouts");
+	auto reportTime = std::chrono::steady_clock::now();
+
+	while (!abort) {
+		playout(worker);
+
+		// The quiescent search of a single playout can take long in tactical
+		// positions, so we check after every playout.
+		if (isMain) {
+			checkStopConditions();
+
+			auto now = std::chrono::steady_clock::now();
+			if (now - reportTime >= std::chrono::seconds(1)) {
+				sendPrincipalVariation();
+				reportTime = now;
+			}
+		}
+	}
+}
+
+/**
+ * Walks down the tree to a leaf, scores it and backs up the value.
+ */
+void MonteCarloSearch::playout(Worker& worker) {
+	Position& current = worker.position;
+	std::vector<Node*>& path = worker.path;
+
+	Node* node = root.get();
+	node->visits++;
+	path.clear();
+	path.push_back(node);
+
+	// Selection. We count the visit on the way down, so other threads see
+	// it as a lost playout until we back up the real value.
+	while (node->state.load(std::memory_order_acquire) == EXPANDED && node->childCount > 0) {
+		node = select(*node);
+		node->visits++;
+		current.makeMove(node->move);
+		path.push_back(node);
+	}
+
+	int ply = static_cast<int>(path.size()) - 1;
+	int maxDepth = currentMaxDepth;
+	while (ply > maxDepth && !currentMaxDepth.compare_exchange_weak(maxDepth, ply)) {
+	}
+
+	// Evaluation of the leaf from the view of the side to move
+	double value;
+	if (ply > 0
+		&& (current.isRepetition() || current.hasInsufficientMaterial() || current.halfmoveClock >= 100)) {
+		value = 0.5;
+	} else {
+		if (nodeCount < MAX_NODES) {
+			expand(*node, worker, false);
+		}
+
+		if (node->state.load(std::memory_order_acquire) == EXPANDED && node->childCount == 0) {
+			// Checkmate or stalemate
+			value = current.isCheck() ? 0.0 : 0.5;
+		} else {
+			value = toProbability(quiescent(worker, -value::INFINITE, value::INFINITE, 1));
+		}
+	}
+
+	// Backup
+	for (int i = ply; i >= 0; i--) {
+		value = 1.0 - value;
+		path[i]->valueSum += static_cast<int64_t>(std::llround(value * SCALE));
+
+		if (i > 0) {
+			current.undoMove(path[i]->move);
+		}
+	}
+
+	totalNodes++;
+	if (totalNodes >= searchNodes) {
+		abort = true;
+	}
+}
+
+/**
+ * Returns the child with the highest PUCT score. Unvisited children get the
+ * value of their parent minus a small reduction.
+ */
+MonteCarloSearch::Node* MonteCarloSearch::select(Node& node) {
+	int parentVisits = node.visits;
+	double exploration = EXPLORATION * std::sqrt(static_cast<double>(std::max(parentVisits, 1)));
+	double parentValue = parentVisits > 0
+			? static_cast<double>(node.valueSum) / SCALE / parentVisits
+			: 0.5;
+	double firstPlayValue = std::max(0.0, 1.0 - parentValue - FIRST_PLAY_REDUCTION);
+
+	Node* bestChild = &node.children[0];
+	double bestScore = -std::numeric_limits<double>::infinity();
+	for (int i = 0; i < node.childCount; i++) {
+		Node& child = node.children[i];
+		int visits = child.visits;
+		double value = visits > 0
+				? static_cast<double>(child.valueSum) / SCALE / visits
+				: firstPlayValue;
+		double score = value + exploration * child.prior / (1 + visits);
+		if (score > bestScore) {
+			bestScore = score;
+			bestChild = &child;
+		}
+	}
+
+	return bestChild;
+}
+
+/**
+ * Adds the legal moves as children of the node. Only one thread expands a
+ * node, the others keep treating it as a leaf in the meantime. Returns
+ * whether we have expanded the node.
+ */
+bool MonteCarloSearch::expand(Node& node, Worker& worker, bool isRoot) {
+	int expected = UNEXPANDED;
+	if (!node.state.compare_exchange_strong(expected, EXPANDING)) {
+		return false;
+	}
+
+	Position& current = worker.position;
+	MoveList<MoveEntry>& moves = worker.moveGenerators[0].getLegalMoves(current, 1, current.isCheck());
+
+	std::vector<int> childMoves;
+	for (int i = 0; i < moves.size; i++) {
+		int move = moves.entries[i]->move;
+		if (!isRoot || searchMoves.empty()
+			|| std::find(searchMoves.begin(), searchMoves.end(), move) != searchMoves.end()) {
+			childMoves.push_back(move);
+		}
+	}
+
+	// Priors are a softmax over the quiescent values of the children
+	std::vector<double> priors(childMoves.size());
+	double maxValue = -std::numeric_limits<double>::infinity();
+	for (unsigned int i = 0; i < childMoves.size(); i++) {
+		current.makeMove(childMoves[i]);
+		priors[i] = -quiescent(worker, -value::INFINITE, value::INFINITE, 1) / PRIOR_TEMPERATURE;
+		current.undoMove(childMoves[i]);
+		maxValue = std::max(maxValue, priors[i]);
+	}
+
+	double sum = 0;
+	for (auto& prior: priors) {
+		prior = std::exp(prior - maxValue);
+		sum += prior;
+	}
+
+	node.children = std::make_unique<Node[]>(childMoves.size());
+	node.childCount = static_cast<int>(childMoves.size());
+	for (unsigned int i = 0; i < childMoves.size(); i++) {
+		node.children[i].move = childMoves[i];
+		node.children[i].prior = static_cast<float>(priors[i] / sum);
+	}
+	nodeCount += childMoves.size();
+
+	node.state.store(EXPANDED, std::memory_order_release);
+	return true;
+}
+
+/**
+ * A plain capture search to settle the leaf before we evaluate it.
+ */
+int MonteCarloSearch::quiescent(Worker& worker, int alpha, int beta, int ply) {
+	Position& current = worker.position;
+
+	if (ply == MAX_QUIESCENT_PLY) {
+		return evaluation::evaluate(current);
+	}
+
+	int bestValue = -value::INFINITE;
+	int searchedMoves = 0;
+	bool isCheck = current.isCheck();
+
+	//### BEGIN Stand pat
+	if (!isCheck) {
+		bestValue = evaluation::evaluate(current);
+
+		if (bestValue > alpha) {
+			alpha = bestValue;
+
+			if (bestValue >= beta) {
+				return bestValue;
+			}
+		}
+	}
+	//### ENDOF Stand pat
+
+	MoveList<MoveEntry>& moves = worker.moveGenerators[ply].getMoves(current, 0, isCheck);
+	for (int i = 0; i < moves.size; i++) {
+		int move = moves.entries[i]->move;
+		int value = bestValue;
+
+		current.makeMove(move);
+		if (!current.isCheck(color::opposite(current.activeColor))) {
+			searchedMoves++;
+			value = -quiescent(worker, -beta, -alpha, ply + 1);
+		}
+		current.undoMove(move);
+
+		if (value > bestValue) {
+			bestValue = value;
+
+			if (value > alpha) {
+				alpha = value;
+
+				if (value >= beta) {
+					break;
+				}
+			}
+		}
+	}
+
+	// If we cannot move, check for checkmate.
+	if (searchedMoves == 0 && isCheck) {
+		return -value::CHECKMATE + ply;
+	}
+
+	return bestValue;
+}
+
+void MonteCarloSearch::checkStopConditions() {
+	if (runTimer) {
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - timerStart).count();
+		if (static_cast<uint64_t>(elapsed) >= searchTime) {
+			abort = true;
+		}
+
+		// Check if we have only one move to make
+		if (doTimeManagement && root->childCount == 1) {
+			abort = true;
+		}
+	}
+
+	// The principal variation is as deep as we were asked to search
+	if (searchDepth != depth::MAX_DEPTH && getPrincipalVariation().pv.size >= searchDepth) {
+		abort = true;
+	}
+}
+
+/**
+ * Follows the most visited children from the root.
+ */
+RootEntry MonteCarloSearch::getPrincipalVariation() {
+	RootEntry entry;
+	entry.value = value::DRAW;
+
+	Node* node = root.get();
+	while (node->state.load(std::memory_order_acquire) == EXPANDED && entry.pv.size < depth::MAX_PLY) {
+		Node* bestChild = nullptr;
+		for (int i = 0; i < node->childCount; i++) {
+			if (bestChild == nullptr || node->children[i].visits > bestChild->visits) {
+				bestChild = &node->children[i];
+			}
+		}
+
+		if (bestChild == nullptr || bestChild->visits == 0) {
+			break;
+		}
+
+		if (entry.pv.size == 0) {
+			entry.value = toValue(static_cast<double>(bestChild->valueSum) / SCALE / bestChild->visits);
+		}
+		entry.pv.moves[entry.pv.size++] = bestChild->move;
+		node = bestChild;
+	}
+
+	// Without any visit we still want to play a legal move
+	if (entry.pv.size == 0 && root->childCount > 0) {
+		entry.pv.moves[entry.pv.size++] = root->children[0].move;
+	}
+
+	entry.move = entry.pv.size > 0 ? entry.pv.moves[0] : +move::NOMOVE;
+	return entry;
+}
+
+void MonteCarloSearch::sendPrincipalVariation() {
+	RootEntry entry = getPrincipalVariation();
+	if (entry.pv.size > 0) {
+		protocol.sendMove(entry, entry.pv.size, currentMaxDepth, totalNodes);
+	}
+}
+
+/**
+ * Converts a centipawn value into the expected score of the side to move.
+ */
+double MonteCarloSearch::toProbability(int value) {
+	return 1.0 / (1.0 + std::pow(10.0, -value / 400.0));
+}
+
+int MonteCarloSearch::toValue(double probability) {
+	probability = std::min(std::max(probability, 0.0001), 0.9999);
+	return static_cast<int>(std::lround(400.0 * std::log10(probability / (1.0 - probability))));
+}
+}
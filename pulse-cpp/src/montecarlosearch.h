@@ -0,0 +1,148 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "protocol.h"
+#include "position.h"
+#include "movegenerator.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class implements a Monte Carlo tree search guided by PUCT. We have no
+ * policy network, so the priors come from the evaluation of the child
+ * positions, and leaves are scored with a short quiescent search. All
+ * threads share one tree. A thread descending into a node counts its visit
+ * right away, which acts as a virtual loss until its value is backed up.
+ */
+class MonteCarloSearch final {
+public:
+	static const int MAX_THREADS = 256;
+
+	explicit MonteCarloSearch(Protocol& protocol);
+
+	~MonteCarloSearch();
+
+	void newDepthSearch(Position& _position, int _searchDepth);
+
+	void newNodesSearch(Position& _position, uint64_t _searchNodes);
+
+	void newTimeSearch(Position& _position, uint64_t _searchTime);
+
+	void newInfiniteSearch(Position& _position);
+
+	void newClockSearch(Position& _position,
+						uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement, uint64_t blackTimeLeft,
+						uint64_t blackTimeIncrement, int movesToGo);
+
+	void newPonderSearch(Position& _position,
+						 uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement, uint64_t blackTimeLeft,
+						 uint64_t blackTimeIncrement, int movesToGo);
+
+	void setSearchMoves(const std::vector<int>& _searchMoves);
+
+	void setThreads(int _threads);
+
+	void start();
+
+	void stop();
+
+	void ponderhit();
+
+private:
+	static const int UNEXPANDED = 0;
+	static const int EXPANDING = 1;
+	static const int EXPANDED = 2;
+
+	// Values are win probabilities stored as fixed point numbers
+	static const int64_t SCALE = 1000000;
+
+	static const int MAX_QUIESCENT_PLY = 32;
+	static const uint64_t MAX_NODES = 1 << 22;
+
+	static constexpr double EXPLORATION = 1.5;
+	static constexpr double FIRST_PLAY_REDUCTION = 0.2;
+	static constexpr double PRIOR_TEMPERATURE = 100.0;
+
+	/**
+	 * A node holds the statistics of the move leading to it. Its value is
+	 * seen from the side that made the move.
+	 */
+	class Node final {
+	public:
+		int move = move::NOMOVE;
+		float prior = 0;
+		std::atomic<int> visits{0};
+		std::atomic<int64_t> valueSum{0};
+		std::atomic<int> state{UNEXPANDED};
+		int childCount = 0;
+		std::unique_ptr<Node[]> children;
+	};
+
+	/**
+	 * Everything a thread needs to run playouts on its own.
+	 */
+	class Worker final {
+	public:
+		Position position;
+		std::vector<Node*> path;
+		std::array<MoveGenerator, MAX_QUIESCENT_PLY + 1> moveGenerators;
+	};
+
+	Protocol& protocol;
+	std::mutex sync;
+	std::thread thread;
+	int threads = 1;
+
+	Position position;
+	std::vector<int> searchMoves;
+	std::unique_ptr<Node> root;
+	std::atomic<uint64_t> nodeCount{0};
+
+	// Search limits
+	int searchDepth;
+	uint64_t searchNodes;
+	uint64_t searchTime;
+	bool doTimeManagement;
+	std::atomic<bool> runTimer{false};
+	std::chrono::steady_clock::time_point timerStart;
+
+	// Search state
+	std::atomic<bool> abort{false};
+	std::atomic<uint64_t> totalNodes{0};
+	std::atomic<int> currentMaxDepth{0};
+
+	void reset();
+
+	void run();
+
+	void runWorker(Worker& worker, bool isMain);
+
+	void playout(Worker& worker);
+
+	Node* select(Node& node);
+
+	bool expand(Node& node, Worker& worker, bool isRoot);
+
+	int quiescent(Worker& worker, int alpha, int beta, int ply);
+
+	void checkStopConditions();
+
+	RootEntry getPrincipalVariation();
+
+	void sendPrincipalVariation();
+
+	static double toProbability(int value);
+
+	static int toValue(double probability);
+};
+}
@@ -5,6 +5,7 @@
 
 #include "movegenerator.h"
 #include "model/rank.h"
+#include "profile.h"
 
 namespace pulse {
 
@@ -27,17 +28,14 @@ MoveList<MoveEntry>& MoveGenerator::getLegalMoves(Position& position, int depth,
 }
 
 MoveList<MoveEntry>& MoveGenerator::getMoves(Position& position, int depth, bool isCheck) {
+	PULSE_PROFILE_SCOPE(GETMOVES);
+
 	moves.size = 0;
 
 	if (depth > 0) {
 		// Generate main moves
 
-		addMoves(moves, position);
-
-		if (!isCheck) {
-			int square = bitboard::next(position.pieces[position.activeColor][piecetype::KING]);
-			addCastlingMoves(moves, square, position);
-		}
+		getUnsortedMoves(position, isCheck);
 	} else {
 		// Generate quiescent moves
 
@@ -61,6 +59,23 @@ MoveList<MoveEntry>& MoveGenerator::getMoves(Position& position, int depth, bool
 	return moves;
 }
 
+/**
+ * Returns all pseudo-legal moves in the order we generate them. Use this if
+ * the order does not matter, because sorting costs more than generating.
+ */
+MoveList<MoveEntry>& MoveGenerator::getUnsortedMoves(Position& position, bool isCheck) {
+	moves.size = 0;
+
+	addMoves(moves, position);
+
+	if (!isCheck) {
+		int square = bitboard::next(position.pieces[position.activeColor][piecetype::KING]);
+		addCastlingMoves(moves, square, position);
+	}
+
+	return moves;
+}
+
 void MoveGenerator::addMoves(MoveList<MoveEntry>& list, Position& position) {
 	int activeColor = position.activeColor;
 
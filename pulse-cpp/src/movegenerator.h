@@ -15,6 +15,8 @@ public:
 
 	MoveList<MoveEntry>& getMoves(Position& position, int depth, bool isCheck);
 
+	MoveList<MoveEntry>& getUnsortedMoves(Position& position, bool isCheck);
+
 private:
 	MoveList<MoveEntry> moves;
 
@@ -4,11 +4,15 @@
 // found in the LICENSE file.
 
 #include "movelist.h"
+#include "profile.h"
+#include "allocationtracker.h"
 
 namespace pulse {
 
 template<class T>
 MoveList<T>::MoveList() {
+	PULSE_ALLOCATION_SCOPE(MOVEGEN);
+
 	for (unsigned int i = 0; i < entries.size(); i++) {
 		entries[i] = std::shared_ptr<T>(new T());
 	}
@@ -19,6 +23,8 @@ MoveList<T>::MoveList() {
  */
 template<class T>
 void MoveList<T>::sort() {
+	PULSE_PROFILE_SCOPE(SORT);
+
 	for (int i = 1; i < size; i++) {
 		std::shared_ptr<T> entry(entries[i]);
 
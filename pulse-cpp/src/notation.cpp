@@ -4,12 +4,16 @@
 // found in the LICENSE file.
 
 #include "notation.h"
+#include "movegenerator.h"
 #include "model/file.h"
 #include "model/rank.h"
 #include "model/castlingtype.h"
+#include "allocationtracker.h"
 
+#include <algorithm>
 #include <sstream>
 #include <locale>
+#include <stdexcept>
 
 namespace pulse::notation {
 namespace {
@@ -65,6 +69,8 @@ char transform(char notation, int color) {
 }
 
 Position toPosition(const std::string& fen) {
+	PULSE_ALLOCATION_SCOPE(NOTATION);
+
 	Position position;
 
 	// Clean and split into tokens
@@ -219,6 +225,8 @@ Position toPosition(const std::string& fen) {
 }
 
 std::string fromPosition(const Position& position) {
+	PULSE_ALLOCATION_SCOPE(NOTATION);
+
 	std::string fen;
 
 	// Pieces
@@ -518,4 +526,167 @@ std::string fromSquare(int square) {
 
 	return notation;
 }
+
+/**
+ * Returns the legal move with this standard algebraic notation. Check and
+ * annotation symbols are optional. We parse the notation and then look only
+ * at the pseudo-legal moves matching it, so this is cheap enough to decode
+ * whole game archives.
+ */
+int toMove(Position& position, const std::string& san) {
+	std::string notation = san;
+	while (!notation.empty() && std::string("+#!?").find(notation.back()) != std::string::npos) {
+		notation.pop_back();
+	}
+	std::replace(notation.begin(), notation.end(), '0', 'O');
+
+	bool isCastling = notation == "O-O" || notation == "O-O-O";
+	int piecetype = piecetype::PAWN;
+	int promotion = piecetype::NOPIECETYPE;
+	int targetSquare = square::NOSQUARE;
+	int originFile = file::NOFILE;
+	int originRank = rank::NORANK;
+
+	if (!isCastling) {
+		std::string::size_type begin = 0;
+		std::string::size_type end = notation.size();
+		if (end > 0 && std::string("NBRQK").find(notation[0]) != std::string::npos) {
+			piecetype = toPieceType(notation[0]);
+			begin++;
+		} else if (end > 0 && std::string("NBRQ").find(notation[end - 1]) != std::string::npos) {
+			promotion = toPieceType(notation[end - 1]);
+			end -= (end >= 2 && notation[end - 2] == '=') ? 2 : 1;
+		}
+
+		if (end < begin + 2) {
+			throw std::invalid_argument("Illegal move " + san);
+		}
+		int targetFile = toFile(notation[end - 2]);
+		int targetRank = toRank(notation[end - 1]);
+		if (targetFile == file::NOFILE || targetRank == rank::NORANK) {
+			throw std::invalid_argument("Illegal move " + san);
+		}
+		targetSquare = square::valueOf(targetFile, targetRank);
+
+		// Whatever is left tells us where the piece comes from
+		for (std::string::size_type i = begin; i < end - 2; i++) {
+			char character = notation[i];
+			if (character == 'x' || character == '-') {
+				continue;
+			} else if (toFile(character) != file::NOFILE) {
+				originFile = toFile(character);
+			} else if (toRank(character) != rank::NORANK) {
+				originRank = toRank(character);
+			} else {
+				throw std::invalid_argument("Illegal move " + san);
+			}
+		}
+	}
+
+	thread_local MoveGenerator moveGenerator;
+	MoveList<MoveEntry>& moves = moveGenerator.getUnsortedMoves(position, position.isCheck());
+	int result = move::NOMOVE;
+	for (int i = 0; i < moves.size; i++) {
+		int move = moves.entries[i]->move;
+		if (isCastling) {
+			if (move::getType(move) != movetype::CASTLING
+				|| (square::getFile(move::getTargetSquare(move)) == file::g) != (notation == "O-O")) {
+				continue;
+			}
+		} else if (piece::getType(move::getOriginPiece(move)) != piecetype
+				   || move::getTargetSquare(move) != targetSquare
+				   || move::getPromotion(move) != promotion
+				   || (originFile != file::NOFILE && square::getFile(move::getOriginSquare(move)) != originFile)
+				   || (originRank != rank::NORANK && square::getRank(move::getOriginSquare(move)) != originRank)) {
+			continue;
+		}
+
+		position.makeMove(move);
+		bool isLegal = !position.isCheck(color::opposite(position.activeColor));
+		position.undoMove(move);
+
+		if (isLegal) {
+			if (result != move::NOMOVE) {
+				throw std::invalid_argument("Ambiguous move " + san);
+			}
+			result = move;
+		}
+	}
+
+	if (result == move::NOMOVE) {
+		throw std::invalid_argument("Illegal move " + san);
+	}
+
+	return result;
+}
+
+/**
+ * Returns the standard algebraic notation of a legal move, including the
+ * check or checkmate symbol.
+ */
+std::string fromMove(Position& position, int move) {
+	std::string notation;
+
+	int originSquare = move::getOriginSquare(move);
+	int targetSquare = move::getTargetSquare(move);
+	int piecetype = piece::getType(move::getOriginPiece(move));
+	bool isCapture = move::getTargetPiece(move) != piece::NOPIECE || move::getType(move) == movetype::ENPASSANT;
+
+	if (move::getType(move) == movetype::CASTLING) {
+		notation = square::getFile(targetSquare) == file::g ? "O-O" : "O-O-O";
+	} else if (piecetype == piecetype::PAWN) {
+		if (isCapture) {
+			notation += fromFile(square::getFile(originSquare));
+			notation += 'x';
+		}
+		notation += fromSquare(targetSquare);
+		if (move::getPromotion(move) != piecetype::NOPIECETYPE) {
+			notation += '=';
+			notation += fromPieceType(move::getPromotion(move));
+		}
+	} else {
+		notation += fromPieceType(piecetype);
+
+		// Add the file or rank, if another piece of the same type can
+		// move to the same square.
+		bool isAmbiguous = false;
+		bool sameFile = false;
+		bool sameRank = false;
+		MoveGenerator moveGenerator;
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		for (int i = 0; i < moves.size; i++) {
+			int other = moves.entries[i]->move;
+			if (other != move
+				&& move::getOriginPiece(other) == move::getOriginPiece(move)
+				&& move::getTargetSquare(other) == targetSquare) {
+				isAmbiguous = true;
+				sameFile |= square::getFile(move::getOriginSquare(other)) == square::getFile(originSquare);
+				sameRank |= square::getRank(move::getOriginSquare(other)) == square::getRank(originSquare);
+			}
+		}
+		if (isAmbiguous) {
+			if (!sameFile) {
+				notation += fromFile(square::getFile(originSquare));
+			} else if (!sameRank) {
+				notation += fromRank(square::getRank(originSquare));
+			} else {
+				notation += fromSquare(originSquare);
+			}
+		}
+
+		if (isCapture) {
+			notation += 'x';
+		}
+		notation += fromSquare(targetSquare);
+	}
+
+	position.makeMove(move);
+	if (position.isCheck()) {
+		MoveGenerator moveGenerator;
+		notation += moveGenerator.getLegalMoves(position, 1, true).size > 0 ? '+' : '#';
+	}
+	position.undoMove(move);
+
+	return notation;
+}
 }
@@ -45,4 +45,8 @@ int toRank(char notation);
 char fromRank(int rank);
 
 std::string fromSquare(int square);
+
+int toMove(Position& position, const std::string& san);
+
+std::string fromMove(Position& position, int move);
 }
@@ -0,0 +1,127 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "packedposition.h"
+#include "model/move.h"
+#include "model/value.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace pulse {
+
+PackedPosition PackedPosition::pack(const Position& position) {
+	PackedPosition packedPosition{};
+
+	for (auto color: color::values) {
+		for (auto piecetype: piecetype::values) {
+			packedPosition.occupancy |= position.pieces[color][piecetype];
+		}
+	}
+	if (bitboard::size(packedPosition.occupancy) > 32) {
+		throw std::invalid_argument("Too many pieces");
+	}
+
+	int index = 0;
+	for (auto squares = packedPosition.occupancy; squares != 0; squares = bitboard::remainder(squares)) {
+		int piece = position.board[bitboard::next(squares)];
+		packedPosition.pieces[index / 2] |= static_cast<uint8_t>(piece << ((index % 2) * 4));
+		index++;
+	}
+
+	packedPosition.castlingRights = static_cast<uint8_t>(position.castlingRights);
+	packedPosition.enPassantSquare = static_cast<uint8_t>(position.enPassantSquare);
+	packedPosition.activeColor = static_cast<uint8_t>(position.activeColor);
+	packedPosition.halfmoveClock = static_cast<uint8_t>(std::min(position.halfmoveClock, 255));
+	packedPosition.fullmoveNumber = static_cast<uint16_t>(std::min(position.getFullmoveNumber(), 65535));
+	packedPosition.result = NORESULT;
+	packedPosition.score = value::NOVALUE;
+	packedPosition.move = move::NOMOVE;
+
+	return packedPosition;
+}
+
+/**
+ * Rebuilds the position, including its zobrist key.
+ */
+Position PackedPosition::unpack() const {
+	Position position;
+
+	int index = 0;
+	for (auto squares = occupancy; squares != 0; squares = bitboard::remainder(squares)) {
+		int piece = (pieces[index / 2] >> ((index % 2) * 4)) & 0xF;
+		if (!piece::isValid(piece)) {
+			throw std::invalid_argument("Illegal piece");
+		}
+		position.put(piece, bitboard::next(squares));
+		index++;
+	}
+
+	position.setActiveColor(activeColor);
+	for (auto castling: {castling::WHITE_KINGSIDE, castling::WHITE_QUEENSIDE,
+						  castling::BLACK_KINGSIDE, castling::BLACK_QUEENSIDE}) {
+		if ((castlingRights & castling) != castling::NOCASTLING) {
+			position.setCastlingRight(castling);
+		}
+	}
+	position.setEnPassantSquare(enPassantSquare);
+	position.setHalfmoveClock(halfmoveClock);
+	position.setFullmoveNumber(fullmoveNumber);
+
+	return position;
+}
+
+bool PackedPosition::operator==(const PackedPosition& packedPosition) const {
+	return std::memcmp(this, &packedPosition, sizeof(PackedPosition)) == 0;
+}
+
+bool PackedPosition::operator!=(const PackedPosition& packedPosition) const {
+	return !(*this == packedPosition);
+}
+
+PackedPositionWriter::PackedPositionWriter(const std::string& path, bool append)
+		: path(path), file(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc)) {
+	if (!file) {
+		throw std::runtime_error("Cannot open " + path);
+	}
+}
+
+void PackedPositionWriter::write(const PackedPosition& packedPosition) {
+	file.write(reinterpret_cast<const char*>(&packedPosition), sizeof(PackedPosition));
+	if (!file) {
+		throw std::runtime_error("Cannot write " + path);
+	}
+}
+
+void PackedPositionWriter::close() {
+	file.close();
+	if (!file) {
+		throw std::runtime_error("Cannot write " + path);
+	}
+}
+
+PackedPositionReader::PackedPositionReader(const std::string& path)
+		: file(std::make_unique<MappedFile>(path, MappedFile::READONLY)) {
+	if (file->size() % sizeof(PackedPosition) != 0) {
+		throw std::runtime_error("Corrupt packed position file " + path);
+	}
+
+	packedPositions = reinterpret_cast<const PackedPosition*>(file->data());
+	count = file->size() / sizeof(PackedPosition);
+}
+
+uint64_t PackedPositionReader::size() const {
+	return count;
+}
+
+const PackedPosition& PackedPositionReader::operator[](uint64_t index) const {
+	return packedPositions[index];
+}
+
+Position PackedPositionReader::getPosition(uint64_t index) const {
+	return packedPositions[index].unpack();
+}
+}
@@ -0,0 +1,88 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "position.h"
+#include "mappedfile.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace pulse {
+
+/**
+ * This class is a fixed-size binary encoding of a position. The board is
+ * stored as an occupancy bitboard and a piece nibble per occupied square.
+ * A score, a game result and a move may be attached, so datasets can be
+ * stored in the same format.
+ */
+class PackedPosition final {
+public:
+	// The game result from White's point of view
+	static const int BLACKWINS = -1;
+	static const int DRAW = 0;
+	static const int WHITEWINS = 1;
+	static const int NORESULT = 2;
+
+	uint64_t occupancy;
+	uint8_t pieces[16];
+	uint8_t castlingRights;
+	uint8_t enPassantSquare;
+	uint8_t activeColor;
+	uint8_t halfmoveClock;
+	uint16_t fullmoveNumber;
+	int8_t result;
+	uint8_t reserved;
+	int32_t score;
+	int32_t move;
+
+	static PackedPosition pack(const Position& position);
+
+	Position unpack() const;
+
+	bool operator==(const PackedPosition& packedPosition) const;
+
+	bool operator!=(const PackedPosition& packedPosition) const;
+};
+
+static_assert(sizeof(PackedPosition) == 40, "Unexpected packed position layout");
+
+/**
+ * This class appends packed positions to a file. The file has no header,
+ * so files can be concatenated.
+ */
+class PackedPositionWriter final {
+public:
+	explicit PackedPositionWriter(const std::string& path, bool append = false);
+
+	void write(const PackedPosition& packedPosition);
+
+	void close();
+
+private:
+	std::string path;
+	std::ofstream file;
+};
+
+/**
+ * This class maps a file of packed positions into memory for random access.
+ */
+class PackedPositionReader final {
+public:
+	explicit PackedPositionReader(const std::string& path);
+
+	uint64_t size() const;
+
+	const PackedPosition& operator[](uint64_t index) const;
+
+	Position getPosition(uint64_t index) const;
+
+private:
+	std::unique_ptr<MappedFile> file;
+	const PackedPosition* packedPositions = nullptr;
+	uint64_t count = 0;
+};
+}
@@ -0,0 +1,157 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "perfcounters.h"
+
+#include <algorithm>
+#include <iomanip>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace pulse {
+
+#ifdef __linux__
+
+namespace {
+
+int openCounter(uint32_t type, uint64_t config) {
+	perf_event_attr attributes;
+	std::memset(&attributes, 0, sizeof(attributes));
+	attributes.size = sizeof(attributes);
+	attributes.type = type;
+	attributes.config = config;
+	attributes.disabled = 1;
+	attributes.inherit = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+
+	return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+constexpr uint64_t cacheMiss(uint64_t cache) {
+	return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+}
+
+/**
+ * Opens all counters. They don't count until we start them.
+ */
+PerfCounters::PerfCounters() {
+	descriptors[CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	descriptors[INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	descriptors[BRANCHMISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	descriptors[L1DMISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D));
+	descriptors[LLCMISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL));
+	descriptors[DTLBMISSES] = openCounter(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB));
+}
+
+PerfCounters::~PerfCounters() {
+	for (auto descriptor: descriptors) {
+		if (descriptor >= 0) {
+			close(descriptor);
+		}
+	}
+}
+
+void PerfCounters::start() {
+	for (auto descriptor: descriptors) {
+		if (descriptor >= 0) {
+			ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void PerfCounters::stop() {
+	for (auto descriptor: descriptors) {
+		if (descriptor >= 0) {
+			ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+		}
+	}
+}
+
+/**
+ * Returns the value of the counter. Counts of threads we have created are
+ * only included once these threads have exited.
+ */
+uint64_t PerfCounters::get(int counter) const {
+	uint64_t value = 0;
+	if (descriptors[counter] < 0 || read(descriptors[counter], &value, sizeof(value)) != sizeof(value)) {
+		return 0;
+	}
+	return value;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+	descriptors.fill(-1);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {
+}
+
+void PerfCounters::stop() {
+}
+
+uint64_t PerfCounters::get(int counter) const {
+	return 0;
+}
+
+#endif
+
+bool PerfCounters::isSupported(int counter) const {
+	return descriptors[counter] >= 0;
+}
+
+/**
+ * Prints every counter in total and per node.
+ */
+void PerfCounters::print(std::ostream& output, uint64_t nodes) const {
+	for (int counter = 0; counter < VALUES_SIZE; counter++) {
+		output << toString(counter) << ": ";
+		if (isSupported(counter)) {
+			uint64_t value = get(counter);
+			output << value << " (" << std::fixed << std::setprecision(2)
+				   << static_cast<double>(value) / std::max<uint64_t>(nodes, 1) << "/node)";
+		} else {
+			output << "not supported";
+		}
+		output << std::endl;
+	}
+
+	if (isSupported(CYCLES) && isSupported(INSTRUCTIONS) && get(CYCLES) > 0) {
+		output << "IPC: " << std::fixed << std::setprecision(2)
+			   << static_cast<double>(get(INSTRUCTIONS)) / get(CYCLES) << std::endl;
+	}
+}
+
+std::string PerfCounters::toString(int counter) {
+	switch (counter) {
+		case CYCLES:
+			return "cycles";
+		case INSTRUCTIONS:
+			return "instructions";
+		case BRANCHMISSES:
+			return "branch-misses";
+		case L1DMISSES:
+			return "L1-dcache-load-misses";
+		case LLCMISSES:
+			return "LLC-load-misses";
+		case DTLBMISSES:
+			return "dTLB-load-misses";
+		default:
+			throw std::exception();
+	}
+}
+}
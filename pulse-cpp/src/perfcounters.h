@@ -0,0 +1,54 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace pulse {
+
+/**
+ * This class reads the hardware performance counters of the CPU through
+ * Linux perf events. The counters cover this thread and all threads it
+ * creates after open(). Counters the CPU or the kernel don't support are
+ * reported as such, on other platforms none are supported.
+ */
+class PerfCounters final {
+public:
+	static const int CYCLES = 0;
+	static const int INSTRUCTIONS = 1;
+	static const int BRANCHMISSES = 2;
+	static const int L1DMISSES = 3;
+	static const int LLCMISSES = 4;
+	static const int DTLBMISSES = 5;
+
+	static const int VALUES_SIZE = 6;
+
+	PerfCounters();
+
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	void start();
+
+	void stop();
+
+	bool isSupported(int counter) const;
+
+	uint64_t get(int counter) const;
+
+	void print(std::ostream& output, uint64_t nodes) const;
+
+	static std::string toString(int counter);
+
+private:
+	std::array<int, VALUES_SIZE> descriptors;
+};
+}
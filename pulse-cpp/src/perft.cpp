@@ -5,6 +5,7 @@
 
 #include "perft.h"
 #include "notation.h"
+#include "perfcounters.h"
 
 #include <iostream>
 #include <iomanip>
@@ -12,16 +13,27 @@
 
 namespace pulse {
 
-void Perft::run() {
+void Perft::run(int depth, bool useCounters) {
+	if (depth < 1 || depth > MAX_DEPTH) throw std::exception();
+
 	std::unique_ptr<Position> position(new Position(notation::toPosition(notation::STANDARDPOSITION)));
-	int depth = MAX_DEPTH;
 
 	std::cout << "Testing " << notation::fromPosition(*position) << " at depth " << depth << std::endl;
 
+	std::unique_ptr<PerfCounters> counters;
+	if (useCounters) {
+		counters = std::make_unique<PerfCounters>();
+		counters->start();
+	}
+
 	auto startTime = std::chrono::system_clock::now();
 	uint64_t result = miniMax(depth, *position, 0);
 	auto endTime = std::chrono::system_clock::now();
 
+	if (counters) {
+		counters->stop();
+	}
+
 	auto duration = endTime - startTime;
 
 	std::cout << "Nodes: ";
@@ -44,7 +56,12 @@ void Perft::run() {
 	std::cout << std::endl;
 
 	std::cout << "n/ms: "
-			  << result / std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() << std::endl;
+			  << result / std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), 1)
+			  << std::endl;
+
+	if (counters) {
+		counters->print(std::cout, result);
+	}
 }
 
 uint64_t Perft::miniMax(int depth, Position& position, int ply) {
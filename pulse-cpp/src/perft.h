@@ -10,11 +10,11 @@ namespace pulse {
 
 class Perft final {
 public:
-	void run();
-
-private:
 	static const int MAX_DEPTH = 6;
 
+	void run(int depth, bool useCounters);
+
+private:
 	std::array<MoveGenerator, MAX_DEPTH> moveGenerators;
 
 	uint64_t miniMax(int depth, Position& position, int ply);
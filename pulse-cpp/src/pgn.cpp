@@ -0,0 +1,229 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "pgn.h"
+#include "notation.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace pulse {
+
+std::string Game::getTag(const std::string& name) const {
+	for (auto& tag: tags) {
+		if (tag.first == name) {
+			return tag.second;
+		}
+	}
+
+	return "";
+}
+
+PgnReader::PgnReader(std::istream& input, uint64_t offset, uint64_t end)
+		: input(input), offset(offset), end(end) {
+}
+
+/**
+ * Reads the next game. Returns false if there are no more games, or if the
+ * next game starts at or after the end of our chunk.
+ */
+bool PgnReader::next(Game& game) {
+	game.tags.clear();
+	game.moves.clear();
+	game.result = PackedPosition::NORESULT;
+	game.error.clear();
+
+	// Skip everything up to the tags
+	while (hasLine || readLine()) {
+		hasLine = false;
+		if (!line.empty() && line[0] != '%') {
+			hasLine = true;
+			break;
+		}
+	}
+	if (!hasLine || lineOffset >= end) {
+		return false;
+	}
+
+	while (hasLine && !line.empty() && line[0] == '[') {
+		parseTag(game);
+		hasLine = readLine();
+	}
+
+	std::string fen = game.getTag("FEN");
+	try {
+		game.position = notation::toPosition(fen.empty() ? notation::STANDARDPOSITION : fen);
+
+		// No legal position has more pieces than we can pack
+		PackedPosition::pack(game.position);
+	} catch (std::exception&) {
+		game.position = notation::toPosition(notation::STANDARDPOSITION);
+		game.error = "Illegal FEN " + fen;
+	}
+	Position position = game.position;
+
+	bool inComment = false;
+	int variationDepth = 0;
+	while (hasLine) {
+		if (!inComment && variationDepth == 0 && !line.empty() && line[0] == '[') {
+			// The next game has started without a result
+			return true;
+		}
+
+		hasLine = false;
+		if (parseMovetext(line, game, position, inComment, variationDepth)) {
+			return true;
+		}
+
+		hasLine = readLine();
+	}
+
+	return true;
+}
+
+/**
+ * Returns the offset of the first game starting after offset. A game
+ * starts with a tag line following a line which is not a tag.
+ */
+uint64_t PgnReader::findGameStart(std::istream& input, uint64_t offset) {
+	input.clear();
+	input.seekg(static_cast<std::streamoff>(offset));
+
+	// We might be in the middle of a line, so we cannot trust the first one
+	std::string line;
+	if (!std::getline(input, line)) {
+		return offset;
+	}
+	offset += line.size() + 1;
+
+	bool previousIsTag = true;
+	while (std::getline(input, line)) {
+		bool isTag = !line.empty() && line[0] == '[';
+		if (isTag && !previousIsTag) {
+			return offset;
+		}
+		previousIsTag = isTag;
+		offset += line.size() + 1;
+	}
+
+	return std::numeric_limits<uint64_t>::max();
+}
+
+bool PgnReader::readLine() {
+	lineOffset = offset;
+	if (!std::getline(input, line)) {
+		return false;
+	}
+
+	offset += line.size() + 1;
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+
+	return true;
+}
+
+void PgnReader::parseTag(Game& game) {
+	std::string::size_type nameEnd = line.find_first_of(" \t\"]", 1);
+	std::string::size_type valueBegin = line.find('"');
+	if (nameEnd == std::string::npos || valueBegin == std::string::npos) {
+		return;
+	}
+
+	std::string value;
+	for (auto i = valueBegin + 1; i < line.size() && line[i] != '"'; i++) {
+		if (line[i] == '\\' && i + 1 < line.size()) {
+			i++;
+		}
+		value += line[i];
+	}
+
+	game.tags.emplace_back(line.substr(1, nameEnd - 1), value);
+}
+
+/**
+ * Parses one line of movetext. Returns true if we have seen the game
+ * termination marker.
+ */
+bool PgnReader::parseMovetext(const std::string& text, Game& game, Position& position,
+							  bool& inComment, int& variationDepth) {
+	std::string::size_type i = 0;
+	while (i < text.size()) {
+		char character = text[i];
+		if (inComment) {
+			if (character == '}') {
+				inComment = false;
+			}
+			i++;
+		} else if (character == '{') {
+			inComment = true;
+			i++;
+		} else if (character == ';') {
+			// Comment up to the end of the line
+			return false;
+		} else if (character == '(') {
+			variationDepth++;
+			i++;
+		} else if (character == ')') {
+			variationDepth = std::max(variationDepth - 1, 0);
+			i++;
+		} else if (std::isspace(static_cast<unsigned char>(character))) {
+			i++;
+		} else {
+			std::string::size_type tokenEnd = text.find_first_of(" \t{}();", i);
+			if (tokenEnd == std::string::npos) {
+				tokenEnd = text.size();
+			}
+			std::string token = text.substr(i, tokenEnd - i);
+			i = tokenEnd;
+
+			if (variationDepth > 0 || token[0] == '$') {
+				continue;
+			}
+
+			if (token == "1-0") {
+				game.result = PackedPosition::WHITEWINS;
+				return true;
+			} else if (token == "0-1") {
+				game.result = PackedPosition::BLACKWINS;
+				return true;
+			} else if (token == "1/2-1/2") {
+				game.result = PackedPosition::DRAW;
+				return true;
+			} else if (token == "*") {
+				return true;
+			}
+
+			// Move numbers may stick to the move like in "1.e4"
+			std::string::size_type moveBegin = token.find_first_not_of("0123456789.");
+			if (moveBegin != std::string::npos) {
+				addMove(token.substr(moveBegin), game, position);
+			}
+		}
+	}
+
+	return false;
+}
+
+void PgnReader::addMove(const std::string& token, Game& game, Position& position) {
+	// Once we failed, we skip the rest of the game
+	if (!game.error.empty()) {
+		return;
+	}
+	if (game.moves.size() >= static_cast<size_t>(MAX_MOVES)) {
+		game.error = "Too many moves";
+		return;
+	}
+
+	try {
+		int move = notation::toMove(position, token);
+		position.makeMove(move);
+		game.moves.push_back(move);
+	} catch (std::exception&) {
+		game.error = "Illegal move " + token;
+	}
+}
+}
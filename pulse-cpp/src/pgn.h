@@ -0,0 +1,71 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "position.h"
+#include "packedposition.h"
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class holds a game read from a PGN file. The moves are decoded
+ * starting from position.
+ */
+class Game final {
+public:
+	std::vector<std::pair<std::string, std::string>> tags;
+	Position position;
+	std::vector<int> moves;
+	// From White's point of view
+	int result = PackedPosition::NORESULT;
+
+	// Why we stopped decoding moves, empty if we decoded all of them
+	std::string error;
+
+	std::string getTag(const std::string& name) const;
+};
+
+/**
+ * This class reads one game after the other from a PGN stream. Comments,
+ * NAGs and variations are skipped. A reader can be limited to the games
+ * starting before a byte offset, so a file can be split into chunks.
+ */
+class PgnReader final {
+public:
+	static const int MAX_MOVES = 1024;
+
+	explicit PgnReader(std::istream& input, uint64_t offset = 0,
+					   uint64_t end = std::numeric_limits<uint64_t>::max());
+
+	bool next(Game& game);
+
+	static uint64_t findGameStart(std::istream& input, uint64_t offset);
+
+private:
+	std::istream& input;
+	uint64_t offset;
+	uint64_t end;
+
+	std::string line;
+	uint64_t lineOffset = 0;
+	bool hasLine = false;
+
+	bool readLine();
+
+	void parseTag(Game& game);
+
+	static bool parseMovetext(const std::string& text, Game& game, Position& position,
+							  bool& inComment, int& variationDepth);
+
+	static void addMove(const std::string& token, Game& game, Position& position);
+};
+}
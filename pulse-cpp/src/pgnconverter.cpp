@@ -0,0 +1,131 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "pgnconverter.h"
+#include "pgn.h"
+#include "packedposition.h"
+#include "threadpool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace pulse {
+
+namespace {
+constexpr std::streamsize BUFFER_SIZE = 1 << 20;
+}
+
+void PgnConverter::run(const std::string& inputPath, const std::string& outputPath, int threadCount) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::ifstream input(inputPath, std::ios::binary | std::ios::ate);
+	if (!input) {
+		throw std::runtime_error("Cannot open " + inputPath);
+	}
+	uint64_t size = static_cast<uint64_t>(input.tellg());
+
+	// Split the file into chunks of about the same size. Every chunk
+	// begins with a game.
+	std::vector<Chunk> chunks(threadCount);
+	for (int i = 1; i < threadCount; i++) {
+		chunks[i].begin = std::min(PgnReader::findGameStart(input, size * i / threadCount), size);
+		chunks[i].begin = std::max(chunks[i].begin, chunks[i - 1].begin);
+	}
+	for (int i = 0; i < threadCount; i++) {
+		chunks[i].end = i + 1 < threadCount ? chunks[i + 1].begin : size;
+	}
+
+	{
+		ThreadPool threadPool(threadCount);
+		std::vector<std::future<void>> futures;
+		for (int i = 0; i < threadCount; i++) {
+			futures.push_back(threadPool.submit([&, i] {
+				convert(inputPath, outputPath + ".part" + std::to_string(i), chunks[i]);
+			}));
+		}
+		for (auto& future: futures) {
+			future.get();
+		}
+	}
+
+	// Our files have no header, so we can simply concatenate them
+	std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+	for (int i = 0; i < threadCount; i++) {
+		std::string partPath = outputPath + ".part" + std::to_string(i);
+		{
+			std::ifstream part(partPath, std::ios::binary);
+			if (part.peek() != std::ifstream::traits_type::eof()) {
+				output << part.rdbuf();
+			}
+		}
+		std::remove(partPath.c_str());
+	}
+	output.close();
+	if (!output) {
+		throw std::runtime_error("Cannot write " + outputPath);
+	}
+
+	uint64_t games = 0;
+	uint64_t positions = 0;
+	uint64_t errors = 0;
+	for (auto& chunk: chunks) {
+		games += chunk.games;
+		positions += chunk.positions;
+		errors += chunk.errors;
+	}
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Games: " << games << std::endl;
+	std::cout << "Positions: " << positions << std::endl;
+	std::cout << "Errors: " << errors << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+}
+
+void PgnConverter::convert(const std::string& inputPath, const std::string& outputPath, Chunk& chunk) {
+	std::vector<char> buffer(BUFFER_SIZE);
+	std::ifstream input;
+	input.rdbuf()->pubsetbuf(buffer.data(), BUFFER_SIZE);
+	input.open(inputPath, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Cannot open " + inputPath);
+	}
+	input.seekg(static_cast<std::streamoff>(chunk.begin));
+
+	PgnReader reader(input, chunk.begin, chunk.end);
+	PackedPositionWriter writer(outputPath);
+	Game game;
+	while (reader.next(game)) {
+		chunk.games++;
+		if (!game.error.empty()) {
+			chunk.errors++;
+		}
+
+		// The moves before an error are still good
+		Position position = game.position;
+		for (auto move: game.moves) {
+			PackedPosition packedPosition;
+			try {
+				packedPosition = PackedPosition::pack(position);
+			} catch (std::invalid_argument&) {
+				// Only a broken FEN tag gets us here
+				chunk.errors++;
+				break;
+			}
+			packedPosition.move = move;
+			packedPosition.result = static_cast<int8_t>(game.result);
+			writer.write(packedPosition);
+			chunk.positions++;
+
+			position.makeMove(move);
+		}
+	}
+	writer.close();
+}
+}
@@ -0,0 +1,33 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace pulse {
+
+/**
+ * This class converts a PGN archive into packed positions. The archive is
+ * split into one chunk per thread at game boundaries. Every position before
+ * a move is written with the move and the game result.
+ */
+class PgnConverter final {
+public:
+	void run(const std::string& inputPath, const std::string& outputPath, int threadCount);
+
+private:
+	class Chunk final {
+	public:
+		uint64_t begin = 0;
+		uint64_t end = 0;
+		uint64_t games = 0;
+		uint64_t positions = 0;
+		uint64_t errors = 0;
+	};
+
+	static void convert(const std::string& inputPath, const std::string& outputPath, Chunk& chunk);
+};
+}
@@ -5,6 +5,7 @@
 
 #include "position.h"
 #include "model/move.h"
+#include "profile.h"
 
 namespace pulse {
 
@@ -221,6 +222,8 @@ int Position::remove(int square) {
 }
 
 void Position::makeMove(int move) {
+	PULSE_PROFILE_SCOPE(MAKEMOVE);
+
 	// Save state
 	State& entry = states[statesSize];
 	entry.zobristKey = zobristKey;
@@ -316,6 +319,8 @@ void Position::makeMove(int move) {
 }
 
 void Position::undoMove(int move) {
+	PULSE_PROFILE_SCOPE(UNDOMOVE);
+
 	// Get variables
 	int type = move::getType(move);
 	int originSquare = move::getOriginSquare(move);
@@ -433,6 +438,8 @@ bool Position::isCheck(int color) {
  * @return whether the targetSquare is attacked.
  */
 bool Position::isAttacked(int targetSquare, int attackerColor) {
+	PULSE_PROFILE_SCOPE(ISATTACKED);
+
 	// Pawn attacks
 	int pawnPiece = piece::valueOf(attackerColor, piecetype::PAWN);
 	for (unsigned int i = 1; i < square::pawnDirections[attackerColor].size(); i++) {
@@ -0,0 +1,105 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "profile.h"
+
+#ifdef PULSE_PROFILE
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace pulse::profile {
+
+namespace {
+
+/**
+ * The counters of all threads which have exited. We print them when the
+ * program exits, which happens after all thread local counters are gone.
+ */
+class Totals final {
+public:
+	std::mutex mutex;
+	std::array<uint64_t, VALUES_SIZE> calls{};
+	std::array<uint64_t, VALUES_SIZE> cycles{};
+
+	~Totals() {
+		std::cerr << std::left << std::setw(12) << "function"
+				  << std::right << std::setw(16) << "calls"
+				  << std::setw(20) << "cycles"
+				  << std::setw(12) << "cycles/call" << std::endl;
+		for (auto counter: values) {
+			std::cerr << std::left << std::setw(12) << toString(counter)
+					  << std::right << std::setw(16) << calls[counter]
+					  << std::setw(20) << cycles[counter]
+					  << std::setw(12) << (calls[counter] > 0 ? cycles[counter] / calls[counter] : 0) << std::endl;
+		}
+	}
+};
+
+Totals& totals() {
+	static Totals instance;
+	return instance;
+}
+}
+
+std::string toString(int counter) {
+	switch (counter) {
+		case MAKEMOVE:
+			return "makeMove";
+		case UNDOMOVE:
+			return "undoMove";
+		case ISATTACKED:
+			return "isAttacked";
+		case GETMOVES:
+			return "getMoves";
+		case SORT:
+			return "sort";
+		case EVALUATE:
+			return "evaluate";
+		default:
+			throw std::exception();
+	}
+}
+
+/**
+ * Returns the time stamp counter where we have one. Otherwise we fall back
+ * to nanoseconds.
+ */
+uint64_t readCycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+Counters::~Counters() {
+	Totals& global = totals();
+	std::unique_lock<std::mutex> lock(global.mutex);
+	for (auto counter: values) {
+		global.calls[counter] += calls[counter];
+		global.cycles[counter] += cycles[counter];
+	}
+}
+
+Counters& Counters::local() {
+	// Make sure the totals outlive the first thread local counters
+	totals();
+
+	thread_local Counters counters;
+	return counters;
+}
+}
+
+#endif
@@ -0,0 +1,76 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+/**
+ * Counts calls and cycles of our hot functions. This is compiled in only if
+ * PULSE_PROFILE is defined, otherwise PULSE_PROFILE_SCOPE expands to
+ * nothing. Every thread counts on its own and adds its counters to the
+ * totals when it exits. The totals are printed to stderr at program exit.
+ * Cycles include nested scopes, e.g. getMoves includes isAttacked.
+ */
+#ifdef PULSE_PROFILE
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace pulse::profile {
+
+constexpr int MAKEMOVE = 0;
+constexpr int UNDOMOVE = 1;
+constexpr int ISATTACKED = 2;
+constexpr int GETMOVES = 3;
+constexpr int SORT = 4;
+constexpr int EVALUATE = 5;
+
+constexpr int VALUES_SIZE = 6;
+constexpr std::array<int, VALUES_SIZE> values = {
+		MAKEMOVE, UNDOMOVE, ISATTACKED, GETMOVES, SORT, EVALUATE
+};
+
+std::string toString(int counter);
+
+uint64_t readCycles();
+
+class Counters final {
+public:
+	std::array<uint64_t, VALUES_SIZE> calls{};
+	std::array<uint64_t, VALUES_SIZE> cycles{};
+
+	~Counters();
+
+	static Counters& local();
+};
+
+class Scope final {
+public:
+	explicit Scope(int counter)
+			: counter(counter), start(readCycles()) {
+	}
+
+	~Scope() {
+		Counters& counters = Counters::local();
+		counters.calls[counter]++;
+		counters.cycles[counter] += readCycles() - start;
+	}
+
+	Scope(const Scope&) = delete;
+
+	Scope& operator=(const Scope&) = delete;
+
+private:
+	const int counter;
+	const uint64_t start;
+};
+}
+
+#define PULSE_PROFILE_SCOPE(counter) pulse::profile::Scope profileScope(pulse::profile::counter)
+
+#else
+
+#define PULSE_PROFILE_SCOPE(counter)
+
+#endif
@@ -4,7 +4,10 @@
 // found in the LICENSE file.
 
 #include "pulse.h"
+#include "trace.h"
+#include "allocationtracker.h"
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <locale>
@@ -12,10 +15,15 @@
 namespace pulse {
 
 void Pulse::run() {
-	std::cin.exceptions(std::iostream::eofbit | std::iostream::failbit | std::iostream::badbit);
+	Trace::setThreadName("main");
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
+	// Read commands in a separate thread, so we can answer isready and queue
+	// up new commands while the main thread is busy.
+	std::thread reader(&Pulse::read, this);
+
 	while (true) {
-		std::string line;
-		std::getline(std::cin, line);
+		std::string line = commands.pop();
 		std::istringstream input(line);
 
 		std::string token;
@@ -24,8 +32,8 @@ void Pulse::run() {
 			receiveInitialize();
 		} else if (token == "debug") {
 			receiveDebug(input);
-		} else if (token == "isready") {
-			receiveReady();
+		} else if (token == "setoption") {
+			receiveSetOption(input);
 		} else if (token == "ucinewgame") {
 			receiveNewGame();
 		} else if (token == "position") {
@@ -36,21 +44,145 @@ void Pulse::run() {
 			receiveStop();
 		} else if (token == "ponderhit") {
 			receivePonderHit();
+		} else if (token == "savehash") {
+			receiveSaveHash(input);
+		} else if (token == "hash") {
+			receiveHash(input);
+		} else if (token == "memory") {
+			receiveMemory();
+		} else if (token == "isready") {
+			receiveReady();
 		} else if (token == "quit") {
 			receiveQuit();
 			break;
 		}
 	}
+
+	reader.join();
+}
+
+void Pulse::read() {
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
+	std::string line;
+	while (std::getline(std::cin, line)) {
+		std::istringstream input(line);
+
+		std::string token;
+		input >> std::skipws >> token;
+		if (token == "isready" && (searching || commands.isIdle())) {
+			// Answer right away. Nothing is in front of us, or a search is
+			// running and the client must not wait for it.
+			receiveReady();
+		} else {
+			commands.push(line);
+
+			if (token == "quit") {
+				return;
+			}
+		}
+	}
+
+	// Our input has been closed. Treat it like a quit command.
+	commands.push("quit");
+}
+
+void Pulse::CommandQueue::push(const std::string& line) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		lines.push_back(line);
+	}
+	condition.notify_one();
+}
+
+/**
+ * Returns the next command to execute. A position command is skipped if the
+ * client has already sent another position before the next go, because
+ * nobody will ever search it.
+ */
+std::string Pulse::CommandQueue::pop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		waiting = true;
+		condition.wait(lock, [this] { return !lines.empty(); });
+		waiting = false;
+
+		std::string line = lines.front();
+		lines.pop_front();
+
+		if (tokenOf(line) != "position" || !isSuperseded("position")) {
+			return line;
+		}
+	}
+}
+
+/**
+ * Returns whether a command with this token is waiting in the queue.
+ */
+bool Pulse::CommandQueue::contains(const std::string& token) {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (auto& line: lines) {
+		if (tokenOf(line) == token) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Returns whether the main thread waits for a command and none is queued.
+ */
+bool Pulse::CommandQueue::isIdle() {
+	std::unique_lock<std::mutex> lock(mutex);
+	return waiting && lines.empty();
+}
+
+std::string Pulse::CommandQueue::tokenOf(const std::string& line) {
+	std::istringstream input(line);
+	std::string token;
+	input >> std::skipws >> token;
+	return token;
+}
+
+/**
+ * Returns whether the queue holds another position command before the next
+ * go command. Must be called with the mutex held.
+ */
+bool Pulse::CommandQueue::isSuperseded(const std::string& token) {
+	for (auto& line: lines) {
+		std::string next = tokenOf(line);
+		if (next == "go") {
+			return false;
+		} else if (next == token || next == "quit") {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 void Pulse::receiveQuit() {
 	// We received a quit command. Stop calculating now and
 	// cleanup!
+	distributedSearch.reset();
 	search->quit();
+	closeTrace();
 }
 
-void Pulse::receiveInitialize() {
+/**
+ * Stops whichever search is running, local or distributed.
+ */
+void Pulse::stopSearch() {
+	if (distributedSearch) {
+		distributedSearch->stop();
+	}
+	monteCarloSearch->stop();
 	search->stop();
+}
+
+void Pulse::receiveInitialize() {
+	stopSearch();
 
 	// We received an initialization request.
 
@@ -59,8 +191,22 @@ void Pulse::receiveInitialize() {
 	// program.
 
 	// We must send an initialization answer back!
+	std::unique_lock<std::mutex> lock(outputMutex);
 	std::cout << "id name Pulse C++ 2.0.0" << std::endl;
 	std::cout << "id author Phokham Nonava" << std::endl;
+	std::cout << "option name Hash type spin default 16 min 1 max " << MAX_HASH_SIZE << std::endl;
+	std::cout << "option name HashFile type string default <empty>" << std::endl;
+	std::cout << "option name HashFileMode type combo default CopyOnWrite var CopyOnWrite var ReadOnly" << std::endl;
+	std::cout << "option name AnalysisCache type string default <empty>" << std::endl;
+	std::cout << "option name AnalysisCacheSize type spin default 64 min 1 max " << MAX_ANALYSIS_CACHE_SIZE
+			  << std::endl;
+	std::cout << "option name OwnBook type check default false" << std::endl;
+	std::cout << "option name BookFile type string default <empty>" << std::endl;
+	std::cout << "option name SyzygyPath type string default <empty>" << std::endl;
+	std::cout << "option name SearchMode type combo default AlphaBeta var AlphaBeta var MonteCarlo" << std::endl;
+	std::cout << "option name Threads type spin default 1 min 1 max " << MonteCarloSearch::MAX_THREADS << std::endl;
+	std::cout << "option name Workers type spin default 0 min 0 max " << MAX_WORKERS << std::endl;
+	std::cout << "option name TraceFile type string default <empty>" << std::endl;
 	std::cout << "uciok" << std::endl;
 }
 
@@ -85,28 +231,352 @@ void Pulse::receiveDebug(std::istringstream& input) {
 	}
 }
 
+void Pulse::receiveSetOption(std::istringstream& input) {
+	stopSearch();
+
+	// We received an option. The name may contain spaces, so read it up to
+	// the value token. The value is the rest of the line.
+	std::string token;
+	input >> token;
+	if (token != "name") {
+		sendInfo("Missing option name");
+		return;
+	}
+
+	std::string name;
+	while (input >> token && token != "value") {
+		name += (name.empty() ? "" : " ") + token;
+	}
+
+	std::string value;
+	std::getline(input >> std::ws, value);
+
+	if (name == "Hash") {
+		if (!parseSpin(value, 1, MAX_HASH_SIZE, hashSize)) {
+			sendInfo("Illegal value: " + value);
+			return;
+		}
+		hashFile.clear();
+		openHash();
+	} else if (name == "HashFile") {
+		hashFile = value == "<empty>" ? "" : value;
+		openHash();
+	} else if (name == "HashFileMode") {
+		if (value == "ReadOnly") {
+			hashFileMode = MappedFile::READONLY;
+		} else if (value == "CopyOnWrite") {
+			hashFileMode = MappedFile::COPYONWRITE;
+		} else {
+			sendInfo("Unknown value: " + value);
+			return;
+		}
+		if (!hashFile.empty()) {
+			openHash();
+		}
+	} else if (name == "AnalysisCache") {
+		analysisCachePath = value == "<empty>" ? "" : value;
+		openAnalysisCache();
+	} else if (name == "AnalysisCacheSize") {
+		if (!parseSpin(value, 1, MAX_ANALYSIS_CACHE_SIZE, analysisCacheSize)) {
+			sendInfo("Illegal value: " + value);
+			return;
+		}
+		openAnalysisCache();
+	} else if (name == "OwnBook") {
+		ownBook = value == "true";
+		openBook();
+	} else if (name == "BookFile") {
+		bookPath = value == "<empty>" ? "" : value;
+		openBook();
+	} else if (name == "SyzygyPath") {
+		openTablebases(value == "<empty>" ? "" : value);
+	} else if (name == "SearchMode") {
+		if (value == "AlphaBeta") {
+			searchMode = ALPHABETA;
+		} else if (value == "MonteCarlo") {
+			searchMode = MONTECARLO;
+		} else {
+			sendInfo("Unknown value: " + value);
+			return;
+		}
+	} else if (name == "Threads") {
+		uint64_t threads;
+		if (!parseSpin(value, 1, MonteCarloSearch::MAX_THREADS, threads)) {
+			sendInfo("Illegal value: " + value);
+			return;
+		}
+		threadCount = static_cast<int>(threads);
+		monteCarloSearch->setThreads(threadCount);
+	} else if (name == "Workers") {
+		uint64_t workers;
+		if (!parseSpin(value, 0, MAX_WORKERS, workers)) {
+			sendInfo("Illegal value: " + value);
+			return;
+		}
+		workerCount = static_cast<int>(workers);
+		openWorkers();
+	} else if (name == "TraceFile") {
+		closeTrace();
+		if (value != "<empty>") {
+			Trace::open(value);
+			sendInfo("Recording trace to " + value);
+		}
+	} else {
+		sendInfo("Unknown option: " + name);
+		return;
+	}
+
+	// Our workers should use the same search settings as we do
+	if (distributedSearch && (name == "Hash" || name == "HashFile" || name == "HashFileMode"
+							  || name == "SearchMode" || name == "Threads")) {
+		distributedSearch->setOption("setoption name " + name + " value " + value);
+	}
+}
+
+/**
+ * Parses the value of a spin option, which must lie in the range we have
+ * announced.
+ */
+bool Pulse::parseSpin(const std::string& value, uint64_t min, uint64_t max, uint64_t& result) {
+	uint64_t number;
+	try {
+		size_t length;
+		number = std::stoull(value, &length);
+		if (value[0] == '-' || length != value.size()) {
+			return false;
+		}
+	} catch (std::exception&) {
+		return false;
+	}
+
+	if (number < min || number > max) {
+		return false;
+	}
+	result = number;
+	return true;
+}
+
+/**
+ * Starts our worker processes. With no workers we search in this process.
+ */
+void Pulse::openWorkers() {
+	distributedSearch.reset();
+
+	if (workerCount > 0) {
+		try {
+			distributedSearch = std::make_unique<DistributedSearch>(*this, workerCount);
+			distributedSearch->setOption("setoption name Hash value " + std::to_string(hashSize));
+			if (!hashFile.empty()) {
+				distributedSearch->setOption(std::string("setoption name HashFileMode value ")
+						+ (hashFileMode == MappedFile::READONLY ? "ReadOnly" : "CopyOnWrite"));
+				distributedSearch->setOption("setoption name HashFile value " + hashFile);
+			}
+			distributedSearch->setOption(std::string("setoption name SearchMode value ")
+					+ (searchMode == MONTECARLO ? "MonteCarlo" : "AlphaBeta"));
+			distributedSearch->setOption("setoption name Threads value " + std::to_string(threadCount));
+			sendInfo("Using " + std::to_string(workerCount) + " workers");
+		} catch (std::runtime_error& e) {
+			sendInfo(e.what());
+		}
+	}
+}
+
+void Pulse::openBook() {
+	book.reset();
+
+	if (ownBook && !bookPath.empty()) {
+		try {
+			book = std::make_unique<Book>(bookPath);
+			sendInfo("Using book " + bookPath + " with " + std::to_string(book->size()) + " entries");
+		} catch (std::runtime_error& e) {
+			sendInfo(e.what());
+		}
+	}
+}
+
+void Pulse::openTablebases(const std::string& path) {
+	search->setTablebases(nullptr);
+	tablebases.setPath(path);
+
+	if (tablebases.getTableCount() > 0) {
+		search->setTablebases(&tablebases);
+		sendInfo("Found " + std::to_string(tablebases.getTableCount()) + " tablebases with up to "
+				 + std::to_string(tablebases.getMaxPieces()) + " pieces");
+	}
+}
+
+void Pulse::openAnalysisCache() {
+	search->setAnalysisCache(nullptr);
+	analysisCache.reset();
+
+	if (!analysisCachePath.empty()) {
+		try {
+			analysisCache = std::make_unique<AnalysisCache>(analysisCachePath, analysisCacheSize);
+			search->setAnalysisCache(analysisCache.get());
+			sendInfo("Using analysis cache " + analysisCachePath
+					 + " with " + std::to_string(analysisCache->getCapacity()) + " entries");
+		} catch (std::runtime_error& e) {
+			sendInfo(e.what());
+		}
+	}
+}
+
+/**
+ * Maps the hash file if we have one. Otherwise allocate a fresh table.
+ */
+void Pulse::openHash() {
+	if (!hashFile.empty()) {
+		try {
+			search->loadHash(hashFile, hashFileMode);
+			sendInfo("Using hash file " + hashFile
+					 + " with " + std::to_string(search->getHashCapacity()) + " entries");
+			return;
+		} catch (std::runtime_error& e) {
+			sendInfo(e.what());
+		}
+	}
+
+	search->setHashSize(hashSize);
+	sendInfo("Using hash with " + std::to_string(search->getHashCapacity()) + " entries on "
+			 + LargePageMemory::toString(search->getHashMemoryKind()));
+}
+
+/**
+ * Writes the trace we have recorded so far, if any.
+ */
+void Pulse::closeTrace() {
+	try {
+		Trace::close();
+	} catch (std::runtime_error& e) {
+		sendInfo(e.what());
+	}
+}
+
+void Pulse::receiveSaveHash(std::istringstream& input) {
+	stopSearch();
+
+	std::string path;
+	std::getline(input >> std::ws, path);
+	if (path.empty()) {
+		sendInfo("Missing file name");
+		return;
+	}
+
+	try {
+		search->saveHash(path);
+		sendInfo("Saved hash to " + path);
+	} catch (std::runtime_error& e) {
+		sendInfo(e.what());
+	}
+}
+
+/**
+ * Stores a principal variation, which another worker of a distributed search
+ * has found from our current position, in our transposition table. Our own
+ * search may reach these positions through its other root moves.
+ */
+void Pulse::receiveHash(std::istringstream& input) {
+	int depth = 0;
+	int value = value::NOVALUE;
+	std::vector<int> pv;
+
+	std::string token;
+	while (input >> token) {
+		if (token == "depth") {
+			input >> depth;
+		} else if (token == "value") {
+			input >> value;
+		} else if (token == "pv") {
+			break;
+		}
+	}
+	if (!input || value == value::NOVALUE) {
+		return;
+	}
+
+	Position position = *currentPosition;
+	MoveGenerator moveGenerator;
+	while (input >> token) {
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		int move = move::NOMOVE;
+		for (int i = 0; i < moves.size; i++) {
+			if (fromMove(moves.entries[i]->move) == token) {
+				move = moves.entries[i]->move;
+				break;
+			}
+		}
+
+		if (move == move::NOMOVE) {
+			break;
+		}
+		position.makeMove(move);
+		pv.push_back(move);
+	}
+
+	// We don't search the first move ourselves, so we start after it.
+	position = *currentPosition;
+	for (int ply = 1; ply < static_cast<int>(pv.size()) && depth - ply > 0; ply++) {
+		position.makeMove(pv[ply - 1]);
+		search->addSharedEntry(position.zobristKey, pv[ply], value, depth - ply, ply);
+	}
+}
+
+/**
+ * Prints the size of our big objects and the heap allocations per
+ * subsystem. The allocations are only counted if we were built with
+ * PULSE_TRACK_ALLOCATIONS.
+ */
+void Pulse::receiveMemory() {
+	stopSearch();
+
+	sendInfo("memory search " + std::to_string(sizeof(Search)) + " bytes"
+			 + " position " + std::to_string(sizeof(Position)) + " bytes"
+			 + " hash " + std::to_string(search->getHashCapacity()) + " entries");
+
+	if (!allocation::isEnabled()) {
+		sendInfo("Allocation tracking is not compiled in");
+		return;
+	}
+
+	for (auto subsystem: allocation::values) {
+		allocation::Statistics statistics = allocation::get(subsystem);
+		sendInfo("memory " + allocation::toString(subsystem)
+				 + " allocations " + std::to_string(statistics.allocations)
+				 + " deallocations " + std::to_string(statistics.deallocations)
+				 + " bytes " + std::to_string(statistics.bytes)
+				 + " peak " + std::to_string(statistics.peakBytes)
+				 + " total " + std::to_string(statistics.totalBytes));
+	}
+	sendInfo("memory last search thread allocations " + std::to_string(search->getStatistics().allocations));
+}
+
 void Pulse::receiveReady() {
 	// We received a ready request. We must send the token back as soon as we
 	// can. However, because we launch the search in a separate thread, our main
 	// thread is able to handle the commands asynchronously to the search. If we
 	// don't answer the ready request in time, our engine will probably be
 	// killed by the GUI.
+	std::unique_lock<std::mutex> lock(outputMutex);
 	std::cout << "readyok" << std::endl;
 }
 
 void Pulse::receiveNewGame() {
-	search->stop();
+	stopSearch();
 
 	// We received a new game command.
 
 	// Initialize per-game settings here.
 	*currentPosition = notation::toPosition(notation::STANDARDPOSITION);
+	search->clearHash();
+	if (distributedSearch) {
+		distributedSearch->newGame();
+	}
 }
 
 void Pulse::receivePosition(std::istringstream& input) {
-	search->stop();
-
-	// We received an position command. Just setup the position.
+	// We received an position command. Just setup the position. We don't
+	// have to stop a running search here, because the search keeps its own
+	// copy of the position.
 
 	std::string token;
 	input >> token;
@@ -157,32 +627,33 @@ void Pulse::receivePosition(std::istringstream& input) {
 	// Don't start searching though!
 }
 
-void Pulse::receiveGo(std::istringstream& input) {
-	search->stop();
-
-	// We received a start command. Extract all parameters from the
-	// command and start the search.
+/**
+ * Sets up the search parameters of a go command on either of our searches.
+ */
+template<class T>
+void Pulse::newSearch(T& engine, std::istringstream& input) {
+	// Extract all search parameters from the go command.
 	std::string token;
 	input >> token;
 	if (token == "depth") {
 		int searchDepth;
 		if (input >> searchDepth) {
-			search->newDepthSearch(*currentPosition, searchDepth);
+			engine.newDepthSearch(*currentPosition, searchDepth);
 		} else {
 			throw std::exception();
 		}
 	} else if (token == "nodes") {
 		uint64_t searchNodes;
 		if (input >> searchNodes) {
-			search->newNodesSearch(*currentPosition, searchNodes);
+			engine.newNodesSearch(*currentPosition, searchNodes);
 		}
 	} else if (token == "movetime") {
 		uint64_t searchTime;
 		if (input >> searchTime) {
-			search->newTimeSearch(*currentPosition, searchTime);
+			engine.newTimeSearch(*currentPosition, searchTime);
 		}
 	} else if (token == "infinite") {
-		search->newInfiniteSearch(*currentPosition);
+		engine.newInfiniteSearch(*currentPosition);
 	} else {
 		uint64_t whiteTimeLeft = 1;
 		uint64_t whiteTimeIncrement = 0;
@@ -218,33 +689,126 @@ void Pulse::receiveGo(std::istringstream& input) {
 		} while (input >> token);
 
 		if (ponder) {
-			search->newPonderSearch(*currentPosition,
+			engine.newPonderSearch(*currentPosition,
 					whiteTimeLeft, whiteTimeIncrement, blackTimeLeft, blackTimeIncrement,
 					searchMovesToGo);
 		} else {
-			search->newClockSearch(*currentPosition,
+			engine.newClockSearch(*currentPosition,
 					whiteTimeLeft, whiteTimeIncrement, blackTimeLeft, blackTimeIncrement,
 					searchMovesToGo);
 		}
 	}
+}
+
+void Pulse::receiveGo(std::istringstream& input) {
+	stopSearch();
+
+	// Take the searchmoves apart from the other parameters. They run up to
+	// the next parameter or the end of the line.
+	static const std::vector<std::string> parameters = {
+			"ponder", "wtime", "btime", "winc", "binc", "movestogo", "depth", "nodes", "mate", "movetime",
+			"infinite"
+	};
+	std::vector<int> searchMoves;
+	std::string remaining;
+	std::string token;
+	while (input >> token) {
+		if (token == "searchmoves") {
+			MoveGenerator moveGenerator;
+			MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(*currentPosition, 1, currentPosition->isCheck());
+			while (input >> token
+				   && std::find(parameters.begin(), parameters.end(), token) == parameters.end()) {
+				bool found = false;
+				for (int i = 0; i < moves.size; i++) {
+					if (fromMove(moves.entries[i]->move) == token) {
+						searchMoves.push_back(moves.entries[i]->move);
+						found = true;
+						break;
+					}
+				}
+
+				if (!found) {
+					throw std::exception();
+				}
+			}
+
+			if (!input) {
+				break;
+			}
+		}
+
+		remaining += (remaining.empty() ? "" : " ") + token;
+	}
+
+	// If the client has already sent another go command, this search would be
+	// stopped as soon as it started. A search to depth 1 still answers it
+	// with a searched move without holding up the next one.
+	if (commands.contains("go")) {
+		remaining = "depth 1";
+	}
+
+	// A book move is sent right away. We don't use the book while analyzing
+	// or pondering, as the client is waiting for a search then.
+	if (book && searchMoves.empty()) {
+		bool isAnalysis = false;
+		std::istringstream tokens(remaining);
+		while (tokens >> token) {
+			isAnalysis = isAnalysis || token == "infinite" || token == "ponder";
+		}
+
+		int bookMove = isAnalysis ? +move::NOMOVE : book->probe(*currentPosition);
+		if (bookMove != move::NOMOVE) {
+			sendBestMove(bookMove, move::NOMOVE);
+			return;
+		}
+	}
+
+	searching = true;
+	if (distributedSearch) {
+		startTime = std::chrono::system_clock::now();
+		statusStartTime = startTime;
+		distributedSearch->start(*currentPosition, remaining, searchMoves);
+		return;
+	}
+
+	std::istringstream arguments(remaining);
+	if (searchMode == MONTECARLO) {
+		newSearch(*monteCarloSearch, arguments);
+		monteCarloSearch->setSearchMoves(searchMoves);
+	} else {
+		newSearch(*search, arguments);
+		search->setSearchMoves(searchMoves);
+	}
 
 	// Go...
-	search->start();
 	startTime = std::chrono::system_clock::now();
 	statusStartTime = startTime;
+	if (searchMode == MONTECARLO) {
+		monteCarloSearch->start();
+	} else {
+		search->start();
+	}
 }
 
 void Pulse::receivePonderHit() {
 	// We received a ponder hit command. Just call ponderhit().
+	if (distributedSearch) {
+		distributedSearch->ponderhit();
+	}
+	monteCarloSearch->ponderhit();
 	search->ponderhit();
 }
 
 void Pulse::receiveStop() {
 	// We received a stop command. If a search is running, stop it.
-	search->stop();
+	stopSearch();
 }
 
 void Pulse::sendBestMove(int bestMove, int ponderMove) {
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
+	std::unique_lock<std::mutex> lock(outputMutex);
+	searching = false;
 	std::cout << "bestmove ";
 
 	if (bestMove != move::NOMOVE) {
@@ -271,10 +835,13 @@ void Pulse::sendStatus(
 void Pulse::sendStatus(
 		bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
 		int currentMoveNumber) {
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
 	auto timeDelta = std::chrono::duration_cast<std::chrono::milliseconds>(
 			std::chrono::system_clock::now() - startTime);
 
 	if (force || timeDelta.count() >= 1000) {
+		std::unique_lock<std::mutex> lock(outputMutex);
 		std::cout << "info";
 		std::cout << " depth " << currentDepth;
 		std::cout << " seldepth " << currentMaxDepth;
@@ -294,9 +861,12 @@ void Pulse::sendStatus(
 }
 
 void Pulse::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) {
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
 	auto timeDelta = std::chrono::duration_cast<std::chrono::milliseconds>(
 			std::chrono::system_clock::now() - startTime);
 
+	std::unique_lock<std::mutex> lock(outputMutex);
 	std::cout << "info";
 	std::cout << " depth " << currentDepth;
 	std::cout << " seldepth " << currentMaxDepth;
@@ -325,11 +895,17 @@ void Pulse::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uin
 }
 
 void Pulse::sendInfo(const std::string& message) {
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
+	std::unique_lock<std::mutex> lock(outputMutex);
 	std::cout << "info string " << message << std::endl;
 }
 
 void Pulse::sendDebug(const std::string& message) {
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
 	if (debug) {
+		std::unique_lock<std::mutex> lock(outputMutex);
 		std::cout << "info string " << message << std::endl;
 	}
 }
@@ -4,9 +4,14 @@
 // found in the LICENSE file.
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <deque>
 
 #include "search.h"
+#include "book.h"
+#include "distributedsearch.h"
+#include "montecarlosearch.h"
 #include "notation.h"
 
 namespace pulse {
@@ -33,25 +38,110 @@ public:
 
 	void sendDebug(const std::string& message) override;
 
+	/**
+	 * This queue decouples reading commands from executing them. The reader
+	 * thread keeps accepting input while the main thread waits for the search
+	 * to acknowledge a stop.
+	 */
+	class CommandQueue final {
+	public:
+		void push(const std::string& line);
+
+		std::string pop();
+
+		bool contains(const std::string& token);
+
+		bool isIdle();
+
+	private:
+		std::deque<std::string> lines;
+		std::mutex mutex;
+		std::condition_variable condition;
+		// Whether the main thread waits for a command
+		bool waiting = false;
+
+		static std::string tokenOf(const std::string& line);
+
+		bool isSuperseded(const std::string& token);
+	};
+
 private:
-	bool debug;
+	static const int ALPHABETA = 0;
+	static const int MONTECARLO = 1;
+
+	static const uint64_t MAX_HASH_SIZE = 65536;
+	static const uint64_t MAX_ANALYSIS_CACHE_SIZE = 1048576;
+	static const uint64_t MAX_WORKERS = 256;
+
+	bool debug = false;
+	CommandQueue commands;
+	std::mutex outputMutex;
+	// Whether a search will still send a best move
+	std::atomic<bool> searching{false};
+
+	// Options
+	uint64_t hashSize = 16;
+	std::string hashFile;
+	int hashFileMode = MappedFile::COPYONWRITE;
+	std::string analysisCachePath;
+	uint64_t analysisCacheSize = 64;
+	std::unique_ptr<AnalysisCache> analysisCache;
+	bool ownBook = false;
+	std::string bookPath;
+	std::unique_ptr<Book> book;
+	Tablebases tablebases;
+	int searchMode = ALPHABETA;
+	int threadCount = 1;
+	int workerCount = 0;
+	std::unique_ptr<DistributedSearch> distributedSearch;
+
 	std::unique_ptr<Search> search = std::make_unique<Search>(*this);
+	std::unique_ptr<MonteCarloSearch> monteCarloSearch = std::make_unique<MonteCarloSearch>(*this);
 	std::chrono::system_clock::time_point startTime;
 	std::chrono::system_clock::time_point statusStartTime;
 
 	std::unique_ptr<Position> currentPosition = std::make_unique<Position>(
 			notation::toPosition(notation::STANDARDPOSITION));
 
+	void read();
+
 	void receiveInitialize();
 
 	void receiveDebug(std::istringstream& istringstream);
 
-	static void receiveReady();
+	void receiveSetOption(std::istringstream& input);
+
+	static bool parseSpin(const std::string& value, uint64_t min, uint64_t max, uint64_t& result);
+
+	void openAnalysisCache();
+
+	void openBook();
+
+	void openTablebases(const std::string& path);
+
+	void openHash();
+
+	void openWorkers();
+
+	void stopSearch();
+
+	void closeTrace();
+
+	void receiveSaveHash(std::istringstream& input);
+
+	void receiveHash(std::istringstream& input);
+
+	void receiveMemory();
+
+	void receiveReady();
 
 	void receiveNewGame();
 
 	void receivePosition(std::istringstream& input);
 
+	template<class T>
+	void newSearch(T& engine, std::istringstream& input);
+
 	void receiveGo(std::istringstream& input);
 
 	void receivePonderHit();
@@ -0,0 +1,145 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "scaling.h"
+#include "bench.h"
+#include "montecarlosearch.h"
+#include "notation.h"
+#include "search.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace pulse {
+
+void Scaling::run(int maxThreads, uint64_t searchTime, uint64_t searchNodes, int referenceDepth) {
+	if (maxThreads < 1 || maxThreads > MonteCarloSearch::MAX_THREADS) throw std::exception();
+	if (searchTime < 1 || searchNodes < 1 || referenceDepth < 1) throw std::exception();
+
+	std::vector<Position> positions;
+	for (auto fen: Bench::FENS) {
+		positions.push_back(notation::toPosition(fen));
+	}
+
+	// The reference moves come from a single threaded Alpha-beta search, so
+	// they are the same on every machine.
+	std::vector<int> referenceMoves;
+	{
+		Search search(*this);
+		for (auto& position: positions) {
+			search.clearHash();
+			search.newDepthSearch(position, referenceDepth);
+			searchUntilBestMove(search);
+			referenceMoves.push_back(bestMove);
+		}
+		search.quit();
+	}
+
+	std::vector<int> threadCounts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	MonteCarloSearch search(*this);
+	uint64_t baseSpeed = 0;
+	uint64_t baseTimeToNodes = 0;
+
+	std::cout << "threads,nodes,nps,npsscaling,timetonodes,speedup,agreement" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (auto threads: threadCounts) {
+		search.setThreads(threads);
+
+		uint64_t totalNodes = 0;
+		uint64_t totalTime = 0;
+		uint64_t timeToNodes = 0;
+		int agreements = 0;
+		for (unsigned int i = 0; i < positions.size(); i++) {
+			search.newTimeSearch(positions[i], searchTime);
+			totalTime += searchUntilBestMove(search);
+			totalNodes += nodes;
+			if (bestMove == referenceMoves[i]) {
+				agreements++;
+			}
+
+			search.newNodesSearch(positions[i], searchNodes);
+			timeToNodes += searchUntilBestMove(search);
+		}
+
+		uint64_t speed = totalNodes * 1000 / std::max<uint64_t>(totalTime, 1);
+		if (threads == 1) {
+			baseSpeed = speed;
+			baseTimeToNodes = timeToNodes;
+		}
+
+		std::cout << threads;
+		std::cout << "," << totalNodes;
+		std::cout << "," << speed;
+		std::cout << "," << static_cast<double>(speed) / std::max<uint64_t>(baseSpeed, 1);
+		std::cout << "," << timeToNodes;
+		std::cout << "," << static_cast<double>(baseTimeToNodes) / std::max<uint64_t>(timeToNodes, 1);
+		std::cout << "," << static_cast<double>(agreements) / positions.size();
+		std::cout << std::endl;
+	}
+}
+
+/**
+ * Runs the search until it sends its best move and returns the time it
+ * took in milliseconds.
+ */
+template<class T>
+uint64_t Scaling::searchUntilBestMove(T& engine) {
+	std::unique_lock<std::mutex> lock(mutex);
+	finished = false;
+	nodes = 0;
+	bestMove = move::NOMOVE;
+	lock.unlock();
+
+	auto startTime = std::chrono::steady_clock::now();
+	engine.start();
+
+	lock.lock();
+	condition.wait(lock, [this] { return finished; });
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+	lock.unlock();
+
+	// Wait until the search thread has finished
+	engine.stop();
+
+	return duration;
+}
+
+void Scaling::sendBestMove(int _bestMove, int ponderMove) {
+	std::unique_lock<std::mutex> lock(mutex);
+	bestMove = _bestMove;
+	finished = true;
+	condition.notify_all();
+}
+
+void Scaling::sendStatus(
+		int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove, int currentMoveNumber) {
+}
+
+void Scaling::sendStatus(
+		bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+		int currentMoveNumber) {
+	if (force) {
+		std::unique_lock<std::mutex> lock(mutex);
+		nodes = totalNodes;
+	}
+}
+
+void Scaling::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) {
+}
+
+void Scaling::sendInfo(const std::string& message) {
+}
+
+void Scaling::sendDebug(const std::string& message) {
+}
+}
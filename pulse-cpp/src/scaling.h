@@ -0,0 +1,57 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "protocol.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace pulse {
+
+/**
+ * This class measures how the Monte Carlo search scales with threads. It
+ * searches the bench positions with 1, 2, 4, ... threads and prints a CSV
+ * line per thread count with the speed, the time to grow the tree to a fixed
+ * number of playouts and how often we agree with a deep Alpha-beta search.
+ * The depth of the tree is no measure of the work done, as it only follows
+ * the most visited moves.
+ */
+class Scaling final : public Protocol {
+public:
+	static const int REFERENCE_DEPTH = 6;
+	static const uint64_t SEARCH_NODES = 200;
+	static const uint64_t SEARCH_TIME = 1000;
+
+	void run(int maxThreads, uint64_t searchTime = SEARCH_TIME, uint64_t searchNodes = SEARCH_NODES,
+			 int referenceDepth = REFERENCE_DEPTH);
+
+	void sendBestMove(int bestMove, int ponderMove) override;
+
+	void sendStatus(
+			int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+			int currentMoveNumber) override;
+
+	void sendStatus(
+			bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+			int currentMoveNumber) override;
+
+	void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override;
+
+	void sendInfo(const std::string& message) override;
+
+	void sendDebug(const std::string& message) override;
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool finished = false;
+	uint64_t nodes = 0;
+	int bestMove = 0;
+
+	template<class T>
+	uint64_t searchUntilBestMove(T& engine);
+};
+}
@@ -4,8 +4,14 @@
 // found in the LICENSE file.
 
 #include "search.h"
+#include "notation.h"
+#include "trace.h"
+#include "allocationtracker.h"
 
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 namespace pulse {
 
@@ -16,10 +22,15 @@ Search::Timer::Timer(bool& timerStopped, bool& doTimeManagement, int& currentDep
 }
 
 void Search::Timer::run(uint64_t _searchTime) {
+	Trace::setThreadName("timer");
+	PULSE_ALLOCATION_SCOPE(SEARCH);
+	Trace::Span span("timer", Trace::isOpen() ? "timer " + std::to_string(_searchTime) + "ms" : std::string());
+
 	std::unique_lock<std::mutex> lock(mutex);
 	if (!condition.wait_for(lock, std::chrono::milliseconds(_searchTime), [=] { return timerStopped; })) {
 		// Timer timed-out
 		timerStopped = true;
+		Trace::instant("timer", "timeout");
 
 		// If we finished the first iteration, we should have a result.
 		// In this case abort the search.
@@ -125,9 +136,21 @@ void Search::newPonderSearch(Position& _position,
 
 	position = _position;
 
+	this->searchTime = getClockTime(_position,
+			whiteTimeLeft, whiteTimeIncrement, blackTimeLeft, blackTimeIncrement, movesToGo);
+
+	this->doTimeManagement = true;
+}
+
+/**
+ * Returns how long we should search this move on the clock.
+ */
+uint64_t Search::getClockTime(const Position& position,
+							  uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement, uint64_t blackTimeLeft,
+							  uint64_t blackTimeIncrement, int movesToGo) {
 	uint64_t timeLeft;
 	uint64_t timeIncrement;
-	if (_position.activeColor == color::WHITE) {
+	if (position.activeColor == color::WHITE) {
 		timeLeft = whiteTimeLeft;
 		timeIncrement = whiteTimeIncrement;
 	} else {
@@ -137,7 +160,8 @@ void Search::newPonderSearch(Position& _position,
 
 	// Don't use all of our time. Search only for 95%. Always leave 1 second as
 	// buffer time.
-	uint64_t maxSearchTime = (uint64_t) (timeLeft * 0.95) - 1000L;
+	uint64_t maxSearchTime = (uint64_t) (timeLeft * 0.95);
+	maxSearchTime = maxSearchTime > 1000 ? maxSearchTime - 1000 : 0;
 	if (maxSearchTime < 1) {
 		// We don't have enough time left. Search only for 1 millisecond, meaning
 		// get a result as fast as we can.
@@ -146,12 +170,12 @@ void Search::newPonderSearch(Position& _position,
 
 	// Assume that we still have to do movesToGo number of moves. For every next
 	// move (movesToGo - 1) we will receive a time increment.
-	this->searchTime = (maxSearchTime + (movesToGo - 1) * timeIncrement) / movesToGo;
-	if (this->searchTime > maxSearchTime) {
-		this->searchTime = maxSearchTime;
+	uint64_t searchTime = (maxSearchTime + (movesToGo - 1) * timeIncrement) / movesToGo;
+	if (searchTime > maxSearchTime) {
+		searchTime = maxSearchTime;
 	}
 
-	this->doTimeManagement = true;
+	return searchTime;
 }
 
 Search::Search(Protocol& protocol)
@@ -164,6 +188,89 @@ Search::Search(Protocol& protocol)
 	thread = std::thread(&Search::run, this);
 }
 
+/**
+ * Restricts the root moves of the next search. An empty list means all
+ * legal moves.
+ */
+void Search::setSearchMoves(const std::vector<int>& _searchMoves) {
+	if (running) throw std::exception();
+
+	searchMoves = _searchMoves;
+}
+
+void Search::setAnalysisCache(AnalysisCache* _analysisCache) {
+	if (running) throw std::exception();
+
+	analysisCache = _analysisCache;
+}
+
+void Search::setTablebases(Tablebases* _tablebases) {
+	if (running) throw std::exception();
+
+	tablebases = _tablebases;
+}
+
+void Search::setHashSize(uint64_t sizeInMB) {
+	if (running) throw std::exception();
+
+	transpositionTable.reset();
+	transpositionTable = std::make_unique<TranspositionTable>(sizeInMB);
+}
+
+void Search::loadHash(const std::string& path, int mode) {
+	if (running) throw std::exception();
+
+	transpositionTable = std::make_unique<TranspositionTable>(path, mode);
+}
+
+void Search::saveHash(const std::string& path) {
+	if (running) throw std::exception();
+
+	transpositionTable->save(path);
+}
+
+void Search::clearHash() {
+	if (running) throw std::exception();
+
+	transpositionTable->clear();
+
+	std::unique_lock<std::mutex> lock(sharedEntriesMutex);
+	sharedEntries.clear();
+}
+
+/**
+ * Remembers a position of a principal variation, which another process has
+ * searched from our root position. The value is from the point of view of
+ * the root, so we can store it like our own values. If the search thread
+ * doesn't keep up, we drop the entry.
+ */
+void Search::addSharedEntry(uint64_t zobristKey, int move, int value, int depth, int ply) {
+	std::unique_lock<std::mutex> lock(sharedEntriesMutex);
+	if (sharedEntries.size() < MAX_SHARED_ENTRIES) {
+		sharedEntries.push_back({zobristKey, move, valueToHash(ply % 2 == 0 ? value : -value, ply), depth});
+	}
+}
+
+void Search::storeSharedEntries() {
+	std::unique_lock<std::mutex> lock(sharedEntriesMutex);
+	for (auto& entry: sharedEntries) {
+		transpositionTable->store(entry.zobristKey, entry.move, entry.value, entry.depth, TranspositionTable::EXACT);
+	}
+	sharedEntries.clear();
+}
+
+uint64_t Search::getHashCapacity() const {
+	return transpositionTable->getCapacity();
+}
+
+int Search::getHashMemoryKind() const {
+	return transpositionTable->getMemoryKind();
+}
+
+const Search::Statistics& Search::getStatistics() const {
+	return statistics;
+}
+
 void Search::reset() {
 	searchDepth = depth::MAX_DEPTH;
 	searchNodes = std::numeric_limits<uint64_t>::max();
@@ -171,13 +278,17 @@ void Search::reset() {
 	runTimer = false;
 	timerStopped = false;
 	doTimeManagement = false;
+	searchMoves.clear();
 	rootMoves.size = 0;
 	abort = false;
 	totalNodes = 0;
 	currentDepth = initialDepth;
+	completedDepth = 0;
 	currentMaxDepth = 0;
 	currentMove = move::NOMOVE;
 	currentMoveNumber = 0;
+	statistics = Statistics();
+	statistics.iterationNodes.reserve(depth::MAX_DEPTH);
 }
 
 void Search::start() {
@@ -194,6 +305,7 @@ void Search::stop() {
 
 	if (running) {
 		// Signal the search thread that we want to stop it
+		Trace::instant("control", "stop");
 		abort = true;
 
 		stopSignal.acquire();
@@ -205,8 +317,10 @@ void Search::ponderhit() {
 
 	if (running) {
 		// Enable time management
+		Trace::instant("control", "ponderhit");
 		runTimer = true;
 		timer.start(searchTime);
+		protocol.sendDebug("ponderhit timer " + std::to_string(searchTime) + "ms");
 
 		// If we finished the first iteration, we should have a result.
 		// In this case check the stop conditions.
@@ -228,6 +342,9 @@ void Search::quit() {
 }
 
 void Search::run() {
+	Trace::setThreadName("search");
+	PULSE_ALLOCATION_SCOPE(SEARCH);
+
 	while (true) {
 		wakeupSignal.acquire();
 
@@ -235,33 +352,61 @@ void Search::run() {
 			break;
 		}
 
+		// Everything our thread does for this search counts, including
+		// sending the results.
+		uint64_t startAllocations = allocation::getThreadAllocations();
+
 		// Do all initialization before releasing the main thread to JCPI
 		if (runTimer) {
 			timer.start(searchTime);
 		}
 
+		transpositionTable->newSearch();
+
 		// Populate root move list
 		MoveList<MoveEntry>& moves = moveGenerators[0].getLegalMoves(position, 1, position.isCheck());
 		for (int i = 0; i < moves.size; i++) {
 			int move = moves.entries[i]->move;
+			if (!searchMoves.empty()
+				&& std::find(searchMoves.begin(), searchMoves.end(), move) == searchMoves.end()) {
+				continue;
+			}
 			rootMoves.entries[rootMoves.size]->move = move;
 			rootMoves.entries[rootMoves.size]->pv.moves[0] = move;
 			rootMoves.entries[rootMoves.size]->pv.size = 1;
 			rootMoves.size++;
 		}
 
+		// Keep only the moves which preserve the tablebase result
+		if (tablebases != nullptr && tablebases->filterRootMoves(position, rootMoves, moveGenerators[1])) {
+			PULSE_ALLOCATION_SCOPE(PROTOCOL);
+			protocol.sendDebug("tablebases kept " + std::to_string(rootMoves.size) + " root moves");
+		}
+
 		// Go...
 		stopSignal.drainPermits();
 		running = true;
 		runSignal.release();
 
+		// If we have analysed this position before at least as deep as we
+		// are asked to, we don't have to search at all.
+		bool cached = probeAnalysisCache();
+
 		//### BEGIN Iterative Deepening
-		for (int depth = initialDepth; depth <= searchDepth; depth++) {
+		for (int depth = initialDepth; depth <= searchDepth && !cached; depth++) {
+			Trace::Span span("search", Trace::isOpen() ? "depth " + std::to_string(depth) : std::string());
 			currentDepth = depth;
 			currentMaxDepth = 0;
+			storeSharedEntries();
 			protocol.sendStatus(false, currentDepth, currentMaxDepth, totalNodes, currentMove, currentMoveNumber);
 
+			uint64_t iterationStartNodes = totalNodes;
 			searchRoot(currentDepth, -value::INFINITE, value::INFINITE);
+			if (!abort) {
+				completedDepth = currentDepth;
+				statistics.iterationNodes.push_back(totalNodes - iterationStartNodes);
+				sendStatistics();
+			}
 
 			// Sort the root move list, so that the next iteration begins with the
 			// best move first.
@@ -292,14 +437,81 @@ void Search::run() {
 			}
 		}
 
+		statistics.allocations = allocation::getThreadAllocations() - startAllocations;
+
+		// Send the counters of the whole search before the best move, so
+		// they belong to this search and not to the next command.
+		{
+			PULSE_ALLOCATION_SCOPE(PROTOCOL);
+			protocol.sendInfo("statistics " + statistics.toString());
+		}
+
 		// Send the best move to the GUI
+		Trace::instant("search", "bestmove");
 		protocol.sendBestMove(bestMove, ponderMove);
 
+		// Remember the result of the last finished iteration
+		if (analysisCache != nullptr && completedDepth > 0 && rootMoves.size > 0 && searchMoves.empty()) {
+			analysisCache->put(position, completedDepth, *rootMoves.entries[0]);
+		}
+
 		running = false;
 		stopSignal.release();
 	}
 }
 
+/**
+ * Looks up the root position in the analysis cache. This is only done for
+ * depth searches, as we cannot tell how deep a time search would get.
+ */
+bool Search::probeAnalysisCache() {
+	if (analysisCache == nullptr || searchDepth == depth::MAX_DEPTH || !searchMoves.empty()) {
+		return false;
+	}
+
+	int cachedDepth;
+	RootEntry entry;
+	if (!analysisCache->get(position, cachedDepth, entry) || cachedDepth < searchDepth) {
+		return false;
+	}
+
+	// Move the cached best move to the front, so it will be sent as best move
+	for (int i = 0; i < rootMoves.size; i++) {
+		if (rootMoves.entries[i]->move == entry.move) {
+			std::swap(rootMoves.entries[0], rootMoves.entries[i]);
+			rootMoves.entries[0]->value = entry.value;
+			rootMoves.entries[0]->pv = entry.pv;
+
+			currentDepth = cachedDepth;
+			currentMaxDepth = cachedDepth;
+			protocol.sendMove(*rootMoves.entries[0], currentDepth, currentMaxDepth, totalNodes);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Reports the shape of the last iteration in debug mode.
+ */
+void Search::sendStatistics() {
+	// Formatting the message is part of the protocol, not of the search
+	PULSE_ALLOCATION_SCOPE(PROTOCOL);
+
+	std::ostringstream message;
+	message << std::fixed << std::setprecision(1);
+	message << "depth " << currentDepth;
+	message << " nodes " << statistics.iterationNodes.back();
+	message << " ebf " << std::setprecision(2) << statistics.getBranchingFactor(currentDepth) << std::setprecision(1);
+	message << " qnodes " << (totalNodes > 0 ? 100.0 * statistics.quiescentNodes / totalNodes : 0.0) << "%";
+	message << " cutoffs " << statistics.betaCutoffs;
+	message << " firstmove " << 100.0 * statistics.getFirstMoveCutoffRate() << "%";
+	message << " hash " << 100.0 * statistics.getHashHitRate() << "%";
+	protocol.sendDebug(message.str());
+}
+
 void Search::checkStopConditions() {
 	// We will check the stop conditions only if we are using time management,
 	// that is if our timer != null.
@@ -342,6 +554,7 @@ void Search::searchRoot(int depth, int alpha, int beta) {
 	int ply = 0;
 
 	updateSearch(ply);
+	statistics.mainNodes++;
 
 	// Abort conditions
 	if (abort) {
@@ -356,6 +569,9 @@ void Search::searchRoot(int depth, int alpha, int beta) {
 	for (int i = 0; i < rootMoves.size; i++) {
 		int move = rootMoves.entries[i]->move;
 
+		Trace::Span span("root", Trace::isOpen()
+				? notation::fromSquare(move::getOriginSquare(move)) + notation::fromSquare(move::getTargetSquare(move))
+				: std::string());
 		currentMove = move;
 		currentMoveNumber = i + 1;
 		protocol.sendStatus(false, currentDepth, currentMaxDepth, totalNodes, currentMove, currentMoveNumber);
@@ -395,6 +611,7 @@ int Search::search(int depth, int alpha, int beta, int ply) {
 	}
 
 	updateSearch(ply);
+	statistics.mainNodes++;
 
 	// Abort conditions
 	if (abort || ply == depth::MAX_PLY) {
@@ -406,12 +623,55 @@ int Search::search(int depth, int alpha, int beta, int ply) {
 		return value::DRAW;
 	}
 
+	//### BEGIN Tablebases
+	// Only probe right after a capture or pawn move. The results assume a
+	// fresh fifty move counter. Cursed wins and blessed losses are draws.
+	if (tablebases != nullptr && position.halfmoveClock == 0 && position.castlingRights == castling::NOCASTLING
+		&& Tablebases::getPieceCount(position) <= tablebases->getMaxPieces()) {
+		int wdl;
+		if (tablebases->probeWdl(position, wdl)) {
+			statistics.tablebaseHits++;
+			if (wdl > Tablebases::CURSEDWIN) {
+				return value::TABLEBASE_WIN - ply;
+			} else if (wdl < Tablebases::BLESSEDLOSS) {
+				return -value::TABLEBASE_WIN + ply;
+			} else {
+				return value::DRAW;
+			}
+		}
+	}
+	//### ENDOF Tablebases
+
+	//### BEGIN Transposition Table
+	// Only cut off if the value is outside our window, so we never lose a
+	// principal variation.
+	int hashMove = move::NOMOVE;
+	TranspositionTable::Entry entry;
+	statistics.hashProbes++;
+	if (transpositionTable->probe(position.zobristKey, entry)) {
+		hashMove = entry.move;
+		statistics.hashHits++;
+
+		if (entry.depth >= depth) {
+			int value = valueFromHash(entry.value, ply);
+			if (((entry.bound & TranspositionTable::LOWER) && value >= beta)
+				|| ((entry.bound & TranspositionTable::UPPER) && value <= alpha)) {
+				statistics.hashCutoffs++;
+				return value;
+			}
+		}
+	}
+	//### ENDOF Transposition Table
+
 	// Initialize
 	int bestValue = -value::INFINITE;
+	int bestMove = move::NOMOVE;
+	int originalAlpha = alpha;
 	int searchedMoves = 0;
 	bool isCheck = position.isCheck();
 
 	MoveList<MoveEntry>& moves = moveGenerators[ply].getMoves(position, depth, isCheck);
+	moveToFront(moves, hashMove);
 	for (int i = 0; i < moves.size; i++) {
 		int move = moves.entries[i]->move;
 		int value = bestValue;
@@ -430,6 +690,7 @@ int Search::search(int depth, int alpha, int beta, int ply) {
 		// Pruning
 		if (value > bestValue) {
 			bestValue = value;
+			bestMove = move;
 
 			// Do we have a better value?
 			if (value > alpha) {
@@ -439,6 +700,10 @@ int Search::search(int depth, int alpha, int beta, int ply) {
 				// Is the value higher than beta?
 				if (value >= beta) {
 					// Cut-off
+					statistics.betaCutoffs++;
+					if (searchedMoves == 1) {
+						statistics.firstMoveCutoffs++;
+					}
 					break;
 				}
 			}
@@ -456,11 +721,17 @@ int Search::search(int depth, int alpha, int beta, int ply) {
 		}
 	}
 
+	int bound = bestValue >= beta ? TranspositionTable::LOWER
+			: (bestValue > originalAlpha ? TranspositionTable::EXACT : TranspositionTable::UPPER);
+	transpositionTable->store(position.zobristKey,
+			bound == TranspositionTable::UPPER ? +move::NOMOVE : bestMove, valueToHash(bestValue, ply), depth, bound);
+
 	return bestValue;
 }
 
 int Search::quiescent(int depth, int alpha, int beta, int ply) {
 	updateSearch(ply);
+	statistics.quiescentNodes++;
 
 	// Abort conditions
 	if (abort || ply == depth::MAX_PLY) {
@@ -544,4 +815,94 @@ void Search::savePV(int move, MoveVariation& src, MoveVariation& dest) {
 	}
 	dest.size = src.size + 1;
 }
+
+/**
+ * Moves the move to the front of the list and keeps the order of the other
+ * moves.
+ */
+void Search::moveToFront(MoveList<MoveEntry>& moves, int move) {
+	if (move == move::NOMOVE) {
+		return;
+	}
+
+	for (int i = 0; i < moves.size; i++) {
+		if (moves.entries[i]->move == move) {
+			std::shared_ptr<MoveEntry> entry(moves.entries[i]);
+			for (int j = i; j > 0; j--) {
+				moves.entries[j] = moves.entries[j - 1];
+			}
+			moves.entries[0] = entry;
+			return;
+		}
+	}
+}
+
+/**
+ * Mate values depend on the ply, so we store them relative to the node.
+ */
+int Search::valueToHash(int value, int ply) {
+	if (value >= value::CHECKMATE_THRESHOLD) {
+		return value + ply;
+	} else if (value <= -value::CHECKMATE_THRESHOLD) {
+		return value - ply;
+	} else {
+		return value;
+	}
+}
+
+int Search::valueFromHash(int value, int ply) {
+	if (value >= value::CHECKMATE_THRESHOLD) {
+		return value - ply;
+	} else if (value <= -value::CHECKMATE_THRESHOLD) {
+		return value + ply;
+	} else {
+		return value;
+	}
+}
+
+double Search::Statistics::getFirstMoveCutoffRate() const {
+	return betaCutoffs > 0 ? static_cast<double>(firstMoveCutoffs) / betaCutoffs : 0.0;
+}
+
+double Search::Statistics::getHashHitRate() const {
+	return hashProbes > 0 ? static_cast<double>(hashHits) / hashProbes : 0.0;
+}
+
+/**
+ * Returns how many times more nodes this iteration needed than the one
+ * before. The first iteration has no predecessor and returns 0.
+ */
+double Search::Statistics::getBranchingFactor(int depth) const {
+	if (depth < 2 || depth > static_cast<int>(iterationNodes.size()) || iterationNodes[depth - 2] == 0) {
+		return 0.0;
+	}
+
+	return static_cast<double>(iterationNodes[depth - 1]) / iterationNodes[depth - 2];
+}
+
+/**
+ * Returns all counters as space separated name and value pairs.
+ */
+std::string Search::Statistics::toString() const {
+	std::ostringstream output;
+	output << std::fixed << std::setprecision(2);
+	output << "mainnodes " << mainNodes;
+	output << " qnodes " << quiescentNodes;
+	output << " betacutoffs " << betaCutoffs;
+	output << " firstmovecutoffs " << firstMoveCutoffs;
+	output << " firstmovecutoffrate " << getFirstMoveCutoffRate();
+	output << " hashprobes " << hashProbes;
+	output << " hashhits " << hashHits;
+	output << " hashcutoffs " << hashCutoffs;
+	output << " hashhitrate " << getHashHitRate();
+	output << " tbhits " << tablebaseHits;
+	output << " ebf";
+	for (unsigned int depth = 2; depth <= iterationNodes.size(); depth++) {
+		output << " " << getBranchingFactor(depth);
+	}
+	if (allocation::isEnabled()) {
+		output << " allocations " << allocations;
+	}
+	return output.str();
+}
 }
@@ -8,12 +8,17 @@
 #include "position.h"
 #include "movegenerator.h"
 #include "evaluation.h"
+#include "analysiscache.h"
+#include "tablebases.h"
+#include "transpositiontable.h"
 
 #include <memory>
+#include <string>
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 namespace pulse {
 
@@ -23,6 +28,37 @@ namespace pulse {
  */
 class Search final {
 public:
+	/**
+	 * These counters describe the shape of the search tree, so we can tell
+	 * a faster node rate from a smaller tree.
+	 */
+	class Statistics final {
+	public:
+		uint64_t mainNodes = 0;
+		uint64_t quiescentNodes = 0;
+		uint64_t betaCutoffs = 0;
+		uint64_t firstMoveCutoffs = 0;
+		uint64_t hashProbes = 0;
+		uint64_t hashHits = 0;
+		uint64_t hashCutoffs = 0;
+		uint64_t tablebaseHits = 0;
+
+		// Heap allocations of the search thread in all subsystems between go
+		// and the statistics line, if we track them
+		uint64_t allocations = 0;
+
+		// Nodes of every finished iteration
+		std::vector<uint64_t> iterationNodes;
+
+		double getFirstMoveCutoffRate() const;
+
+		double getHashHitRate() const;
+
+		double getBranchingFactor(int depth) const;
+
+		std::string toString() const;
+	};
+
 	explicit Search(Protocol& protocol);
 
 	void newDepthSearch(Position& _position, int _searchDepth);
@@ -41,6 +77,32 @@ public:
 						 uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement, uint64_t blackTimeLeft,
 						 uint64_t blackTimeIncrement, int movesToGo);
 
+	static uint64_t getClockTime(const Position& position,
+								 uint64_t whiteTimeLeft, uint64_t whiteTimeIncrement, uint64_t blackTimeLeft,
+								 uint64_t blackTimeIncrement, int movesToGo);
+
+	void setSearchMoves(const std::vector<int>& _searchMoves);
+
+	void setAnalysisCache(AnalysisCache* _analysisCache);
+
+	void setTablebases(Tablebases* _tablebases);
+
+	void setHashSize(uint64_t sizeInMB);
+
+	void loadHash(const std::string& path, int mode);
+
+	void saveHash(const std::string& path);
+
+	void clearHash();
+
+	void addSharedEntry(uint64_t zobristKey, int move, int value, int depth, int ply);
+
+	uint64_t getHashCapacity() const;
+
+	int getHashMemoryKind() const;
+
+	const Statistics& getStatistics() const;
+
 	void reset();
 
 	void start();
@@ -80,6 +142,17 @@ private:
 		void run(uint64_t _searchTime);
 	};
 
+	/**
+	 * A position of a principal variation another process has searched.
+	 */
+	class SharedEntry final {
+	public:
+		uint64_t zobristKey;
+		int move;
+		int value;
+		int depth;
+	};
+
 	class Semaphore final {
 	public:
 		explicit Semaphore(int permits);
@@ -111,6 +184,20 @@ private:
 	// in search. (which is expensive)
 	std::array<MoveGenerator, depth::MAX_PLY> moveGenerators;
 
+	// Finished analyses from earlier searches, may be null
+	AnalysisCache* analysisCache = nullptr;
+
+	// Endgame tablebases, may be null
+	Tablebases* tablebases = nullptr;
+
+	std::unique_ptr<TranspositionTable> transpositionTable = std::make_unique<TranspositionTable>(16);
+
+	// Entries from other processes, which we store between two iterations,
+	// because the transposition table belongs to the search thread
+	static const int MAX_SHARED_ENTRIES = 1024;
+	std::mutex sharedEntriesMutex;
+	std::vector<SharedEntry> sharedEntries;
+
 	// Depth search
 	int searchDepth;
 
@@ -125,15 +212,24 @@ private:
 	bool doTimeManagement;
 
 	// Search parameters
+	std::vector<int> searchMoves;
 	MoveList<RootEntry> rootMoves;
 	bool abort;
 	uint64_t totalNodes;
 	const int initialDepth = 1;
 	int currentDepth;
+	int completedDepth;
 	int currentMaxDepth;
 	int currentMove;
 	int currentMoveNumber;
 	std::array<MoveVariation, depth::MAX_PLY + 1> pv;
+	Statistics statistics;
+
+	bool probeAnalysisCache();
+
+	void storeSharedEntries();
+
+	void sendStatistics();
 
 	void checkStopConditions();
 
@@ -146,5 +242,11 @@ private:
 	int quiescent(int depth, int alpha, int beta, int ply);
 
 	static void savePV(int move, MoveVariation& src, MoveVariation& dest);
+
+	static void moveToFront(MoveList<MoveEntry>& moves, int move);
+
+	static int valueToHash(int value, int ply);
+
+	static int valueFromHash(int value, int ply);
 };
 }
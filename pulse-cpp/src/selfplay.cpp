@@ -0,0 +1,204 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "selfplay.h"
+#include "notation.h"
+#include "threadpool.h"
+
+#include <array>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace pulse {
+
+void SelfPlay::run(const std::string& path, int games, int searchDepth, uint64_t searchNodes, int threadCount,
+				   uint64_t seed) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	PackedPositionWriter writer(path);
+	uint64_t positions = 0;
+	std::array<int, 3> results = {};
+
+	{
+		ThreadPool threadPool(threadCount);
+		std::vector<std::future<void>> futures;
+		for (int i = 0; i < threadCount; i++) {
+			futures.push_back(threadPool.submit([&] {
+				auto worker = std::make_unique<Worker>();
+				std::vector<PackedPosition> packedPositions;
+				for (int game = nextGame++; game < games; game = nextGame++) {
+					// Every game has its own random numbers, so a game only
+					// depends on the seed and its number.
+					std::mt19937_64 random(seed + static_cast<uint64_t>(game));
+					int result = worker->play(random, searchDepth, searchNodes, packedPositions);
+
+					std::unique_lock<std::mutex> lock(mutex);
+					for (auto& packedPosition: packedPositions) {
+						writer.write(packedPosition);
+					}
+					positions += packedPositions.size();
+					results[result - PackedPosition::BLACKWINS]++;
+				}
+			}));
+		}
+		for (auto& future: futures) {
+			future.get();
+		}
+	}
+	writer.close();
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Games: " << games << std::endl;
+	std::cout << "White wins: " << results[PackedPosition::WHITEWINS - PackedPosition::BLACKWINS] << std::endl;
+	std::cout << "Black wins: " << results[PackedPosition::BLACKWINS - PackedPosition::BLACKWINS] << std::endl;
+	std::cout << "Draws: " << results[PackedPosition::DRAW - PackedPosition::BLACKWINS] << std::endl;
+	std::cout << "Positions: " << positions << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+}
+
+SelfPlay::Worker::Worker()
+		: search(*this) {
+}
+
+SelfPlay::Worker::~Worker() {
+	search.quit();
+}
+
+/**
+ * Plays one game and returns its result. The searched positions are stored
+ * in packedPositions with the score from the side to move's point of view.
+ */
+int SelfPlay::Worker::play(std::mt19937_64& random, int searchDepth, uint64_t searchNodes,
+						   std::vector<PackedPosition>& packedPositions) {
+	packedPositions.clear();
+	search.clearHash();
+
+	Position position = notation::toPosition(notation::STANDARDPOSITION);
+	playRandomMoves(position, random);
+
+	int result = PackedPosition::NORESULT;
+	int resignPlies = 0;
+	int drawPlies = 0;
+	for (int ply = 0; result == PackedPosition::NORESULT; ply++) {
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		if (moves.size == 0) {
+			if (!position.isCheck()) {
+				result = PackedPosition::DRAW;
+			} else {
+				result = position.activeColor == color::WHITE ? PackedPosition::BLACKWINS : PackedPosition::WHITEWINS;
+			}
+			break;
+		}
+		if (position.halfmoveClock >= 100 || position.isRepetition() || position.hasInsufficientMaterial()
+			|| ply >= MAX_PLIES) {
+			result = PackedPosition::DRAW;
+			break;
+		}
+
+		searchMove(position, searchDepth, searchNodes);
+
+		// A search stopped before its first iteration has no score to record
+		if (bestValue == value::NOVALUE) {
+			position.makeMove(bestMove);
+			continue;
+		}
+
+		PackedPosition packedPosition = PackedPosition::pack(position);
+		packedPosition.score = bestValue;
+		packedPosition.move = bestMove;
+		packedPositions.push_back(packedPosition);
+
+		// Adjudicate clear wins and dead draws
+		resignPlies = std::abs(bestValue) >= RESIGN_SCORE ? resignPlies + 1 : 0;
+		drawPlies = ply >= DRAW_MIN_PLY && std::abs(bestValue) <= DRAW_SCORE ? drawPlies + 1 : 0;
+		if (resignPlies >= RESIGN_PLIES) {
+			bool whiteIsWinning = (bestValue > 0) == (position.activeColor == color::WHITE);
+			result = whiteIsWinning ? PackedPosition::WHITEWINS : PackedPosition::BLACKWINS;
+		} else if (drawPlies >= DRAW_PLIES) {
+			result = PackedPosition::DRAW;
+		}
+
+		position.makeMove(bestMove);
+	}
+
+	for (auto& packedPosition: packedPositions) {
+		packedPosition.result = static_cast<int8_t>(result);
+	}
+
+	return result;
+}
+
+/**
+ * Plays random legal moves. If we end up in a finished game, we start over.
+ */
+void SelfPlay::Worker::playRandomMoves(Position& position, std::mt19937_64& random) {
+	Position start = position;
+	for (int ply = 0; ply < RANDOM_PLIES; ply++) {
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		if (moves.size == 0) {
+			position = start;
+			ply = -1;
+			continue;
+		}
+
+		std::uniform_int_distribution<int> distribution(0, moves.size - 1);
+		position.makeMove(moves.entries[distribution(random)]->move);
+	}
+}
+
+void SelfPlay::Worker::searchMove(Position& position, int searchDepth, uint64_t searchNodes) {
+	if (searchDepth > 0) {
+		search.newDepthSearch(position, searchDepth);
+	} else {
+		search.newNodesSearch(position, searchNodes);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished = false;
+	bestMove = move::NOMOVE;
+	bestValue = value::NOVALUE;
+	lock.unlock();
+
+	search.start();
+
+	lock.lock();
+	condition.wait(lock, [this] { return finished; });
+	lock.unlock();
+
+	// Wait until the search thread is ready for the next move
+	search.stop();
+}
+
+void SelfPlay::Worker::sendBestMove(int _bestMove, int ponderMove) {
+	std::unique_lock<std::mutex> lock(mutex);
+	bestMove = _bestMove;
+	finished = true;
+	condition.notify_all();
+}
+
+void SelfPlay::Worker::sendStatus(
+		int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove, int currentMoveNumber) {
+}
+
+void SelfPlay::Worker::sendStatus(
+		bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+		int currentMoveNumber) {
+}
+
+void SelfPlay::Worker::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) {
+	std::unique_lock<std::mutex> lock(mutex);
+	bestValue = entry.value;
+}
+
+void SelfPlay::Worker::sendInfo(const std::string& message) {
+}
+
+void SelfPlay::Worker::sendDebug(const std::string& message) {
+}
+}
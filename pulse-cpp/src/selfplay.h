@@ -0,0 +1,89 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "search.h"
+#include "packedposition.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class plays games against itself and writes every searched position
+ * as a packed position with the score, the best move and the game result.
+ * Games run concurrently on a pool of threads, each with its own search.
+ */
+class SelfPlay final {
+public:
+	static const uint64_t DEFAULT_NODES = 5000;
+
+	// Uniformly random moves at the start of every game
+	static const int RANDOM_PLIES = 8;
+
+	// A side with a score of at least RESIGN_SCORE for RESIGN_PLIES plies in
+	// a row wins. A game with scores of at most DRAW_SCORE for DRAW_PLIES
+	// plies in a row after DRAW_MIN_PLY plies is drawn.
+	static const int RESIGN_SCORE = 1000;
+	static const int RESIGN_PLIES = 6;
+	static const int DRAW_SCORE = 10;
+	static const int DRAW_PLIES = 12;
+	static const int DRAW_MIN_PLY = 80;
+	static const int MAX_PLIES = 400;
+
+	void run(const std::string& path, int games, int searchDepth, uint64_t searchNodes, int threadCount,
+			 uint64_t seed);
+
+private:
+	/**
+	 * Every worker owns a search and plays one game after the other.
+	 */
+	class Worker final : public Protocol {
+	public:
+		Worker();
+
+		~Worker() override;
+
+		int play(std::mt19937_64& random, int searchDepth, uint64_t searchNodes,
+				 std::vector<PackedPosition>& packedPositions);
+
+		void sendBestMove(int bestMove, int ponderMove) override;
+
+		void sendStatus(
+				int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+				int currentMoveNumber) override;
+
+		void sendStatus(
+				bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+				int currentMoveNumber) override;
+
+		void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override;
+
+		void sendInfo(const std::string& message) override;
+
+		void sendDebug(const std::string& message) override;
+
+	private:
+		Search search;
+		MoveGenerator moveGenerator;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool finished = false;
+		int bestMove = move::NOMOVE;
+		int bestValue = value::NOVALUE;
+
+		void playRandomMoves(Position& position, std::mt19937_64& random);
+
+		void searchMove(Position& position, int searchDepth, uint64_t searchNodes);
+	};
+
+	std::mutex mutex;
+	std::atomic<int> nextGame{0};
+};
+}
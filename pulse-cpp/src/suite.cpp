@@ -0,0 +1,247 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "suite.h"
+#include "notation.h"
+#include "pulse.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace pulse {
+
+namespace {
+
+/**
+ * Accepts standard algebraic notation as well as coordinate notation.
+ */
+int toMove(Position& position, const std::string& notation) {
+	try {
+		return notation::toMove(position, notation);
+	} catch (std::invalid_argument&) {
+		MoveGenerator moveGenerator;
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		for (int i = 0; i < moves.size; i++) {
+			if (Pulse::fromMove(moves.entries[i]->move) == notation) {
+				return moves.entries[i]->move;
+			}
+		}
+		throw;
+	}
+}
+}
+
+bool Suite::Entry::isSolution(int move) const {
+	if (move == move::NOMOVE) {
+		return false;
+	}
+	if (!bestMoves.empty() && std::find(bestMoves.begin(), bestMoves.end(), move) == bestMoves.end()) {
+		return false;
+	}
+	return std::find(avoidMoves.begin(), avoidMoves.end(), move) == avoidMoves.end();
+}
+
+/**
+ * Parses one EPD line. The first four fields describe the position, the
+ * rest are operations separated by semicolons. We only need id, bm and am.
+ */
+Suite::Entry Suite::parse(const std::string& line) {
+	Entry entry;
+
+	std::istringstream input(line);
+	std::string fen;
+	for (int i = 0; i < 4; i++) {
+		std::string field;
+		if (!(input >> field)) {
+			throw std::invalid_argument("Missing position");
+		}
+		fen += (i > 0 ? " " : "") + field;
+	}
+	entry.position = notation::toPosition(fen);
+
+	std::string operation;
+	while (std::getline(input, operation, ';')) {
+		std::istringstream operands(operation);
+		std::string opcode;
+		if (!(operands >> opcode)) {
+			continue;
+		}
+
+		if (opcode == "id") {
+			std::getline(operands >> std::ws, entry.id);
+			entry.id.erase(std::remove(entry.id.begin(), entry.id.end(), '"'), entry.id.end());
+		} else if (opcode == "bm" || opcode == "am") {
+			std::string token;
+			while (operands >> token) {
+				(opcode == "bm" ? entry.bestMoves : entry.avoidMoves).push_back(toMove(entry.position, token));
+			}
+		}
+	}
+
+	if (entry.bestMoves.empty() && entry.avoidMoves.empty()) {
+		throw std::invalid_argument("Missing bm or am operation");
+	}
+
+	return entry;
+}
+
+void Suite::run(const std::string& path, uint64_t searchTime, uint64_t searchNodes, int threadCount) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Cannot open " + path);
+	}
+
+	std::vector<Entry> entries;
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+		if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+			continue;
+		}
+
+		try {
+			entries.push_back(parse(line));
+			if (entries.back().id.empty()) {
+				entries.back().id = std::to_string(lineNumber);
+			}
+		} catch (std::exception& e) {
+			std::cerr << path << ":" << lineNumber << ": " << e.what() << std::endl;
+		}
+	}
+
+	// Every thread of the pool takes the next position until none are left
+	std::vector<Result> results(entries.size());
+	std::atomic<size_t> next{0};
+	auto startTime = std::chrono::steady_clock::now();
+	{
+		ThreadPool threadPool(threadCount);
+		std::vector<std::future<void>> futures;
+		for (int i = 0; i < threadCount; i++) {
+			futures.push_back(threadPool.submit([&] {
+				auto worker = std::make_unique<Worker>();
+				for (size_t index = next++; index < entries.size(); index = next++) {
+					results[index] = worker->solve(entries[index], searchTime, searchNodes);
+				}
+			}));
+		}
+		for (auto& future: futures) {
+			future.get();
+		}
+	}
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	int solved = 0;
+	uint64_t solutionTime = 0;
+	uint64_t solutionNodes = 0;
+	for (unsigned int i = 0; i < entries.size(); i++) {
+		Result& result = results[i];
+		std::cout << entries[i].id << ": ";
+		if (result.solved) {
+			solved++;
+			solutionTime += result.time;
+			solutionNodes += result.nodes;
+			std::cout << "solved in " << result.time << " ms " << result.nodes << " nodes";
+		} else {
+			std::cout << "not solved";
+		}
+		if (result.move != move::NOMOVE) {
+			std::cout << " with " << notation::fromMove(entries[i].position, result.move);
+		}
+		std::cout << std::endl;
+	}
+
+	std::cout << "Solved: " << solved << "/" << entries.size() << std::endl;
+	std::cout << "Time to solution: " << solutionTime << " ms" << std::endl;
+	std::cout << "Nodes to solution: " << solutionNodes << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+}
+
+Suite::Worker::Worker()
+		: search(*this) {
+}
+
+Suite::Worker::~Worker() {
+	search.quit();
+}
+
+Suite::Result Suite::Worker::solve(const Entry& entry, uint64_t searchTime, uint64_t searchNodes) {
+	// Every position starts from scratch, so the results do not depend on
+	// the order of the positions.
+	Position position = entry.position;
+	search.clearHash();
+	if (searchNodes > 0) {
+		search.newNodesSearch(position, searchNodes);
+	} else {
+		search.newTimeSearch(position, searchTime);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	finished = false;
+	currentEntry = &entry;
+	result = Result();
+	isSolved = false;
+	startTime = std::chrono::steady_clock::now();
+	lock.unlock();
+
+	search.start();
+
+	lock.lock();
+	condition.wait(lock, [this] { return finished; });
+	lock.unlock();
+
+	// Wait until the search thread is ready for the next position
+	search.stop();
+
+	return result;
+}
+
+/**
+ * Remembers when the search switched to a solution. Must be called with the
+ * mutex held.
+ */
+void Suite::Worker::update(int move, uint64_t totalNodes) {
+	bool solution = currentEntry->isSolution(move);
+	if (solution && !isSolved) {
+		result.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - startTime).count();
+		result.nodes = totalNodes;
+	}
+	isSolved = solution;
+	result.move = move;
+}
+
+void Suite::Worker::sendBestMove(int bestMove, int ponderMove) {
+	std::unique_lock<std::mutex> lock(mutex);
+	update(bestMove, result.nodes);
+	result.solved = isSolved;
+	finished = true;
+	condition.notify_all();
+}
+
+void Suite::Worker::sendStatus(
+		int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove, int currentMoveNumber) {
+}
+
+void Suite::Worker::sendStatus(
+		bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+		int currentMoveNumber) {
+}
+
+void Suite::Worker::sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) {
+	std::unique_lock<std::mutex> lock(mutex);
+	update(entry.move, totalNodes);
+}
+
+void Suite::Worker::sendInfo(const std::string& message) {
+}
+
+void Suite::Worker::sendDebug(const std::string& message) {
+}
+}
@@ -0,0 +1,92 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "search.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class runs a test suite in EPD format. Every position is searched
+ * with a time or node limit, and we record when the search found the
+ * solution for the last time. A position is solved if the best move
+ * satisfies the bm and am operations.
+ */
+class Suite final {
+public:
+	static const uint64_t DEFAULT_TIME = 1000;
+
+	class Entry final {
+	public:
+		std::string id;
+		Position position;
+		std::vector<int> bestMoves;
+		std::vector<int> avoidMoves;
+
+		bool isSolution(int move) const;
+	};
+
+	class Result final {
+	public:
+		bool solved = false;
+		int move = move::NOMOVE;
+
+		// Time and nodes when the search switched to the solution for the
+		// last time
+		uint64_t time = 0;
+		uint64_t nodes = 0;
+	};
+
+	static Entry parse(const std::string& line);
+
+	void run(const std::string& path, uint64_t searchTime, uint64_t searchNodes, int threadCount);
+
+private:
+	/**
+	 * Every worker owns a search and watches its progress.
+	 */
+	class Worker final : public Protocol {
+	public:
+		Worker();
+
+		~Worker() override;
+
+		Result solve(const Entry& entry, uint64_t searchTime, uint64_t searchNodes);
+
+		void sendBestMove(int bestMove, int ponderMove) override;
+
+		void sendStatus(
+				int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+				int currentMoveNumber) override;
+
+		void sendStatus(
+				bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+				int currentMoveNumber) override;
+
+		void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override;
+
+		void sendInfo(const std::string& message) override;
+
+		void sendDebug(const std::string& message) override;
+
+	private:
+		Search search;
+		std::mutex mutex;
+		std::condition_variable condition;
+		bool finished = false;
+		const Entry* currentEntry = nullptr;
+		Result result;
+		bool isSolved = false;
+		std::chrono::steady_clock::time_point startTime;
+
+		void update(int move, uint64_t totalNodes);
+	};
+};
+}
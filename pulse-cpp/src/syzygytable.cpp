@@ -0,0 +1,754 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "syzygytable.h"
+#include "bitboard.h"
+#include "model/color.h"
+#include "model/piece.h"
+#include "model/piecetype.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace pulse {
+
+const std::string SyzygyTable::WDL_EXTENSION = ".rtbw";
+const std::string SyzygyTable::DTZ_EXTENSION = ".rtbz";
+
+namespace {
+constexpr std::array<uint8_t, 4> WDL_MAGIC = {0x71, 0xE8, 0x23, 0x5D};
+constexpr std::array<uint8_t, 4> DTZ_MAGIC = {0xD7, 0x66, 0x0C, 0xA5};
+
+// Flags of a file
+constexpr int SPLIT = 1;
+constexpr int HASPAWNS = 2;
+
+// The letters of a table name and the piece types of the codes 1 to 6
+const std::string LETTERS = "KQRBNP";
+constexpr std::array<int, 6> LETTER_TYPES = {
+		piecetype::KING, piecetype::QUEEN, piecetype::ROOK, piecetype::BISHOP, piecetype::KNIGHT, piecetype::PAWN
+};
+constexpr std::array<int, 6> CODE_TYPES = {
+		piecetype::PAWN, piecetype::KNIGHT, piecetype::BISHOP, piecetype::ROOK, piecetype::QUEEN, piecetype::KING
+};
+
+// The DTZ map of a result by wdl + 2
+constexpr std::array<int, 5> WDL_MAPS = {1, 3, 0, 2, 0};
+
+uint16_t readShort(const uint8_t* data) {
+	return static_cast<uint16_t>(data[0] | data[1] << 8);
+}
+
+uint32_t readInt(const uint8_t* data) {
+	return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8
+		   | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+uint32_t readBigInt(const uint8_t* data) {
+	return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16
+		   | static_cast<uint32_t>(data[2]) << 8 | static_cast<uint32_t>(data[3]);
+}
+
+// Squares are numbered rank * 8 + file like our bitboards
+int getDiagonal(int square) {
+	return (square >> 3) - (square & 7);
+}
+
+int flipDiagonal(int square) {
+	return ((square >> 3) | (square << 3)) & 63;
+}
+
+/**
+ * The tables which map squares and piece groups to position indices.
+ */
+class Encoding final {
+public:
+	// Pawns on a2-h7 by their distance from the edge, the leading pawn has
+	// the highest slot
+	std::array<int, 64> pawnSlots = {};
+	// Squares below the a1-h8 diagonal
+	std::array<int, 64> belowDiagonal = {};
+	// Squares of the a1-d1-d4 triangle, the diagonal comes last
+	std::array<int, 64> triangle = {};
+	// Legal squares of the second king by the triangle square of the first
+	std::array<std::array<int, 64>, 10> kings = {};
+	std::array<std::array<uint64_t, 64>, 6> binomial = {};
+	std::array<std::array<uint64_t, 64>, 6> leadPawnIndices = {};
+	std::array<std::array<uint64_t, 4>, 6> leadPawnSizes = {};
+
+	Encoding() {
+		int code = 0;
+		for (int square = 0; square < 64; square++) {
+			if (getDiagonal(square) < 0) {
+				belowDiagonal[square] = code++;
+			}
+		}
+
+		code = 0;
+		std::vector<int> diagonal;
+		for (int square = 0; square <= 27; square++) {
+			if (getDiagonal(square) < 0 && (square & 7) <= 3) {
+				triangle[square] = code++;
+			} else if (getDiagonal(square) == 0 && (square & 7) <= 3) {
+				diagonal.push_back(square);
+			}
+		}
+		for (int square: diagonal) {
+			triangle[square] = code++;
+		}
+
+		// If the first king is on the diagonal, the second one is not above
+		// it. Both kings on the diagonal come last.
+		code = 0;
+		std::vector<std::pair<int, int>> bothOnDiagonal;
+		for (int index = 0; index < 10; index++) {
+			for (int first = 0; first <= 27; first++) {
+				if (triangle[first] != index || (index == 0 && first != 1)) {
+					continue;
+				}
+				for (int second = 0; second < 64; second++) {
+					if (std::abs((first & 7) - (second & 7)) <= 1 && std::abs((first >> 3) - (second >> 3)) <= 1) {
+						continue;
+					} else if (getDiagonal(first) == 0 && getDiagonal(second) > 0) {
+						continue;
+					} else if (getDiagonal(first) == 0 && getDiagonal(second) == 0) {
+						bothOnDiagonal.emplace_back(index, second);
+					} else {
+						kings[index][second] = code++;
+					}
+				}
+			}
+		}
+		for (auto& squares: bothOnDiagonal) {
+			kings[squares.first][squares.second] = code++;
+		}
+
+		binomial[0][0] = 1;
+		for (int n = 1; n < 64; n++) {
+			for (int k = 0; k < 6 && k <= n; k++) {
+				binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+			}
+		}
+
+		// Every rank of the leading pawn takes away the squares behind it on
+		// both edges
+		int available = 47;
+		for (int count = 1; count < 6; count++) {
+			for (int file = 0; file < 4; file++) {
+				uint64_t index = 0;
+				for (int rank = 1; rank < 7; rank++) {
+					int square = rank * 8 + file;
+					if (count == 1) {
+						pawnSlots[square] = available--;
+						pawnSlots[square ^ 7] = available--;
+					}
+					leadPawnIndices[count][square] = index;
+					index += binomial[count - 1][pawnSlots[square]];
+				}
+				leadPawnSizes[count][file] = index;
+			}
+		}
+	}
+};
+
+const Encoding encoding;
+}
+
+SyzygyTable::SyzygyTable(const std::string& name)
+		: name(name) {
+	if (Tablebases::getMaterialKey(name) == 0) {
+		throw std::invalid_argument("Invalid table " + name);
+	}
+
+	size_t separator = name.find('v');
+	std::array<std::array<int, piecetype::VALUES_SIZE>, color::VALUES_SIZE> counts = {};
+	for (size_t i = 0; i < name.size(); i++) {
+		if (i != separator) {
+			counts[i < separator ? color::WHITE : color::BLACK][LETTER_TYPES[LETTERS.find(name[i])]]++;
+			pieceCount++;
+		}
+	}
+	if (pieceCount > MAX_PIECES) {
+		throw std::invalid_argument("Invalid table " + name);
+	}
+
+	for (int color: color::values) {
+		for (int piecetype: piecetype::values) {
+			hasUniquePieces = hasUniquePieces || (piecetype != piecetype::KING && counts[color][piecetype] == 1);
+		}
+	}
+	isSymmetric = counts[color::WHITE] == counts[color::BLACK];
+
+	// The side with fewer pawns leads, unless it has none
+	int whitePawns = counts[color::WHITE][piecetype::PAWN];
+	int blackPawns = counts[color::BLACK][piecetype::PAWN];
+	bool whiteLeads = blackPawns == 0 || (whitePawns > 0 && blackPawns >= whitePawns);
+	pawnCounts = {whiteLeads ? whitePawns : blackPawns, whiteLeads ? blackPawns : whitePawns};
+	hasPawns = whitePawns + blackPawns > 0;
+}
+
+const std::string& SyzygyTable::getName() const {
+	return name;
+}
+
+bool SyzygyTable::setWdl(const uint8_t* data, uint64_t size) {
+	hasWdl = parse(data, size, false);
+	return hasWdl;
+}
+
+bool SyzygyTable::setDtz(const uint8_t* data, uint64_t size) {
+	hasDtz = parse(data, size, true);
+	return hasDtz;
+}
+
+/**
+ * Reads the headers of a file and points our tables into its data. Returns
+ * false if the file does not belong to this table.
+ */
+bool SyzygyTable::parse(const uint8_t* data, uint64_t size, bool isDtz) {
+	const std::array<uint8_t, 4>& magic = isDtz ? DTZ_MAGIC : WDL_MAGIC;
+	if (size < 64 || size % 64 != 16 || std::memcmp(data, magic.data(), magic.size()) != 0) {
+		return false;
+	}
+
+	uint64_t offset = magic.size();
+	int flags = data[offset++];
+	if (((flags & HASPAWNS) != 0) != hasPawns || ((flags & SPLIT) != 0) == isSymmetric) {
+		return false;
+	}
+
+	int sides = !isDtz && !isSymmetric ? 2 : 1;
+	int files = hasPawns ? 4 : 1;
+	bool hasBothPawns = hasPawns && pawnCounts[1] > 0;
+	auto getPairs = [&](int side, int file) -> Pairs& {
+		return isDtz ? dtzPairs[file] : wdlPairs[side][file];
+	};
+
+	for (int file = 0; file < files; file++) {
+		if (offset + 1 + hasBothPawns + pieceCount > size) {
+			return false;
+		}
+
+		std::array<std::array<int, 2>, 2> order = {{
+				{data[offset] & 0xF, hasBothPawns ? data[offset + 1] & 0xF : 0xF},
+				{data[offset] >> 4, hasBothPawns ? data[offset + 1] >> 4 : 0xF}
+		}};
+		offset += 1 + hasBothPawns;
+
+		for (int i = 0; i < pieceCount; i++, offset++) {
+			for (int side = 0; side < sides; side++) {
+				int code = side == 0 ? data[offset] & 0xF : data[offset] >> 4;
+				if ((code & 7) < 1 || (code & 7) > 6) {
+					return false;
+				}
+				getPairs(side, file).pieces[i] = piece::valueOf(code >> 3, CODE_TYPES[(code & 7) - 1]);
+			}
+		}
+
+		for (int side = 0; side < sides; side++) {
+			if (!setGroups(getPairs(side, file), order[side], file)) {
+				return false;
+			}
+		}
+	}
+	offset += offset & 1;
+
+	for (int file = 0; file < files; file++) {
+		for (int side = 0; side < sides; side++) {
+			if (!setSizes(getPairs(side, file), data, size, offset)) {
+				return false;
+			}
+		}
+	}
+
+	if (isDtz) {
+		dtzMap = data + offset;
+		for (int file = 0; file < files; file++) {
+			Pairs& pairs = dtzPairs[file];
+			if ((pairs.flags & MAPPED) == 0) {
+				continue;
+			}
+
+			// Every result has its own list of values
+			bool isWide = (pairs.flags & WIDE) != 0;
+			offset += isWide ? offset & 1 : 0;
+			for (uint32_t& mapIndex: pairs.mapIndices) {
+				if (offset + 2 > size) {
+					return false;
+				}
+				uint64_t mapOffset = offset - (dtzMap - data);
+				mapIndex = static_cast<uint32_t>(isWide ? mapOffset / 2 + 1 : mapOffset + 1);
+				offset += isWide ? 2 * readShort(data + offset) + 2 : data[offset] + 1;
+			}
+		}
+		offset += offset & 1;
+	}
+
+	for (int file = 0; file < files; file++) {
+		for (int side = 0; side < sides; side++) {
+			Pairs& pairs = getPairs(side, file);
+			pairs.sparseIndex = data + offset;
+			offset += pairs.sparseIndexCount * 6;
+		}
+	}
+	for (int file = 0; file < files; file++) {
+		for (int side = 0; side < sides; side++) {
+			Pairs& pairs = getPairs(side, file);
+			pairs.blockLengths = data + offset;
+			offset += pairs.blockLengthCount * 2;
+		}
+	}
+	for (int file = 0; file < files; file++) {
+		for (int side = 0; side < sides; side++) {
+			Pairs& pairs = getPairs(side, file);
+			offset = (offset + 63) & ~static_cast<uint64_t>(63);
+			pairs.data = data + offset;
+			offset += pairs.blockCount * pairs.blockSize;
+		}
+	}
+
+	return offset <= size;
+}
+
+/**
+ * Splits the pieces into groups and sets the start index of every group.
+ * The leading group holds the pawns of one side, or the kings and a unique
+ * piece, or only the kings. All other groups hold pieces of the same kind.
+ * The order tells in which order the groups are multiplied.
+ */
+bool SyzygyTable::setGroups(Pairs& pairs, const std::array<int, 2>& order, int file) const {
+	std::array<int, piece::VALUES_SIZE> counts = {};
+	for (int i = 0; i < pieceCount; i++) {
+		counts[pairs.pieces[i]]++;
+	}
+	if ((hasPawns && piece::getType(pairs.pieces[0]) != piecetype::PAWN)
+		|| (!hasPawns && !hasUniquePieces && (piece::getType(pairs.pieces[0]) != piecetype::KING
+											  || piece::getType(pairs.pieces[1]) != piecetype::KING))
+		|| counts[piece::WHITE_KING] != 1 || counts[piece::BLACK_KING] != 1) {
+		return false;
+	}
+
+	int count = 0;
+	int firstLength = hasPawns ? 0 : hasUniquePieces ? 3 : 2;
+	pairs.groupLengths[0] = 1;
+	for (int i = 1; i < pieceCount; i++) {
+		if (--firstLength > 0 || pairs.pieces[i] == pairs.pieces[i - 1]) {
+			pairs.groupLengths[count]++;
+		} else {
+			pairs.groupLengths[++count] = 1;
+		}
+	}
+	pairs.groupLengths[++count] = 0;
+
+	bool hasBothPawns = hasPawns && pawnCounts[1] > 0;
+	for (int i = 0; i < count; i++) {
+		if (pairs.groupLengths[i] > 5) {
+			return false;
+		}
+	}
+	if (order[0] >= count || (hasBothPawns && (order[1] >= count || order[1] == order[0]))) {
+		return false;
+	}
+
+	int next = hasBothPawns ? 2 : 1;
+	int freeSquares = 64 - pairs.groupLengths[0] - (hasBothPawns ? pairs.groupLengths[1] : 0);
+	uint64_t index = 1;
+	for (int k = 0; next < count || k == order[0] || k == order[1]; k++) {
+		if (k == order[0]) {
+			pairs.groupIndices[0] = index;
+			index *= hasPawns ? encoding.leadPawnSizes[pairs.groupLengths[0]][file] : hasUniquePieces ? 31332 : 462;
+		} else if (k == order[1]) {
+			pairs.groupIndices[1] = index;
+			index *= encoding.binomial[pairs.groupLengths[1]][48 - pairs.groupLengths[0]];
+		} else {
+			pairs.groupIndices[next] = index;
+			index *= encoding.binomial[pairs.groupLengths[next]][freeSquares];
+			freeSquares -= pairs.groupLengths[next++];
+		}
+	}
+	pairs.groupIndices[count] = index;
+
+	return true;
+}
+
+/**
+ * Reads the block layout and the Huffman code of a compressed table. A table
+ * with a single value stores only that value.
+ */
+bool SyzygyTable::setSizes(Pairs& pairs, const uint8_t* data, uint64_t size, uint64_t& offset) {
+	if (offset + 2 > size) {
+		return false;
+	}
+
+	pairs.flags = data[offset++];
+	if ((pairs.flags & SINGLEVALUE) != 0) {
+		pairs.minLength = data[offset++];
+		return true;
+	}
+
+	if (offset + 10 > size || data[offset] > 32 || data[offset + 1] > 32) {
+		return false;
+	}
+	uint64_t tableSize = pairs.groupIndices[std::find(pairs.groupLengths.begin(), pairs.groupLengths.end(), 0)
+											- pairs.groupLengths.begin()];
+	pairs.blockSize = uint64_t(1) << data[offset++];
+	pairs.span = uint64_t(1) << data[offset++];
+	pairs.sparseIndexCount = (tableSize + pairs.span - 1) / pairs.span;
+	int padding = data[offset++];
+	pairs.blockCount = readInt(data + offset);
+	offset += 4;
+	pairs.blockLengthCount = pairs.blockCount + padding;
+	pairs.maxLength = data[offset++];
+	pairs.minLength = data[offset++];
+	if (pairs.maxLength < pairs.minLength || pairs.maxLength >= 64) {
+		return false;
+	}
+
+	// Longer codes have lower values. The lowest code of every length is
+	// half of the next longer one after its symbols.
+	int lengths = pairs.maxLength - pairs.minLength + 1;
+	pairs.lowestSymbols = data + offset;
+	offset += 2 * lengths;
+	if (offset + 2 > size) {
+		return false;
+	}
+	pairs.bases.assign(lengths, 0);
+	for (int i = lengths - 2; i >= 0; i--) {
+		pairs.bases[i] = (pairs.bases[i + 1] + readShort(pairs.lowestSymbols + 2 * i)
+						  - readShort(pairs.lowestSymbols + 2 * (i + 1))) / 2;
+	}
+	for (int i = 0; i < lengths; i++) {
+		pairs.bases[i] <<= 64 - i - pairs.minLength;
+	}
+
+	int symbolCount = readShort(data + offset);
+	offset += 2;
+	pairs.tree = data + offset;
+	offset += 3 * symbolCount + (symbolCount & 1);
+	if (offset > size) {
+		return false;
+	}
+
+	pairs.symbolLengths.assign(symbolCount, 0);
+	std::vector<bool> visited(symbolCount);
+	for (int symbol = 0; symbol < symbolCount; symbol++) {
+		if (!visited[symbol] && pairs.setSymbolLength(symbol, visited) < 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int SyzygyTable::Pairs::getLeft(int symbol) const {
+	return (tree[3 * symbol + 1] & 0xF) << 8 | tree[3 * symbol];
+}
+
+int SyzygyTable::Pairs::getRight(int symbol) const {
+	return tree[3 * symbol + 2] << 4 | tree[3 * symbol + 1] >> 4;
+}
+
+/**
+ * Sets the number of values a symbol expands to. A symbol is either a value
+ * or a pair of symbols. Returns -1 if the tree is broken.
+ */
+int SyzygyTable::Pairs::setSymbolLength(int symbol, std::vector<bool>& visited) {
+	visited[symbol] = true;
+	int right = getRight(symbol);
+	if (right == 0xFFF) {
+		symbolLengths[symbol] = 0;
+		return 0;
+	}
+
+	int left = getLeft(symbol);
+	int size = static_cast<int>(symbolLengths.size());
+	if (left >= size || right >= size
+		|| (!visited[left] && setSymbolLength(left, visited) < 0)
+		|| (!visited[right] && setSymbolLength(right, visited) < 0)
+		|| symbolLengths[left] + symbolLengths[right] + 1 > 255) {
+		return -1;
+	}
+
+	symbolLengths[symbol] = static_cast<uint8_t>(symbolLengths[left] + symbolLengths[right] + 1);
+	return symbolLengths[symbol];
+}
+
+/**
+ * Returns the value at index. The sparse index points us near the block of
+ * the value. We then read the symbols of the block until we reach the one
+ * which contains the value and expand it.
+ */
+int SyzygyTable::Pairs::decompress(uint64_t index) const {
+	if ((flags & SINGLEVALUE) != 0) {
+		return minLength;
+	}
+
+	// Every entry points to the value in the middle of its span
+	const uint8_t* entry = sparseIndex + 6 * (index / span);
+	uint32_t block = readInt(entry);
+	int64_t offset = readShort(entry + 4)
+					 + static_cast<int64_t>(index % span) - static_cast<int64_t>(span / 2);
+	while (offset < 0) {
+		offset += readShort(blockLengths + 2 * --block) + 1;
+	}
+	while (offset > readShort(blockLengths + 2 * block)) {
+		offset -= readShort(blockLengths + 2 * block++) + 1;
+	}
+
+	const uint8_t* pointer = data + block * blockSize;
+	uint64_t buffer = static_cast<uint64_t>(readBigInt(pointer)) << 32 | readBigInt(pointer + 4);
+	pointer += 8;
+	int bufferSize = 64;
+	int symbol;
+	while (true) {
+		int length = 0;
+		while (buffer < bases[length]) {
+			length++;
+		}
+		symbol = static_cast<int>((buffer - bases[length]) >> (64 - length - minLength))
+				 + readShort(lowestSymbols + 2 * length);
+		if (offset < symbolLengths[symbol] + 1) {
+			break;
+		}
+
+		offset -= symbolLengths[symbol] + 1;
+		length += minLength;
+		buffer <<= length;
+		bufferSize -= length;
+		if (bufferSize <= 32) {
+			bufferSize += 32;
+			buffer |= static_cast<uint64_t>(readBigInt(pointer)) << (64 - bufferSize);
+			pointer += 4;
+		}
+	}
+
+	// The values of a pair are adjacent
+	while (symbolLengths[symbol] != 0) {
+		int left = getLeft(symbol);
+		if (offset < symbolLengths[left] + 1) {
+			symbol = left;
+		} else {
+			offset -= symbolLengths[left] + 1;
+			symbol = getRight(symbol);
+		}
+	}
+
+	return getLeft(symbol);
+}
+
+/**
+ * Returns the index of the position. We swap colors so the first side of
+ * the name plays white, and mirror the squares so the leading piece or pawn
+ * lands in its part of the board. Side is the side to move of the table and
+ * file the file of the leading pawn.
+ */
+uint64_t SyzygyTable::getIndex(const Position& position, bool flipped, bool isDtz, int& side, int& file) const {
+	// Symmetric tables only store white to move
+	bool flip = flipped || (isSymmetric && position.activeColor == color::BLACK);
+	int first = flip ? color::BLACK : color::WHITE;
+	int flipSquares = flip ? 56 : 0;
+	side = position.activeColor == first ? 0 : 1;
+	file = 0;
+
+	std::array<int, MAX_PIECES> squares;
+	std::array<int, MAX_PIECES> pieces;
+	int size = 0;
+	int leadPawnCount = 0;
+	int leadColor = color::NOCOLOR;
+	if (hasPawns) {
+		int leadPiece = (isDtz ? dtzPairs[0] : wdlPairs[0][0]).pieces[0];
+		leadColor = piece::getColor(leadPiece);
+		uint64_t pawns = position.pieces[leadColor == color::WHITE ? first : color::opposite(first)][piecetype::PAWN];
+		for (; pawns != 0 && size < MAX_PIECES; pawns = bitboard::remainder(pawns)) {
+			squares[size] = bitboard::numberOfTrailingZeros(pawns) ^ flipSquares;
+			pieces[size++] = leadPiece;
+		}
+		leadPawnCount = size;
+		if (leadPawnCount == 0) {
+			return NOINDEX;
+		}
+
+		std::swap(squares[0], *std::max_element(squares.begin(), squares.begin() + leadPawnCount, [](int a, int b) {
+			return encoding.pawnSlots[a] < encoding.pawnSlots[b];
+		}));
+		file = std::min(squares[0] & 7, 7 - (squares[0] & 7));
+	}
+
+	for (int color: color::values) {
+		int tableColor = color == first ? color::WHITE : color::BLACK;
+		for (int piecetype: piecetype::values) {
+			if (piecetype == piecetype::PAWN && tableColor == leadColor) {
+				continue;
+			}
+			for (uint64_t bitboard = position.pieces[color][piecetype];
+				 bitboard != 0; bitboard = bitboard::remainder(bitboard)) {
+				if (size == MAX_PIECES) {
+					return NOINDEX;
+				}
+				squares[size] = bitboard::numberOfTrailingZeros(bitboard) ^ flipSquares;
+				pieces[size++] = piece::valueOf(tableColor, piecetype);
+			}
+		}
+	}
+	if (size != pieceCount) {
+		return NOINDEX;
+	}
+
+	// Sort the pieces into the order of the table
+	const Pairs& pairs = isDtz ? dtzPairs[file] : wdlPairs[side][file];
+	for (int i = leadPawnCount; i < size - 1; i++) {
+		for (int j = i + 1; j < size; j++) {
+			if (pairs.pieces[i] == pieces[j]) {
+				std::swap(pieces[i], pieces[j]);
+				std::swap(squares[i], squares[j]);
+				break;
+			}
+		}
+	}
+
+	if ((squares[0] & 7) > 3) {
+		for (int i = 0; i < size; i++) {
+			squares[i] ^= 7;
+		}
+	}
+
+	uint64_t index;
+	if (hasPawns) {
+		index = encoding.leadPawnIndices[leadPawnCount][squares[0]];
+		std::stable_sort(squares.begin() + 1, squares.begin() + leadPawnCount, [](int a, int b) {
+			return encoding.pawnSlots[a] < encoding.pawnSlots[b];
+		});
+		for (int i = 1; i < leadPawnCount; i++) {
+			index += encoding.binomial[i][encoding.pawnSlots[squares[i]]];
+		}
+	} else {
+		if ((squares[0] >> 3) > 3) {
+			for (int i = 0; i < size; i++) {
+				squares[i] ^= 56;
+			}
+		}
+
+		// The first piece of the leading group off the diagonal goes below it
+		for (int i = 0; i < pairs.groupLengths[0]; i++) {
+			if (getDiagonal(squares[i]) == 0) {
+				continue;
+			}
+			if (getDiagonal(squares[i]) > 0) {
+				for (int j = i; j < size; j++) {
+					squares[j] = flipDiagonal(squares[j]);
+				}
+			}
+			break;
+		}
+
+		if (hasUniquePieces) {
+			int adjust1 = squares[1] > squares[0];
+			int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+			if (getDiagonal(squares[0]) != 0) {
+				index = (uint64_t(encoding.triangle[squares[0]]) * 63 + (squares[1] - adjust1)) * 62
+						+ squares[2] - adjust2;
+			} else if (getDiagonal(squares[1]) != 0) {
+				index = (6 * 63 + (squares[0] >> 3) * 28 + encoding.belowDiagonal[squares[1]]) * 62
+						+ squares[2] - adjust2;
+			} else if (getDiagonal(squares[2]) != 0) {
+				index = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28 + ((squares[1] >> 3) - adjust1) * 28
+						+ encoding.belowDiagonal[squares[2]];
+			} else {
+				index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (squares[0] >> 3) * 7 * 6
+						+ ((squares[1] >> 3) - adjust1) * 6 + ((squares[2] >> 3) - adjust2);
+			}
+		} else {
+			index = encoding.kings[encoding.triangle[squares[0]]][squares[1]];
+		}
+	}
+	index *= pairs.groupIndices[0];
+
+	// The other groups are combinations of the free squares
+	int* groupSquares = squares.data() + pairs.groupLengths[0];
+	bool remainingPawns = hasPawns && pawnCounts[1] > 0;
+	for (int next = 1; pairs.groupLengths[next] != 0; next++) {
+		int length = pairs.groupLengths[next];
+		std::stable_sort(groupSquares, groupSquares + length);
+		uint64_t combination = 0;
+		for (int i = 0; i < length; i++) {
+			int square = groupSquares[i];
+			int adjust = static_cast<int>(std::count_if(squares.data(), groupSquares, [&](int s) { return square > s; }));
+			combination += encoding.binomial[i + 1][square - adjust - 8 * remainingPawns];
+		}
+		remainingPawns = false;
+		index += combination * pairs.groupIndices[next];
+		groupSquares += length;
+	}
+
+	return index;
+}
+
+uint64_t SyzygyTable::getSize(bool isDtz, int side, int file) const {
+	const Pairs& pairs = isDtz ? dtzPairs[file] : wdlPairs[side][file];
+	return pairs.groupIndices[std::find(pairs.groupLengths.begin(), pairs.groupLengths.end(), 0)
+							  - pairs.groupLengths.begin()];
+}
+
+/**
+ * Returns the stored result. If the side to move can capture, the table may
+ * store any result which is not better than the best capture.
+ */
+bool SyzygyTable::probeWdl(const Position& position, bool flipped, int& wdl) const {
+	int side;
+	int file;
+	uint64_t index = hasWdl ? getIndex(position, flipped, false, side, file) : NOINDEX;
+	if (index == NOINDEX) {
+		return false;
+	}
+
+	wdl = wdlPairs[side][file].decompress(index) - 2;
+	return true;
+}
+
+/**
+ * Returns the plies to the next capture, pawn move or mate. Positions where
+ * a capture or pawn move wins are not stored.
+ */
+int SyzygyTable::probeDtz(const Position& position, bool flipped, int wdl, int& dtz) const {
+	int side;
+	int file;
+	uint64_t index = hasDtz ? getIndex(position, flipped, true, side, file) : NOINDEX;
+	if (index == NOINDEX) {
+		return Tablebases::NOTFOUND;
+	}
+
+	const Pairs& pairs = dtzPairs[file];
+	if ((pairs.flags & STM) != side && !(isSymmetric && !hasPawns)) {
+		return Tablebases::OTHERSIDE;
+	}
+
+	dtz = getDtz(pairs, pairs.decompress(index), wdl);
+	return Tablebases::FOUND;
+}
+
+bool SyzygyTable::isExact() const {
+	return false;
+}
+
+/**
+ * Maps a stored DTZ value back to plies. Values are stored by frequency per
+ * result, and in moves unless the table says plies.
+ */
+int SyzygyTable::getDtz(const Pairs& pairs, int value, int wdl) const {
+	if ((pairs.flags & MAPPED) != 0) {
+		uint32_t index = pairs.mapIndices[WDL_MAPS[wdl + 2]] + value;
+		value = (pairs.flags & WIDE) != 0 ? readShort(dtzMap + 2 * index) : dtzMap[index];
+	}
+
+	if ((wdl == Tablebases::WIN && (pairs.flags & WINPLIES) == 0)
+		|| (wdl == Tablebases::LOSS && (pairs.flags & LOSSPLIES) == 0)
+		|| wdl == Tablebases::CURSEDWIN || wdl == Tablebases::BLESSEDLOSS) {
+		value *= 2;
+	}
+
+	return value + 1;
+}
+}
@@ -0,0 +1,128 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "tablebases.h"
+#include "position.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class decodes the WDL and DTZ files of a Syzygy table. A file stores
+ * one value per position index, compressed with recursive pairing and
+ * canonical Huffman codes in blocks. Tables with pawns are split by the
+ * file of the leading pawn. The WDL file stores both sides to move, the DTZ
+ * file only one of them.
+ */
+class SyzygyTable final : public Tablebases::Table {
+public:
+	static const std::string WDL_EXTENSION;
+	static const std::string DTZ_EXTENSION;
+
+	static const int MAX_PIECES = 7;
+
+	static const uint64_t NOINDEX = UINT64_MAX;
+
+	// Flags of a compressed table
+	static const int STM = 1;
+	static const int MAPPED = 2;
+	static const int WINPLIES = 4;
+	static const int LOSSPLIES = 8;
+	static const int WIDE = 16;
+	static const int SINGLEVALUE = 128;
+
+	explicit SyzygyTable(const std::string& name);
+
+	const std::string& getName() const;
+
+	bool setWdl(const uint8_t* data, uint64_t size);
+
+	bool setDtz(const uint8_t* data, uint64_t size);
+
+	uint64_t getIndex(const Position& position, bool flipped, bool isDtz, int& side, int& file) const;
+
+	uint64_t getSize(bool isDtz, int side, int file) const;
+
+	bool probeWdl(const Position& position, bool flipped, int& wdl) const override;
+
+	int probeDtz(const Position& position, bool flipped, int wdl, int& dtz) const override;
+
+	bool isExact() const override;
+
+private:
+	/**
+	 * The compressed values of one side to move and one leading pawn file.
+	 */
+	class Pairs final {
+	public:
+		int flags = 0;
+		uint64_t blockSize = 0;
+		uint64_t span = 0;
+		uint32_t blockCount = 0;
+		int minLength = 0;
+		int maxLength = 0;
+
+		// The lowest symbol of every code length
+		const uint8_t* lowestSymbols = nullptr;
+		// The left and right symbols of every symbol, 12 bits each
+		const uint8_t* tree = nullptr;
+		const uint8_t* blockLengths = nullptr;
+		uint64_t blockLengthCount = 0;
+		const uint8_t* sparseIndex = nullptr;
+		uint64_t sparseIndexCount = 0;
+		const uint8_t* data = nullptr;
+
+		// The lowest code of every length, left aligned
+		std::vector<uint64_t> bases;
+		// The number of values a symbol expands to, minus one
+		std::vector<uint8_t> symbolLengths;
+
+		// The pieces in index order and their groups
+		std::array<int, MAX_PIECES> pieces = {};
+		std::array<int, MAX_PIECES + 1> groupLengths = {};
+		std::array<uint64_t, MAX_PIECES + 1> groupIndices = {};
+
+		// Offsets into the DTZ map for wins, losses, cursed wins and
+		// blessed losses
+		std::array<uint32_t, 4> mapIndices = {};
+
+		int getLeft(int symbol) const;
+
+		int getRight(int symbol) const;
+
+		int setSymbolLength(int symbol, std::vector<bool>& visited);
+
+		int decompress(uint64_t index) const;
+	};
+
+	std::string name;
+	int pieceCount = 0;
+	bool hasPawns = false;
+	bool hasUniquePieces = false;
+	bool isSymmetric = false;
+
+	// Pawns of the leading color first
+	std::array<int, 2> pawnCounts = {};
+
+	std::array<std::array<Pairs, 4>, 2> wdlPairs;
+	std::array<Pairs, 4> dtzPairs;
+	const uint8_t* dtzMap = nullptr;
+	bool hasWdl = false;
+	bool hasDtz = false;
+
+	bool parse(const uint8_t* data, uint64_t size, bool isDtz);
+
+	bool setGroups(Pairs& pairs, const std::array<int, 2>& order, int file) const;
+
+	static bool setSizes(Pairs& pairs, const uint8_t* data, uint64_t size, uint64_t& offset);
+
+	int getDtz(const Pairs& pairs, int value, int wdl) const;
+};
+}
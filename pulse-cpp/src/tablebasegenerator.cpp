@@ -0,0 +1,313 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "tablebasegenerator.h"
+#include "tablebases.h"
+#include "threadpool.h"
+#include "model/color.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace pulse {
+
+/**
+ * Generates the tables of names and all tables they depend on. Tables
+ * which already exist in the directory are loaded instead.
+ */
+std::vector<TablebaseGenerator::Result> TablebaseGenerator::run(const std::string& directory,
+																const std::vector<std::string>& names,
+																int threadCount, uint64_t memory) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	std::vector<Result> results;
+	for (const std::string& name: names) {
+		if (Tablebases::getMaterialKey(name) == 0 || name.size() - 1 > GeneratedTable::MAX_PIECES) {
+			throw std::runtime_error("Invalid table " + name);
+		}
+		require(directory, name, threadCount, memory, results);
+	}
+
+	return results;
+}
+
+void TablebaseGenerator::require(const std::string& directory, const std::string& name, int threadCount,
+								 uint64_t memory, std::vector<Result>& results) {
+	std::string canonicalName = GeneratedTable::getCanonicalName(name);
+	if (GeneratedTable::isDrawn(canonicalName)
+		|| subtables.find(Tablebases::getMaterialKey(canonicalName)) != subtables.end()) {
+		return;
+	}
+
+	for (const std::string& successor: GeneratedTable::getSuccessors(canonicalName)) {
+		require(directory, successor, threadCount, memory, results);
+	}
+
+	std::string path = (std::filesystem::path(directory) / (canonicalName + GeneratedTable::EXTENSION)).string();
+	if (!std::filesystem::exists(path)) {
+		results.push_back(generate(path, canonicalName, threadCount, memory));
+	}
+	load(path, canonicalName);
+}
+
+void TablebaseGenerator::load(const std::string& path, const std::string& name) {
+	Subtable subtable;
+	subtable.mappedFile = std::make_unique<MappedFile>(path, MappedFile::READONLY);
+	subtable.table = std::make_unique<GeneratedTable>(name);
+
+	const MappedFile& mappedFile = *subtable.mappedFile;
+	if (mappedFile.size() != sizeof(GeneratedTable::Header) + subtable.table->getSize()
+		|| !GeneratedTable::isValid(*reinterpret_cast<const GeneratedTable::Header*>(mappedFile.data()), name)) {
+		throw std::runtime_error("Invalid table file " + path);
+	}
+
+	const uint8_t* values = mappedFile.data() + sizeof(GeneratedTable::Header);
+	subtable.table->setValues(values);
+	for (uint64_t index = 0; index < subtable.table->getSize(); index++) {
+		int value = values[index];
+		subtable.longestMate = std::max(subtable.longestMate,
+										value < GeneratedTable::LOSS ? value : value - GeneratedTable::LOSS);
+	}
+
+	subtables[Tablebases::getMaterialKey(name)] = std::move(subtable);
+}
+
+TablebaseGenerator::Result TablebaseGenerator::generate(const std::string& path, const std::string& name,
+														 int threadCount, uint64_t memory) {
+	auto startTime = std::chrono::steady_clock::now();
+
+	GeneratedTable table(name);
+	uint64_t size = table.getSize();
+	if (size > memory) {
+		throw std::runtime_error(
+				"Table " + name + " needs " + std::to_string((size + (1 << 20) - 1) >> 20) + " MB of memory");
+	}
+	std::vector<std::atomic<uint8_t>> values(size);
+	uint32_t materialKey = Tablebases::getMaterialKey(name);
+
+	// A subtable can only change our results while its mates are longer
+	int limit = 0;
+	for (auto& subtable: subtables) {
+		limit = std::max(limit, 2 * subtable.second.longestMate);
+	}
+
+	Result result;
+	result.name = name;
+
+	ThreadPool threadPool(threadCount);
+	uint64_t chunkCount = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	auto pass = [&](int plies) {
+		std::atomic<uint64_t> nextChunk{0};
+		std::atomic<uint64_t> count{0};
+		std::vector<std::future<void>> futures;
+		for (int i = 0; i < threadCount; i++) {
+			futures.push_back(threadPool.submit([&] {
+				std::unique_ptr<Position> position(new Position());
+				std::unique_ptr<MoveGenerator> moveGenerator(new MoveGenerator());
+				std::unique_ptr<MoveGenerator> replyGenerator(new MoveGenerator());
+				for (uint64_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+					uint64_t end = std::min((chunk + 1) * CHUNK_SIZE, size);
+					for (uint64_t index = chunk * CHUNK_SIZE; index < end; index++) {
+						if (update(table, values, materialKey, index, plies, *position, *moveGenerator,
+								   *replyGenerator)) {
+							count++;
+						}
+					}
+				}
+			}));
+		}
+		for (auto& future: futures) {
+			future.get();
+		}
+		return count.load();
+	};
+
+	// Mark mates, stalemates and positions we cannot reach
+	result.positions = pass(0);
+
+	// Stop after two quiet iterations
+	uint64_t previous = 1;
+	for (int plies = 1;; plies++) {
+		uint64_t count = pass(plies);
+		if (count == 0 && previous == 0 && plies > limit) {
+			break;
+		}
+		previous = count;
+
+		if ((plies + 1) / 2 > GeneratedTable::MAX_MOVES) {
+			throw std::runtime_error("Table " + name + " has mates longer than "
+									 + std::to_string(GeneratedTable::MAX_MOVES) + " moves");
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	GeneratedTable::Header header = GeneratedTable::createHeader(name);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<uint8_t> buffer(CHUNK_SIZE);
+	for (uint64_t start = 0; start < size; start += CHUNK_SIZE) {
+		uint64_t end = std::min(start + CHUNK_SIZE, size);
+		for (uint64_t index = start; index < end; index++) {
+			uint8_t value = values[index].load(std::memory_order_relaxed);
+			if (value == GeneratedTable::UNKNOWN) {
+				value = GeneratedTable::DRAW;
+			} else if (value >= GeneratedTable::LOSS) {
+				result.losses++;
+				result.longestMate = std::max(result.longestMate, value - GeneratedTable::LOSS);
+			} else if (value != GeneratedTable::DRAW) {
+				result.wins++;
+				result.longestMate = std::max(result.longestMate, +value);
+			}
+			buffer[index - start] = value;
+		}
+		file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(end - start));
+	}
+	file.close();
+	if (!file) {
+		std::filesystem::remove(path);
+		throw std::runtime_error("Cannot write " + path);
+	}
+	result.draws = result.positions - result.wins - result.losses;
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - startTime).count();
+
+	std::cout << "Table: " << name << std::endl;
+	std::cout << "Positions: " << result.positions << std::endl;
+	std::cout << "Wins: " << result.wins << std::endl;
+	std::cout << "Losses: " << result.losses << std::endl;
+	std::cout << "Draws: " << result.draws << std::endl;
+	std::cout << "Longest mate: " << result.longestMate << " moves" << std::endl;
+	std::cout << "Time: " << duration << " ms" << std::endl;
+
+	return result;
+}
+
+/**
+ * Runs one step of the analysis on the position at index. With zero plies
+ * we initialize the position and return true if it is legal. Otherwise we
+ * return true if we resolved the position in this iteration.
+ */
+bool TablebaseGenerator::update(const GeneratedTable& table, std::vector<std::atomic<uint8_t>>& values,
+								uint32_t materialKey, uint64_t index, int plies, Position& position,
+								MoveGenerator& moveGenerator, MoveGenerator& replyGenerator) const {
+	if (plies > 0 && values[index].load(std::memory_order_relaxed) != GeneratedTable::UNKNOWN) {
+		return false;
+	}
+
+	std::array<int, GeneratedTable::MAX_PIECES> squares;
+	if (!table.setup(index, position, squares)) {
+		values[index].store(GeneratedTable::DRAW, std::memory_order_relaxed);
+		return false;
+	}
+
+	// We check the legality of the moves ourselves, so we make every move
+	// only once.
+	bool isCheck = position.isCheck();
+	MoveList<MoveEntry>& moves = moveGenerator.getUnsortedMoves(position, isCheck);
+	bool updated = false;
+	if (plies == 0) {
+		int value = GeneratedTable::DRAW;
+		if (!position.isCheck(color::opposite(position.activeColor))) {
+			updated = true;
+			value = isCheck ? GeneratedTable::LOSS : GeneratedTable::DRAW;
+			for (int i = 0; i < moves.size; i++) {
+				int move = moves.entries[i]->move;
+				position.makeMove(move);
+				bool isLegal = !position.isCheck(color::opposite(position.activeColor));
+				position.undoMove(move);
+
+				if (isLegal) {
+					value = GeneratedTable::UNKNOWN;
+					break;
+				}
+			}
+		}
+		values[index].store(static_cast<uint8_t>(value), std::memory_order_relaxed);
+	} else {
+		// An odd iteration looks for a move into a loss one ply shorter, an
+		// even iteration for a position where every move runs into a win.
+		bool isWin = plies % 2 == 1;
+		int target = isWin ? GeneratedTable::LOSS + (plies - 1) / 2 : plies / 2;
+		updated = !isWin;
+		for (int i = 0; i < moves.size; i++) {
+			int move = moves.entries[i]->move;
+			position.makeMove(move);
+			// Illegal moves neither win nor spoil a loss
+			int value = position.isCheck(color::opposite(position.activeColor))
+						? -1 : getValue(table, values, materialKey, position, replyGenerator);
+			position.undoMove(move);
+
+			if (isWin && value == target) {
+				updated = true;
+				break;
+			} else if (!isWin && (value == GeneratedTable::DRAW || value > target)) {
+				updated = false;
+				break;
+			}
+		}
+
+		if (updated) {
+			values[index].store(
+					static_cast<uint8_t>(isWin ? (plies + 1) / 2 : GeneratedTable::LOSS + plies / 2),
+					std::memory_order_relaxed);
+		}
+	}
+
+	for (int i = 0; i < static_cast<int>(table.getName().size()) - 1; i++) {
+		position.remove(squares[i]);
+	}
+
+	return updated;
+}
+
+/**
+ * Returns the value of a position where neither side has the material to
+ * force a mate. The last move may still have mated.
+ */
+int TablebaseGenerator::getDrawnValue(Position& position, MoveGenerator& moveGenerator) {
+	bool isCheck = position.isCheck();
+	if (isCheck && moveGenerator.getLegalMoves(position, 1, isCheck).size == 0) {
+		return GeneratedTable::LOSS;
+	}
+	return GeneratedTable::DRAW;
+}
+
+/**
+ * Returns the value of the position after a move. It is either in the
+ * table we generate or in one of the subtables. We don't generate tables
+ * without mating material.
+ */
+int TablebaseGenerator::getValue(const GeneratedTable& table, const std::vector<std::atomic<uint8_t>>& values,
+								 uint32_t materialKey, Position& position, MoveGenerator& moveGenerator) const {
+	if (Tablebases::getMaterialKey(position, color::WHITE) == materialKey) {
+		return values[table.getIndex(position, false)].load(std::memory_order_relaxed);
+	}
+
+	bool flipped = false;
+	auto iterator = subtables.find(Tablebases::getMaterialKey(position, color::WHITE));
+	if (iterator == subtables.end()) {
+		flipped = true;
+		iterator = subtables.find(Tablebases::getMaterialKey(position, color::BLACK));
+	}
+	if (iterator != subtables.end()) {
+		const Subtable& subtable = iterator->second;
+		uint64_t index = subtable.table->getIndex(position, flipped);
+		return subtable.mappedFile->data()[sizeof(GeneratedTable::Header) + index];
+	}
+
+	if (position.hasInsufficientMaterial()) {
+		return getDrawnValue(position, moveGenerator);
+	}
+
+	// We generate all subtables first
+	throw std::exception();
+}
+}
@@ -0,0 +1,78 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "generatedtable.h"
+#include "mappedfile.h"
+#include "movegenerator.h"
+#include "position.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pulse {
+
+/**
+ * This class generates endgame tables by retrograde analysis. We mark all
+ * mates first. Then every iteration adds the positions which win in one
+ * more ply, because a move reaches a lost position, and the positions which
+ * lose in one more ply, because every move reaches a won position. All
+ * positions left over are draws.
+ *
+ * Captures and promotions lead into smaller tables. We generate them first
+ * or load them from the directory if they exist.
+ */
+class TablebaseGenerator final {
+public:
+	static const uint64_t DEFAULT_MEMORY = 1024 * 1024 * 1024;
+
+	class Result final {
+	public:
+		std::string name;
+		uint64_t positions = 0;
+		uint64_t wins = 0;
+		uint64_t losses = 0;
+		uint64_t draws = 0;
+		int longestMate = 0;
+	};
+
+	std::vector<Result> run(const std::string& directory, const std::vector<std::string>& names,
+							int threadCount, uint64_t memory);
+
+	static int getDrawnValue(Position& position, MoveGenerator& moveGenerator);
+
+private:
+	// Chunks are large enough to keep the thread pool busy
+	static const uint64_t CHUNK_SIZE = 1 << 14;
+
+	class Subtable final {
+	public:
+		std::unique_ptr<MappedFile> mappedFile;
+		std::unique_ptr<GeneratedTable> table;
+		int longestMate = 0;
+	};
+
+	// Tables we are done with by material key
+	std::unordered_map<uint32_t, Subtable> subtables;
+
+	void require(const std::string& directory, const std::string& name, int threadCount, uint64_t memory,
+				 std::vector<Result>& results);
+
+	void load(const std::string& path, const std::string& name);
+
+	Result generate(const std::string& path, const std::string& name, int threadCount, uint64_t memory);
+
+	bool update(const GeneratedTable& table, std::vector<std::atomic<uint8_t>>& values, uint32_t materialKey,
+				uint64_t index, int plies, Position& position, MoveGenerator& moveGenerator,
+				MoveGenerator& replyGenerator) const;
+
+	int getValue(const GeneratedTable& table, const std::vector<std::atomic<uint8_t>>& values,
+				 uint32_t materialKey, Position& position, MoveGenerator& moveGenerator) const;
+};
+}
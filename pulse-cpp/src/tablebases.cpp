@@ -0,0 +1,471 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "tablebases.h"
+#include "generatedtable.h"
+#include "syzygytable.h"
+#include "bitboard.h"
+#include "model/castling.h"
+#include "model/color.h"
+#include "model/move.h"
+#include "model/movetype.h"
+#include "model/piece.h"
+#include "model/piecetype.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <limits>
+#include <sstream>
+
+namespace pulse {
+
+namespace {
+#ifdef _WIN32
+constexpr char PATH_SEPARATOR = ';';
+#else
+constexpr char PATH_SEPARATOR = ':';
+#endif
+
+// The pieces of a side in the order of tablebase names
+const std::string PIECE_LETTERS = "QRBNP";
+constexpr std::array<int, 5> PIECE_TYPES = {
+		piecetype::QUEEN, piecetype::ROOK, piecetype::BISHOP, piecetype::KNIGHT, piecetype::PAWN
+};
+
+// Captures remove a piece, so searching them ends after a few plies
+constexpr int MAX_PLIES = SyzygyTable::MAX_PIECES + 2;
+}
+
+/**
+ * Scans the directories of path for tables. Probes must not run while
+ * we change the path.
+ */
+void Tablebases::setPath(const std::string& path) {
+	entries.clear();
+	maxPieces = 0;
+
+	std::istringstream directories(path);
+	std::string directory;
+	while (std::getline(directories, directory, PATH_SEPARATOR)) {
+		std::error_code error;
+		for (auto& file: std::filesystem::directory_iterator(directory, error)) {
+			std::string extension = file.path().extension().string();
+			if (extension != SyzygyTable::WDL_EXTENSION && extension != SyzygyTable::DTZ_EXTENSION
+				&& extension != GeneratedTable::EXTENSION) {
+				continue;
+			}
+
+			std::string name = file.path().stem().string();
+			uint32_t materialKey = getMaterialKey(name);
+			if (materialKey == 0) {
+				continue;
+			}
+
+			std::unique_ptr<Entry>& entry = entries[materialKey];
+			if (!entry) {
+				entry = std::make_unique<Entry>();
+			}
+			if (extension == SyzygyTable::WDL_EXTENSION) {
+				entry->wdlPath = file.path().string();
+			} else if (extension == SyzygyTable::DTZ_EXTENSION) {
+				entry->dtzPath = file.path().string();
+			} else {
+				entry->generatedPath = file.path().string();
+			}
+
+			// Every name contains a "v"
+			maxPieces = std::max(maxPieces, static_cast<int>(name.size()) - 1);
+		}
+	}
+}
+
+uint64_t Tablebases::getTableCount() const {
+	return entries.size();
+}
+
+int Tablebases::getMaxPieces() const {
+	return maxPieces;
+}
+
+/**
+ * Returns the result of the position.
+ */
+bool Tablebases::probeWdl(Position& position, int& wdl) {
+	return search(position, false, 0, wdl) != NOTFOUND;
+}
+
+/**
+ * Returns the plies to the next capture, pawn move or mate. Positive if
+ * the side to move wins, negative if it loses and zero for a draw.
+ */
+bool Tablebases::probeDtz(Position& position, int& dtz) {
+	return probeDtz(position, 0, dtz);
+}
+
+/**
+ * Keeps only the root moves which preserve the best result. Of the winning
+ * moves we keep the fastest ones, so we make progress, and of the losing
+ * moves the slowest ones. Moves into positions missing from the tables are
+ * kept for the search to decide. Returns false and leaves the moves alone
+ * if no move could be probed.
+ */
+bool Tablebases::filterRootMoves(Position& position, MoveList<RootEntry>& rootMoves, MoveGenerator& moveGenerator) {
+	if (rootMoves.size == 0 || position.castlingRights != castling::NOCASTLING
+		|| getPieceCount(position) > maxPieces) {
+		return false;
+	}
+
+	// Rank every move by its result and its distance to zeroing the fifty
+	// move counter. A higher rank is better.
+	std::array<int, 256> ranks;
+	std::array<bool, 256> found;
+	for (int i = 0; i < rootMoves.size; i++) {
+		int move = rootMoves.entries[i]->move;
+		bool isZeroingMove = isZeroing(move);
+
+		// The results are from our opponent's point of view. A zeroing
+		// move starts the count again.
+		position.makeMove(move);
+		bool isCheckmate = false;
+		found[i] = true;
+		int dtz = 0;
+		if (moveGenerator.getLegalMoves(position, 1, position.isCheck()).size == 0) {
+			isCheckmate = position.isCheck();
+		} else if (isZeroingMove) {
+			int wdl;
+			found[i] = probeWdl(position, wdl);
+			dtz = found[i] ? getZeroingDtz(-wdl) : 0;
+		} else {
+			found[i] = probeDtz(position, dtz);
+			dtz = found[i] ? (dtz > 0 ? -dtz - 1 : (dtz < 0 ? -dtz + 1 : 0)) : 0;
+		}
+		position.undoMove(move);
+
+		int counter = (isZeroingMove ? 0 : position.halfmoveClock) + std::abs(dtz);
+		if (isCheckmate) {
+			ranks[i] = 1000;
+		} else if (dtz > 0) {
+			ranks[i] = counter <= 100 ? 1000 - dtz : +CURSEDWIN;
+		} else if (dtz < 0) {
+			ranks[i] = counter <= 100 ? -1000 - dtz : +BLESSEDLOSS;
+		} else {
+			ranks[i] = DRAW;
+		}
+	}
+
+	int bestRank = std::numeric_limits<int>::min();
+	for (int i = 0; i < rootMoves.size; i++) {
+		if (found[i]) {
+			bestRank = std::max(bestRank, ranks[i]);
+		}
+	}
+	if (bestRank == std::numeric_limits<int>::min()) {
+		return false;
+	}
+
+	int size = 0;
+	for (int i = 0; i < rootMoves.size; i++) {
+		if (!found[i] || ranks[i] == bestRank) {
+			std::swap(rootMoves.entries[size++], rootMoves.entries[i]);
+		}
+	}
+	rootMoves.size = size;
+
+	return true;
+}
+
+int Tablebases::getPieceCount(const Position& position) {
+	int count = 0;
+	for (int color: color::values) {
+		for (int piecetype: piecetype::values) {
+			count += bitboard::size(position.pieces[color][piecetype]);
+		}
+	}
+	return count;
+}
+
+/**
+ * Returns the material of both sides with the side of color first. Every
+ * side gets three bits per piece type except the king. Positions with more
+ * than seven pieces of a type get 0, no table covers them.
+ */
+uint32_t Tablebases::getMaterialKey(const Position& position, int color) {
+	uint32_t key = 0;
+	for (int side: {color, color::opposite(color)}) {
+		for (int piecetype: PIECE_TYPES) {
+			uint32_t count = bitboard::size(position.pieces[side][piecetype]);
+			if (count > 7) {
+				return 0;
+			}
+			key = (key << 3) | count;
+		}
+	}
+	return key | 1u << 31;
+}
+
+/**
+ * Returns the material key of a table name like KRPvKR, or 0 if the name is
+ * not valid.
+ */
+uint32_t Tablebases::getMaterialKey(const std::string& name) {
+	size_t separator = name.find('v');
+	if (separator == std::string::npos || name.find('v', separator + 1) != std::string::npos) {
+		return 0;
+	}
+
+	uint32_t key = 0;
+	for (const std::string& side: {name.substr(0, separator), name.substr(separator + 1)}) {
+		if (side.empty() || side[0] != 'K') {
+			return 0;
+		}
+
+		std::array<uint32_t, 5> counts = {};
+		for (size_t i = 1; i < side.size(); i++) {
+			size_t index = PIECE_LETTERS.find(side[i]);
+			if (index == std::string::npos || ++counts[index] > 7) {
+				return 0;
+			}
+		}
+		for (uint32_t count: counts) {
+			key = (key << 3) | count;
+		}
+	}
+	return key | 1u << 31;
+}
+
+/**
+ * Returns the table of the position and opens it if necessary. A table is
+ * stored for one side only, so we may have to swap colors.
+ */
+const Tablebases::Table* Tablebases::find(const Position& position, bool& flipped) {
+	if (entries.empty()) {
+		return nullptr;
+	}
+
+	flipped = false;
+	auto iterator = entries.find(getMaterialKey(position, color::WHITE));
+	if (iterator == entries.end()) {
+		flipped = true;
+		iterator = entries.find(getMaterialKey(position, color::BLACK));
+		if (iterator == entries.end()) {
+			return nullptr;
+		}
+	}
+
+	Entry& entry = *iterator->second;
+	std::call_once(entry.opened, open, std::ref(entry));
+	return entry.table.get();
+}
+
+/**
+ * Returns the result of the position. A Syzygy table may store any result
+ * which is not better than the best capture, so we search the captures
+ * first. If isZeroing is true, we also search the pawn moves. Returns
+ * ZEROING if a capture or pawn move keeps the result.
+ */
+int Tablebases::search(Position& position, bool isZeroing, int ply, int& wdl) {
+	if (position.castlingRights != castling::NOCASTLING) {
+		return NOTFOUND;
+	}
+	if (getPieceCount(position) == 2) {
+		wdl = DRAW;
+		return FOUND;
+	}
+
+	bool flipped;
+	const Table* table = find(position, flipped);
+	if (table == nullptr || ply == MAX_PLIES) {
+		return NOTFOUND;
+	} else if (table->isExact()) {
+		return table->probeWdl(position, flipped, wdl) ? FOUND : NOTFOUND;
+	}
+
+	MoveList<MoveEntry>& moves = getMoveGenerator(ply).getLegalMoves(position, 1, position.isCheck());
+	int bestValue = LOSS;
+	int moveCount = 0;
+	for (int i = 0; i < moves.size; i++) {
+		int move = moves.entries[i]->move;
+		if (move::getTargetPiece(move) == piece::NOPIECE && move::getType(move) != movetype::ENPASSANT
+			&& (!isZeroing || piece::getType(move::getOriginPiece(move)) != piecetype::PAWN)) {
+			continue;
+		}
+		moveCount++;
+
+		int value;
+		position.makeMove(move);
+		int state = search(position, false, ply + 1, value);
+		position.undoMove(move);
+		if (state == NOTFOUND) {
+			return NOTFOUND;
+		}
+
+		value = -value;
+		if (value > bestValue) {
+			bestValue = value;
+			if (value == WIN) {
+				wdl = WIN;
+				return ZEROING;
+			}
+		}
+	}
+
+	// If we have searched all moves, we don't need the table
+	bool noMoreMoves = moveCount > 0 && moveCount == moves.size;
+	int value = bestValue;
+	if (!noMoreMoves && !table->probeWdl(position, flipped, value)) {
+		return NOTFOUND;
+	}
+
+	if (bestValue >= value) {
+		wdl = bestValue;
+		return bestValue > DRAW || noMoreMoves ? ZEROING : FOUND;
+	}
+	wdl = value;
+	return FOUND;
+}
+
+/**
+ * Returns the plies to the next capture, pawn move or mate at ply. If the
+ * table only stores the other side to move, we look one ply ahead.
+ */
+bool Tablebases::probeDtz(Position& position, int ply, int& dtz) {
+	int wdl;
+	int state = search(position, true, ply, wdl);
+	if (state == NOTFOUND) {
+		return false;
+	} else if (wdl == DRAW) {
+		dtz = 0;
+		return true;
+	} else if (state == ZEROING) {
+		dtz = getZeroingDtz(wdl);
+		return true;
+	}
+
+	bool flipped;
+	const Table* table = find(position, flipped);
+	int sign = wdl > DRAW ? 1 : -1;
+	state = table->probeDtz(position, flipped, wdl, dtz);
+	if (state == FOUND) {
+		dtz = (dtz + (wdl == CURSEDWIN || wdl == BLESSEDLOSS ? 100 : 0)) * sign;
+		return true;
+	} else if (state == NOTFOUND || ply + 1 == MAX_PLIES) {
+		return false;
+	}
+
+	// Of the winning moves we take the fastest one, of the losing moves the
+	// slowest one
+	MoveList<MoveEntry>& moves = getMoveGenerator(ply).getLegalMoves(position, 1, position.isCheck());
+	int bestDtz = std::numeric_limits<int>::max();
+	for (int i = 0; i < moves.size; i++) {
+		int move = moves.entries[i]->move;
+		bool isZeroingMove = isZeroing(move);
+
+		position.makeMove(move);
+		bool found = true;
+		int value = 0;
+		if (getMoveGenerator(ply + 1).getLegalMoves(position, 1, position.isCheck()).size == 0) {
+			value = position.isCheck() ? 1 : 0;
+		} else if (isZeroingMove) {
+			int childWdl;
+			found = search(position, false, ply + 1, childWdl) != NOTFOUND;
+			value = found ? getZeroingDtz(-childWdl) : 0;
+		} else {
+			found = probeDtz(position, ply + 1, value);
+			value = value > 0 ? -value - 1 : (value < 0 ? -value + 1 : 0);
+		}
+		position.undoMove(move);
+
+		if (!found) {
+			return false;
+		}
+		if (value < bestDtz && value * sign > 0) {
+			bestDtz = value;
+		}
+	}
+
+	dtz = bestDtz == std::numeric_limits<int>::max() ? -1 : bestDtz;
+	return true;
+}
+
+/**
+ * Returns the move generator of ply. Every thread has its own.
+ */
+MoveGenerator& Tablebases::getMoveGenerator(int ply) {
+	thread_local std::array<MoveGenerator, MAX_PLIES> moveGenerators;
+	return moveGenerators[ply];
+}
+
+bool Tablebases::isZeroing(int move) {
+	return move::getTargetPiece(move) != piece::NOPIECE || move::getType(move) == movetype::ENPASSANT
+		   || piece::getType(move::getOriginPiece(move)) == piecetype::PAWN;
+}
+
+/**
+ * Returns the dtz of a move which zeroes the fifty move counter and keeps
+ * the result wdl.
+ */
+int Tablebases::getZeroingDtz(int wdl) {
+	switch (wdl) {
+		case WIN:
+			return 1;
+		case CURSEDWIN:
+			return 101;
+		case BLESSEDLOSS:
+			return -101;
+		case LOSS:
+			return -1;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Maps the files of a table and checks their headers. We prefer Syzygy
+ * tables over our own. A table with broken files stays closed and never
+ * answers a probe.
+ */
+void Tablebases::open(Entry& entry) {
+	try {
+		if (!entry.wdlPath.empty()) {
+			std::string name = std::filesystem::path(entry.wdlPath).stem().string();
+			auto table = std::make_unique<SyzygyTable>(name);
+			entry.wdlFile = std::make_unique<MappedFile>(entry.wdlPath, MappedFile::READONLY);
+			if (table->setWdl(entry.wdlFile->data(), entry.wdlFile->size())) {
+				if (!entry.dtzPath.empty()) {
+					entry.dtzFile = std::make_unique<MappedFile>(entry.dtzPath, MappedFile::READONLY);
+					if (!table->setDtz(entry.dtzFile->data(), entry.dtzFile->size())) {
+						entry.dtzFile.reset();
+					}
+				}
+				entry.table = std::move(table);
+				return;
+			}
+			entry.wdlFile.reset();
+		}
+
+		if (!entry.generatedPath.empty()) {
+			std::string name = std::filesystem::path(entry.generatedPath).stem().string();
+			auto table = std::make_unique<GeneratedTable>(name);
+			entry.generatedFile = std::make_unique<MappedFile>(entry.generatedPath, MappedFile::READONLY);
+
+			const MappedFile& generatedFile = *entry.generatedFile;
+			if (generatedFile.size() == sizeof(GeneratedTable::Header) + table->getSize()
+				&& GeneratedTable::isValid(*reinterpret_cast<const GeneratedTable::Header*>(generatedFile.data()),
+										   name)) {
+				table->setValues(generatedFile.data() + sizeof(GeneratedTable::Header));
+				entry.table = std::move(table);
+			} else {
+				entry.generatedFile.reset();
+			}
+		}
+	} catch (std::exception&) {
+		entry.wdlFile.reset();
+		entry.dtzFile.reset();
+		entry.generatedFile.reset();
+		entry.table.reset();
+	}
+}
+}
@@ -0,0 +1,109 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "position.h"
+#include "movelist.h"
+#include "movegenerator.h"
+#include "mappedfile.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace pulse {
+
+/**
+ * This class finds endgame tablebases on disk and answers probes from the
+ * search. A table is opened and mapped into memory on its first probe.
+ * Probes are thread-safe.
+ */
+class Tablebases final {
+public:
+	// Results from the side to move's point of view. A cursed win or a
+	// blessed loss is drawn by the fifty move rule.
+	static const int LOSS = -2;
+	static const int BLESSEDLOSS = -1;
+	static const int DRAW = 0;
+	static const int CURSEDWIN = 1;
+	static const int WIN = 2;
+
+	// Probe states. A table may store only the other side to move. A
+	// capture or pawn move may be the best move.
+	static const int NOTFOUND = 0;
+	static const int FOUND = 1;
+	static const int OTHERSIDE = 2;
+	static const int ZEROING = 3;
+
+	/**
+	 * Every table format we can decode implements this. If flipped is
+	 * true, the colors of the position are swapped with respect to the
+	 * table.
+	 */
+	class Table {
+	public:
+		virtual ~Table() = default;
+
+		virtual bool probeWdl(const Position& position, bool flipped, int& wdl) const = 0;
+
+		// Plies to the next capture, pawn move or mate of a position with
+		// result wdl. Returns the probe state.
+		virtual int probeDtz(const Position& position, bool flipped, int wdl, int& dtz) const = 0;
+
+		// Returns true if every position stores its exact result. Otherwise
+		// a position where a capture is best may store a worse result.
+		virtual bool isExact() const = 0;
+	};
+
+	void setPath(const std::string& path);
+
+	uint64_t getTableCount() const;
+
+	int getMaxPieces() const;
+
+	bool probeWdl(Position& position, int& wdl);
+
+	bool probeDtz(Position& position, int& dtz);
+
+	bool filterRootMoves(Position& position, MoveList<RootEntry>& rootMoves, MoveGenerator& moveGenerator);
+
+	static int getPieceCount(const Position& position);
+
+	static uint32_t getMaterialKey(const Position& position, int color);
+
+	static uint32_t getMaterialKey(const std::string& name);
+
+private:
+	class Entry final {
+	public:
+		std::string wdlPath;
+		std::string dtzPath;
+		std::string generatedPath;
+		std::once_flag opened;
+		std::unique_ptr<MappedFile> wdlFile;
+		std::unique_ptr<MappedFile> dtzFile;
+		std::unique_ptr<MappedFile> generatedFile;
+		std::unique_ptr<Table> table;
+	};
+
+	std::unordered_map<uint32_t, std::unique_ptr<Entry>> entries;
+	int maxPieces = 0;
+
+	const Table* find(const Position& position, bool& flipped);
+
+	int search(Position& position, bool isZeroing, int ply, int& wdl);
+
+	bool probeDtz(Position& position, int ply, int& dtz);
+
+	static MoveGenerator& getMoveGenerator(int ply);
+
+	static bool isZeroing(int move);
+
+	static int getZeroingDtz(int wdl);
+
+	static void open(Entry& entry);
+};
+}
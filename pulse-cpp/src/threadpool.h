@@ -12,8 +12,10 @@ namespace pulse {
 
 class ThreadPool final {
 public:
-	ThreadPool() : running(true) {
-		threads.emplace_back(&ThreadPool::worker, this);
+	explicit ThreadPool(int threadCount = 1) : running(true) {
+		for (int i = 0; i < threadCount; i++) {
+			threads.emplace_back(&ThreadPool::worker, this);
+		}
 	};
 
 	~ThreadPool() {
@@ -0,0 +1,189 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace pulse {
+
+namespace {
+
+class Event final {
+public:
+	char phase;
+	const char* category;
+	std::string name;
+	int64_t start;
+	int64_t duration;
+};
+
+class Buffer final {
+public:
+	int thread = 0;
+	std::string name;
+	std::vector<Event> events;
+};
+
+// The name is kept apart from the buffer, because most threads name
+// themselves long before anyone opens a trace.
+thread_local std::string threadName;
+thread_local std::shared_ptr<Buffer> threadBuffer;
+
+/**
+ * A thread gets a buffer when it first records something. All buffers stay
+ * alive until we write them, even if their thread has exited in the
+ * meantime.
+ */
+class Recorder final {
+public:
+	std::atomic<bool> enabled{false};
+	std::mutex mutex;
+	std::string path;
+	std::chrono::steady_clock::time_point startTime;
+	std::vector<std::shared_ptr<Buffer>> buffers;
+	int threads = 0;
+
+	static Recorder& instance() {
+		static Recorder recorder;
+		return recorder;
+	}
+
+	Buffer& local() {
+		if (!threadBuffer) {
+			threadBuffer = std::make_shared<Buffer>();
+			threadBuffer->name = threadName;
+			std::unique_lock<std::mutex> lock(mutex);
+			threadBuffer->thread = ++threads;
+			buffers.push_back(threadBuffer);
+		}
+		return *threadBuffer;
+	}
+};
+
+std::string escape(const std::string& text) {
+	std::string escaped;
+	for (auto c: text) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	return escaped;
+}
+}
+
+Trace::Span::Span(const char* category, const std::string& name)
+		: enabled(isOpen()), category(category) {
+	if (enabled) {
+		this->name = name;
+		start = now();
+	}
+}
+
+Trace::Span::~Span() {
+	if (enabled && isOpen()) {
+		int64_t end = now();
+		Recorder::instance().local().events.push_back({'X', category, name, start, end - start});
+	}
+}
+
+/**
+ * Starts recording into a new trace. The file is written when we close it.
+ */
+void Trace::open(const std::string& path) {
+	close();
+
+	Recorder& recorder = Recorder::instance();
+	std::unique_lock<std::mutex> lock(recorder.mutex);
+	recorder.path = path;
+	recorder.startTime = std::chrono::steady_clock::now();
+	for (auto& buffer: recorder.buffers) {
+		buffer->events.clear();
+	}
+	recorder.enabled = true;
+}
+
+/**
+ * Stops recording and writes the trace. Must not be called while other
+ * threads are recording.
+ */
+void Trace::close() {
+	Recorder& recorder = Recorder::instance();
+	if (!recorder.enabled) {
+		return;
+	}
+	recorder.enabled = false;
+
+	std::unique_lock<std::mutex> lock(recorder.mutex);
+	std::ofstream file(recorder.path);
+	if (!file) {
+		throw std::runtime_error("Cannot write trace " + recorder.path);
+	}
+
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	for (auto& buffer: recorder.buffers) {
+		if (!buffer->name.empty()) {
+			file << (first ? "\n" : ",\n");
+			file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread
+				 << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+			first = false;
+		}
+
+		for (auto& event: buffer->events) {
+			file << (first ? "\n" : ",\n");
+			file << "{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << event.category
+				 << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << event.start;
+			if (event.phase == 'X') {
+				file << ",\"dur\":" << event.duration;
+			} else {
+				file << ",\"s\":\"t\"";
+			}
+			file << ",\"pid\":1,\"tid\":" << buffer->thread << "}";
+			first = false;
+		}
+		buffer->events.clear();
+	}
+	file << "\n]}\n";
+
+	// Forget the buffers of threads which have exited
+	recorder.buffers.erase(
+			std::remove_if(recorder.buffers.begin(), recorder.buffers.end(),
+						   [](const std::shared_ptr<Buffer>& buffer) { return buffer.use_count() == 1; }),
+			recorder.buffers.end());
+}
+
+bool Trace::isOpen() {
+	return Recorder::instance().enabled.load(std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const std::string& name) {
+	threadName = name;
+	if (threadBuffer) {
+		threadBuffer->name = name;
+	}
+}
+
+void Trace::instant(const char* category, const std::string& name) {
+	if (isOpen()) {
+		Recorder::instance().local().events.push_back({'i', category, name, now(), 0});
+	}
+}
+
+/**
+ * Returns the microseconds since we opened the trace.
+ */
+int64_t Trace::now() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - Recorder::instance().startTime).count();
+}
+}
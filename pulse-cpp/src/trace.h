@@ -0,0 +1,56 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace pulse {
+
+/**
+ * This class records what our threads are doing and writes it in the Chrome
+ * trace event format, so it can be viewed in chrome://tracing or Perfetto.
+ * Every thread records into its own buffer, so recording takes no locks.
+ * While the recorder is closed, spans cost only a flag check. Names built
+ * at runtime should only be built if isOpen(), because the argument is
+ * evaluated either way.
+ */
+class Trace final {
+public:
+	/**
+	 * Records the lifetime of this object as a complete event.
+	 */
+	class Span final {
+	public:
+		Span(const char* category, const std::string& name);
+
+		~Span();
+
+		Span(const Span&) = delete;
+
+		Span& operator=(const Span&) = delete;
+
+	private:
+		bool enabled;
+		const char* category;
+		std::string name;
+		int64_t start;
+	};
+
+	static void open(const std::string& path);
+
+	static void close();
+
+	static bool isOpen();
+
+	static void setThreadName(const std::string& name);
+
+	static void instant(const char* category, const std::string& name);
+
+private:
+	static int64_t now();
+};
+}
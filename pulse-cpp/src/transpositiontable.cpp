@@ -0,0 +1,173 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "transpositiontable.h"
+#include "model/move.h"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace pulse {
+
+TranspositionTable::TranspositionTable(uint64_t sizeInMB) {
+	if (sizeInMB < 1) throw std::invalid_argument("Illegal hash size");
+
+	// Use the largest power of two, so we can mask the zobrist key
+	bucketCount = 1;
+	while (bucketCount * 2 * sizeof(Bucket) <= sizeInMB * 1024 * 1024) {
+		bucketCount *= 2;
+	}
+
+	// The memory is zeroed, which makes all entries empty
+	memory = std::make_unique<LargePageMemory>(bucketCount * sizeof(Bucket));
+	buckets = reinterpret_cast<Bucket*>(memory->data());
+}
+
+/**
+ * Maps a table saved with save(). In read-only mode nothing will be stored.
+ * In copy-on-write mode stores stay private to this process.
+ */
+TranspositionTable::TranspositionTable(const std::string& path, int mode) {
+	if (mode != MappedFile::READONLY && mode != MappedFile::COPYONWRITE) {
+		throw std::invalid_argument("Illegal mode");
+	}
+
+	file = std::make_unique<MappedFile>(path, mode);
+
+	auto header = reinterpret_cast<const Header*>(file->data());
+	if (file->size() < sizeof(Header)
+		|| header->magic != MAGIC
+		|| header->version != VERSION
+		|| header->entrySize != sizeof(Entry)
+		|| header->bucketCount == 0
+		|| (header->bucketCount & (header->bucketCount - 1)) != 0
+		|| file->size() != sizeof(Header) + header->bucketCount * sizeof(Bucket)) {
+		file.reset();
+		throw std::runtime_error("Not a hash file: " + path);
+	}
+
+	buckets = reinterpret_cast<Bucket*>(file->data() + sizeof(Header));
+	bucketCount = header->bucketCount;
+	generation = header->generation;
+	readOnly = mode == MappedFile::READONLY;
+}
+
+void TranspositionTable::clear() {
+	if (file != nullptr) {
+		// A mapped table is what we want to keep
+		return;
+	}
+
+	for (uint64_t i = 0; i < bucketCount; i++) {
+		buckets[i] = Bucket();
+	}
+	generation = 1;
+}
+
+void TranspositionTable::newSearch() {
+	// Generation 0 is reserved for empty entries
+	generation = generation == UINT8_MAX ? 1 : generation + 1;
+}
+
+bool TranspositionTable::probe(uint64_t zobristKey, Entry& entry) const {
+	auto key = static_cast<uint32_t>(zobristKey >> 32);
+
+	for (auto& candidate: bucketOf(zobristKey).entries) {
+		if (candidate.depth > 0 && candidate.key == key) {
+			entry = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Stores the search result. We replace the entry of the same position or
+ * the shallowest entry, preferring entries from older searches.
+ */
+void TranspositionTable::store(uint64_t zobristKey, int move, int value, int depth, int bound) {
+	if (readOnly) {
+		return;
+	}
+
+	auto key = static_cast<uint32_t>(zobristKey >> 32);
+
+	Bucket& bucket = bucketOf(zobristKey);
+	Entry* replace = &bucket.entries[0];
+	for (auto& candidate: bucket.entries) {
+		if (candidate.depth > 0 && candidate.key == key) {
+			replace = &candidate;
+
+			// Keep the old move if we don't have a new one
+			if (move == move::NOMOVE) {
+				move = candidate.move;
+			}
+			break;
+		}
+
+		if ((candidate.generation == generation) * 256 + candidate.depth
+			< (replace->generation == generation) * 256 + replace->depth) {
+			replace = &candidate;
+		}
+	}
+
+	replace->key = key;
+	replace->move = move;
+	replace->value = value;
+	replace->depth = static_cast<uint8_t>(depth);
+	replace->bound = static_cast<uint8_t>(bound);
+	replace->generation = generation;
+}
+
+/**
+ * Writes the table to a file, which can be mapped later. We write to a
+ * temporary file first, because path might be the file we are mapping.
+ */
+void TranspositionTable::save(const std::string& path) const {
+	Header header{};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.entrySize = sizeof(Entry);
+	header.bucketCount = bucketCount;
+	header.generation = generation;
+
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		output.write(reinterpret_cast<const char*>(buckets),
+				static_cast<std::streamsize>(bucketCount * sizeof(Bucket)));
+		if (!output) {
+			throw std::runtime_error("Cannot write " + temporaryPath);
+		}
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		throw std::runtime_error("Cannot replace " + path);
+	}
+}
+
+uint64_t TranspositionTable::getCapacity() const {
+	return bucketCount * BUCKET_SIZE;
+}
+
+bool TranspositionTable::isMapped() const {
+	return file != nullptr;
+}
+
+/**
+ * Returns the kind of pages backing an allocated table.
+ */
+int TranspositionTable::getMemoryKind() const {
+	return memory != nullptr ? memory->getKind() : +LargePageMemory::NORMAL;
+}
+
+TranspositionTable::Bucket& TranspositionTable::bucketOf(uint64_t zobristKey) const {
+	return buckets[zobristKey & (bucketCount - 1)];
+}
+}
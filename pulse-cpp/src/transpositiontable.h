@@ -0,0 +1,97 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include "mappedfile.h"
+#include "largepagememory.h"
+
+#include <array>
+#include <memory>
+#include <type_traits>
+
+namespace pulse {
+
+/**
+ * This class implements our transposition table. Entries are grouped into
+ * buckets of one cache line each. The table is either allocated in memory
+ * or mapped from a file saved by an earlier session.
+ */
+class TranspositionTable final {
+public:
+	static const int NOBOUND = 0;
+	static const int LOWER = 1;
+	static const int UPPER = 2;
+	static const int EXACT = LOWER | UPPER;
+
+	/**
+	 * An entry of depth 0 is empty. Entries have no initializers, so
+	 * zeroed memory is a table of empty entries.
+	 */
+	class Entry final {
+	public:
+		uint32_t key;
+		int32_t move;
+		int32_t value;
+		uint8_t depth;
+		uint8_t bound;
+		uint8_t generation;
+		uint8_t reserved;
+	};
+
+	explicit TranspositionTable(uint64_t sizeInMB);
+
+	TranspositionTable(const std::string& path, int mode);
+
+	void clear();
+
+	void newSearch();
+
+	bool probe(uint64_t zobristKey, Entry& entry) const;
+
+	void store(uint64_t zobristKey, int move, int value, int depth, int bound);
+
+	void save(const std::string& path) const;
+
+	uint64_t getCapacity() const;
+
+	bool isMapped() const;
+
+	int getMemoryKind() const;
+
+private:
+	static const int BUCKET_SIZE = 4;
+
+	class Header final {
+	public:
+		uint64_t magic;
+		uint32_t version;
+		uint32_t entrySize;
+		uint64_t bucketCount;
+		uint8_t generation;
+		uint8_t reserved[39];
+	};
+
+	class alignas(64) Bucket final {
+	public:
+		std::array<Entry, BUCKET_SIZE> entries;
+	};
+
+	static_assert(sizeof(Header) == 64, "Unexpected header layout");
+	static_assert(sizeof(Bucket) == 64, "Unexpected bucket layout");
+	static_assert(std::is_trivially_default_constructible<Bucket>::value, "Buckets must live in raw memory");
+
+	static const uint64_t MAGIC = 0x31545445534c5550ULL; // "PULSETT1"
+	static const uint32_t VERSION = 1;
+
+	std::unique_ptr<LargePageMemory> memory;
+	std::unique_ptr<MappedFile> file;
+	Bucket* buckets = nullptr;
+	uint64_t bucketCount = 0;
+	uint8_t generation = 1;
+	bool readOnly = false;
+
+	Bucket& bucketOf(uint64_t zobristKey) const;
+};
+}
@@ -0,0 +1,74 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "allocationtracker.h"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <thread>
+
+using namespace pulse;
+
+namespace {
+// Keeps the compiler from leaving out our allocations
+char* volatile sink;
+}
+
+TEST(allocationtrackertest, testScope) {
+	allocation::Statistics before = allocation::get(allocation::NOTATION);
+	uint64_t peakBytes;
+	{
+		allocation::Scope scope(allocation::NOTATION);
+		auto data = std::make_unique<char[]>(1000);
+		peakBytes = allocation::get(allocation::NOTATION).peakBytes;
+	}
+	allocation::Statistics after = allocation::get(allocation::NOTATION);
+
+	if (allocation::isEnabled()) {
+		EXPECT_EQ(before.allocations + 1, after.allocations);
+		EXPECT_EQ(before.deallocations + 1, after.deallocations);
+		EXPECT_EQ(before.bytes, after.bytes);
+		EXPECT_EQ(before.totalBytes + 1000, after.totalBytes);
+		EXPECT_GE(peakBytes, before.bytes + 1000);
+	} else {
+		EXPECT_EQ(0u, after.allocations);
+		EXPECT_EQ(0u, after.totalBytes);
+	}
+}
+
+TEST(allocationtrackertest, testToString) {
+	EXPECT_EQ("search", allocation::toString(allocation::SEARCH));
+	EXPECT_EQ("protocol", allocation::toString(allocation::PROTOCOL));
+}
+
+TEST(allocationtrackertest, testThreadAllocations) {
+	// Another thread doesn't count towards ours
+	uint64_t threadAllocations;
+	std::thread thread([&threadAllocations] {
+		uint64_t before = allocation::getThreadAllocations();
+		auto data = std::make_unique<char[]>(1000);
+		sink = data.get();
+		threadAllocations = allocation::getThreadAllocations() - before;
+	});
+	thread.join();
+
+	uint64_t before = allocation::getThreadAllocations();
+	{
+		allocation::Scope scope(allocation::PROTOCOL);
+		auto data = std::make_unique<char[]>(1000);
+		sink = data.get();
+	}
+	uint64_t after = allocation::getThreadAllocations();
+
+	// Our allocations count whatever their subsystem
+	if (allocation::isEnabled()) {
+		EXPECT_EQ(1u, threadAllocations);
+		EXPECT_EQ(before + 1, after);
+	} else {
+		EXPECT_EQ(0u, threadAllocations);
+		EXPECT_EQ(0u, after);
+	}
+}
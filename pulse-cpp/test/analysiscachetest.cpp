@@ -0,0 +1,116 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "analysiscache.h"
+#include "movegenerator.h"
+#include "notation.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace pulse;
+
+namespace {
+const std::string path = "analysiscachetest.bin";
+
+RootEntry entryOf(Position& position, int value) {
+	MoveGenerator moveGenerator;
+	MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+
+	RootEntry entry;
+	entry.move = moves.entries[0]->move;
+	entry.value = value;
+	entry.pv.moves[0] = moves.entries[0]->move;
+	entry.pv.moves[1] = move::NOMOVE;
+	entry.pv.size = 1;
+	return entry;
+}
+}
+
+TEST(analysiscachetest, testPutAndGet) {
+	std::remove(path.c_str());
+	{
+		AnalysisCache cache(path, 1);
+		Position position(notation::toPosition(notation::STANDARDPOSITION));
+		RootEntry entry = entryOf(position, 42);
+
+		int depth = 0;
+		RootEntry result;
+		EXPECT_FALSE(cache.get(position, depth, result));
+
+		cache.put(position, 5, entry);
+		EXPECT_TRUE(cache.get(position, depth, result));
+		EXPECT_EQ(5, depth);
+		EXPECT_EQ(42, result.value);
+		EXPECT_EQ(entry.move, result.move);
+		EXPECT_EQ(1, result.pv.size);
+
+		// A shallower analysis does not replace a deeper one
+		cache.put(position, 3, entryOf(position, 7));
+		EXPECT_TRUE(cache.get(position, depth, result));
+		EXPECT_EQ(5, depth);
+		EXPECT_EQ(42, result.value);
+
+		// The same board with different castling rights is another position
+		Position other(notation::toPosition("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQ - 0 1"));
+		EXPECT_FALSE(cache.get(other, depth, result));
+	}
+	std::remove(path.c_str());
+}
+
+TEST(analysiscachetest, testPersistence) {
+	std::remove(path.c_str());
+	Position position(notation::toPosition("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+	RootEntry entry = entryOf(position, -13);
+	{
+		AnalysisCache cache(path, 1);
+		cache.put(position, 9, entry);
+	}
+	{
+		// Reopening with another size rebuilds the file and keeps the analysis
+		AnalysisCache cache(path, 2);
+		EXPECT_GT(cache.getCapacity(), 8000u);
+
+		int depth = 0;
+		RootEntry result;
+		EXPECT_TRUE(cache.get(position, depth, result));
+		EXPECT_EQ(9, depth);
+		EXPECT_EQ(-13, result.value);
+		EXPECT_EQ(entry.move, result.move);
+	}
+	std::remove(path.c_str());
+}
+
+TEST(analysiscachetest, testTornRecord) {
+	std::remove(path.c_str());
+	Position position(notation::toPosition(notation::STANDARDPOSITION));
+	{
+		AnalysisCache cache(path, 1);
+		cache.put(position, 5, entryOf(position, 42));
+	}
+	{
+		// Change the best move of every record behind the header, as if
+		// another process was writing it
+		std::ifstream input(path, std::ios::binary);
+		std::vector<char> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+		input.close();
+		for (size_t offset = 64 + 48; offset < data.size(); offset += 128) {
+			data[offset] ^= 1;
+		}
+		std::ofstream output(path, std::ios::binary);
+		output.write(data.data(), data.size());
+	}
+	{
+		AnalysisCache cache(path, 1);
+		int depth = 0;
+		RootEntry result;
+		EXPECT_FALSE(cache.get(position, depth, result));
+	}
+	std::remove(path.c_str());
+}
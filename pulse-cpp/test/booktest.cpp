@@ -0,0 +1,114 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "book.h"
+#include "notation.h"
+#include "model/move.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace pulse;
+
+namespace {
+const std::string path = "booktest.bin";
+
+const std::string CASTLING = "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1";
+
+class BookEntry final {
+public:
+	uint64_t key;
+	int move;
+	int weight;
+};
+
+/**
+ * Encodes a move in coordinate notation like Polyglot does.
+ */
+int toPolyglotMove(const std::string& move) {
+	return (move[1] - '1') << 9 | (move[0] - 'a') << 6 | (move[3] - '1') << 3 | (move[2] - 'a');
+}
+
+void writeBook(std::vector<BookEntry> entries) {
+	std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	for (auto& entry: entries) {
+		uint64_t values[] = {entry.key, static_cast<uint64_t>(entry.move), static_cast<uint64_t>(entry.weight), 0};
+		int lengths[] = {8, 2, 2, 4};
+		for (int i = 0; i < 4; i++) {
+			for (int shift = (lengths[i] - 1) * 8; shift >= 0; shift -= 8) {
+				file.put(static_cast<char>((values[i] >> shift) & 0xFF));
+			}
+		}
+	}
+}
+}
+
+TEST(booktest, testGetKey) {
+	// The test positions of the Polyglot book format
+	const std::vector<std::pair<std::string, uint64_t>> keys = {
+			{notation::STANDARDPOSITION, 0x463b96181691fc9c},
+			{"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196},
+			{"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0},
+			{"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4},
+			{"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78},
+			{"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1},
+			{"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9},
+			{"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637},
+			{"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560}
+	};
+
+	for (auto& [fen, key]: keys) {
+		EXPECT_EQ(key, Book::getKey(notation::toPosition(fen))) << fen;
+	}
+}
+
+TEST(booktest, testGetEntries) {
+	uint64_t startKey = Book::getKey(notation::toPosition(notation::STANDARDPOSITION));
+	uint64_t castlingKey = Book::getKey(notation::toPosition(CASTLING));
+	writeBook({
+			{startKey, toPolyglotMove("e2e4"), 3},
+			{startKey, toPolyglotMove("d2d4"), 1},
+			{startKey, toPolyglotMove("e2e5"), 5},
+			{castlingKey, toPolyglotMove("e1h1"), 1},
+			{castlingKey, toPolyglotMove("e1a1"), 1},
+			{castlingKey + 1, toPolyglotMove("a1a2"), 1}
+	});
+
+	{
+		Book book(path);
+		EXPECT_EQ(6u, book.size());
+
+		// The illegal move is skipped
+		Position position = notation::toPosition(notation::STANDARDPOSITION);
+		std::vector<Book::Entry> entries = book.getEntries(position);
+		ASSERT_EQ(2u, entries.size());
+		EXPECT_EQ("e4", notation::fromMove(position, entries[0].move));
+		EXPECT_EQ(3, entries[0].weight);
+		EXPECT_EQ("d4", notation::fromMove(position, entries[1].move));
+
+		for (int i = 0; i < 10; i++) {
+			int bookMove = book.probe(position);
+			EXPECT_TRUE(bookMove == entries[0].move || bookMove == entries[1].move);
+		}
+
+		// Castling is encoded as the king capturing its rook
+		position = notation::toPosition(CASTLING);
+		entries = book.getEntries(position);
+		ASSERT_EQ(2u, entries.size());
+		EXPECT_EQ("O-O", notation::fromMove(position, entries[0].move));
+		EXPECT_EQ("O-O-O", notation::fromMove(position, entries[1].move));
+
+		position = notation::toPosition("4k3/8/8/8/8/8/8/4K3 w - - 0 1");
+		EXPECT_TRUE(book.getEntries(position).empty());
+		EXPECT_EQ(+move::NOMOVE, book.probe(position));
+	}
+
+	std::remove(path.c_str());
+}
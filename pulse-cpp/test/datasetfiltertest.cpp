@@ -0,0 +1,140 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "datasetfilter.h"
+#include "notation.h"
+#include "model/move.h"
+#include "model/movetype.h"
+#include "model/piece.h"
+#include "model/piecetype.h"
+#include "model/square.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace pulse;
+
+namespace {
+const std::string inputPath = "datasetfiltertest.bin";
+const std::string outputPath = "datasetfiltertest.out.bin";
+
+// Black to move is in check
+const std::string CHECK = "rnbqkbnr/ppppp1pp/8/5p1Q/4P3/8/PPPP1PPP/RNB1KBNR b KQkq - 1 2";
+
+// White to move can capture on d5
+const std::string CAPTURE = "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2";
+
+PackedPosition pack(const std::string& fen, int score, int move) {
+	PackedPosition packedPosition = PackedPosition::pack(notation::toPosition(fen));
+	packedPosition.score = score;
+	packedPosition.move = move;
+	packedPosition.result = PackedPosition::DRAW;
+	return packedPosition;
+}
+
+std::vector<PackedPosition> filter(const DatasetFilter::Criteria& criteria, uint64_t memory) {
+	{
+		PackedPositionWriter writer(inputPath);
+		writer.write(pack(notation::STANDARDPOSITION, 10, move::NOMOVE));
+		writer.write(pack(CHECK, -50, move::NOMOVE));
+		writer.write(pack(notation::STANDARDPOSITION, 20, move::NOMOVE));
+		writer.write(pack(CAPTURE, 500, move::valueOf(
+				movetype::NORMAL, square::e4, square::d5, piece::WHITE_PAWN, piece::BLACK_PAWN,
+				piecetype::NOPIECETYPE)));
+		writer.write(pack(CHECK, -60, move::NOMOVE));
+		writer.close();
+	}
+
+	DatasetFilter datasetFilter;
+	datasetFilter.run(inputPath, outputPath, criteria, memory, 2);
+
+	std::vector<PackedPosition> packedPositions;
+	{
+		PackedPositionReader reader(outputPath);
+		for (uint64_t i = 0; i < reader.size(); i++) {
+			packedPositions.push_back(reader[i]);
+		}
+	}
+	std::remove(inputPath.c_str());
+	std::remove(outputPath.c_str());
+	return packedPositions;
+}
+}
+
+TEST(datasetfiltertest, testDeduplication) {
+	std::vector<PackedPosition> packedPositions = filter(DatasetFilter::Criteria(), DatasetFilter::DEFAULT_MEMORY);
+
+	// The first occurrence stays, in the order of the file
+	ASSERT_EQ(3u, packedPositions.size());
+	EXPECT_EQ(10, packedPositions[0].score);
+	EXPECT_EQ(-50, packedPositions[1].score);
+	EXPECT_EQ(500, packedPositions[2].score);
+}
+
+TEST(datasetfiltertest, testShards) {
+	// Room for a single entry forces one shard per position
+	std::vector<PackedPosition> packedPositions = filter(DatasetFilter::Criteria(), 32);
+	std::vector<PackedPosition> expected = filter(DatasetFilter::Criteria(), DatasetFilter::DEFAULT_MEMORY);
+	EXPECT_TRUE(expected == packedPositions);
+}
+
+TEST(datasetfiltertest, testCriteria) {
+	DatasetFilter::Criteria criteria;
+	criteria.skipCheck = true;
+	std::vector<PackedPosition> packedPositions = filter(criteria, DatasetFilter::DEFAULT_MEMORY);
+	ASSERT_EQ(2u, packedPositions.size());
+	EXPECT_EQ(10, packedPositions[0].score);
+	EXPECT_EQ(500, packedPositions[1].score);
+
+	criteria = DatasetFilter::Criteria();
+	criteria.skipCapture = true;
+	packedPositions = filter(criteria, DatasetFilter::DEFAULT_MEMORY);
+	ASSERT_EQ(2u, packedPositions.size());
+	EXPECT_EQ(-50, packedPositions[1].score);
+
+	criteria = DatasetFilter::Criteria();
+	criteria.maxScore = 100;
+	packedPositions = filter(criteria, DatasetFilter::DEFAULT_MEMORY);
+	ASSERT_EQ(2u, packedPositions.size());
+	EXPECT_EQ(-50, packedPositions[1].score);
+
+	// The start position has ply 0, the others ply 2 and 3
+	criteria = DatasetFilter::Criteria();
+	criteria.minPly = 1;
+	criteria.maxPly = 2;
+	packedPositions = filter(criteria, DatasetFilter::DEFAULT_MEMORY);
+	ASSERT_EQ(1u, packedPositions.size());
+	EXPECT_EQ(500, packedPositions[0].score);
+}
+
+TEST(datasetfiltertest, testCommonPositions) {
+	// Three chunks full of two positions
+	uint64_t size = 3 * (1 << 16);
+	{
+		PackedPositionWriter writer(inputPath);
+		for (uint64_t i = 0; i < size; i++) {
+			writer.write(pack(i % 2 == 0 ? notation::STANDARDPOSITION : CHECK, static_cast<int>(i), move::NOMOVE));
+		}
+		writer.close();
+	}
+
+	// The memory limit makes us expect four shards of a quarter of the
+	// positions, but the duplicates within a chunk never reach the shard.
+	DatasetFilter datasetFilter;
+	DatasetFilter::Result result = datasetFilter.run(
+			inputPath, outputPath, DatasetFilter::Criteria(), size * 8, 2);
+	EXPECT_EQ(4, result.shards);
+	EXPECT_EQ(size - 2, result.duplicates);
+	// At most one entry per position and chunk
+	EXPECT_LE(result.shardEntries, 6u);
+
+	PackedPositionReader reader(outputPath);
+	ASSERT_EQ(2u, reader.size());
+	EXPECT_EQ(0, reader[0].score);
+	EXPECT_EQ(1, reader[1].score);
+	std::remove(inputPath.c_str());
+	std::remove(outputPath.c_str());
+}
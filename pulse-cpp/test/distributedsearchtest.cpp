@@ -0,0 +1,144 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "distributedsearch.h"
+#include "movegenerator.h"
+#include "notation.h"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <dirent.h>
+#include <fstream>
+#include <mutex>
+#include <signal.h>
+#include <sstream>
+#include <unistd.h>
+
+using namespace pulse;
+
+namespace {
+class TestProtocol final : public Protocol {
+public:
+	std::mutex mutex;
+	std::condition_variable condition;
+	int bestMove = move::NOMOVE;
+	int bestMoves = 0;
+	int moves = 0;
+	int value = value::NOVALUE;
+	std::vector<std::string> infos;
+
+	void sendBestMove(int _bestMove, int ponderMove) override {
+		std::unique_lock<std::mutex> lock(mutex);
+		bestMove = _bestMove;
+		bestMoves++;
+		condition.notify_all();
+	}
+
+	void sendStatus(int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+					int currentMoveNumber) override {
+	}
+
+	void sendStatus(bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+					int currentMoveNumber) override {
+	}
+
+	void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override {
+		std::unique_lock<std::mutex> lock(mutex);
+		moves++;
+		value = entry.value;
+		condition.notify_all();
+	}
+
+	void sendInfo(const std::string& message) override {
+		std::unique_lock<std::mutex> lock(mutex);
+		infos.push_back(message);
+		condition.notify_all();
+	}
+
+	void sendDebug(const std::string& message) override {
+	}
+};
+
+/**
+ * Returns the processes we have started.
+ */
+std::vector<pid_t> getChildren() {
+	std::vector<pid_t> children;
+	DIR* directory = opendir("/proc");
+	for (dirent* entry = readdir(directory); entry != nullptr; entry = readdir(directory)) {
+		std::ifstream file(std::string("/proc/") + entry->d_name + "/stat");
+		std::string stat;
+		if (!std::getline(file, stat) || stat.rfind(')') == std::string::npos) {
+			continue;
+		}
+
+		// The parent comes after the name and the state
+		std::istringstream input(stat.substr(stat.rfind(')') + 1));
+		std::string state;
+		pid_t parent;
+		if (input >> state >> parent && parent == getpid()) {
+			children.push_back(std::stoi(entry->d_name));
+		}
+	}
+	closedir(directory);
+	return children;
+}
+
+bool isCheckmate(Position position, int move) {
+	position.makeMove(move);
+	MoveGenerator moveGenerator;
+	return position.isCheck() && moveGenerator.getLegalMoves(position, 1, true).size == 0;
+}
+}
+
+TEST(distributedsearchtest, testMate) {
+	TestProtocol protocol;
+	DistributedSearch distributedSearch(protocol, 2, PULSE_EXECUTABLE);
+
+	// The mating moves are dealt to either worker
+	Position position = notation::toPosition("k7/8/1K6/8/8/8/8/6Q1 w - - 0 1");
+	distributedSearch.start(position, "depth 4", {});
+
+	std::unique_lock<std::mutex> lock(protocol.mutex);
+	ASSERT_TRUE(protocol.condition.wait_for(lock, std::chrono::seconds(30), [&] { return protocol.bestMoves > 0; }));
+	EXPECT_TRUE(isCheckmate(position, protocol.bestMove));
+	EXPECT_EQ(value::CHECKMATE - 1, protocol.value);
+}
+
+TEST(distributedsearchtest, testDeadWorker) {
+	TestProtocol protocol;
+	DistributedSearch distributedSearch(protocol, 2, PULSE_EXECUTABLE);
+
+	Position position = notation::toPosition(notation::STANDARDPOSITION);
+	distributedSearch.start(position, "infinite", {});
+	{
+		std::unique_lock<std::mutex> lock(protocol.mutex);
+		ASSERT_TRUE(protocol.condition.wait_for(lock, std::chrono::seconds(30), [&] { return protocol.moves > 0; }));
+	}
+
+	std::vector<pid_t> children = getChildren();
+	ASSERT_EQ(2u, children.size());
+	kill(children[0], SIGKILL);
+	{
+		std::unique_lock<std::mutex> lock(protocol.mutex);
+		ASSERT_TRUE(protocol.condition.wait_for(lock, std::chrono::seconds(30), [&] { return !protocol.infos.empty(); }));
+		EXPECT_NE(std::string::npos, protocol.infos[0].find("died"));
+		EXPECT_EQ(0, protocol.bestMoves);
+	}
+
+	// The other worker still answers
+	distributedSearch.stop();
+	std::unique_lock<std::mutex> lock(protocol.mutex);
+	EXPECT_EQ(1, protocol.bestMoves);
+	MoveGenerator moveGenerator;
+	MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, false);
+	bool isLegal = false;
+	for (int i = 0; i < moves.size; i++) {
+		isLegal = isLegal || moves.entries[i]->move == protocol.bestMove;
+	}
+	EXPECT_TRUE(isLegal);
+}
@@ -0,0 +1,135 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "gamedatabase.h"
+#include "notation.h"
+#include "model/move.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace pulse;
+
+namespace {
+const std::string pgnPath = "gamedatabasetest.pgn";
+const std::string databasePath = "gamedatabasetest.gdb";
+
+void writePgn() {
+	std::ofstream file(pgnPath, std::ios::binary | std::ios::trunc);
+	file << "[Event \"First\"]\n\n1. e4 e5 2. Nf3 Nc6 1-0\n\n"
+		 << "[Event \"Second\"]\n\n1. e4 c5 0-1\n\n"
+		 << "[Event \"Third\"]\n\n1. d4 d5 1/2-1/2\n\n"
+		 << "[Event \"Fourth\"]\n[FEN \"4k3/P7/8/8/8/8/8/4K3 w - - 0 1\"]\n\n1. a8=Q+ Kd7 1-0\n\n"
+		 << "[Event \"Fifth\"]\n\n1. Nf3 Nc6 2. e4 e5 3. Bb5 1/2-1/2\n";
+}
+
+std::string readFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	std::ostringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+}
+
+TEST(gamedatabasetest, testBuild) {
+	writePgn();
+
+	GameDatabase::Result result = GameDatabase::build(pgnPath, databasePath, 1);
+	EXPECT_EQ(5u, result.games);
+	EXPECT_EQ(20u, result.positions);
+	EXPECT_EQ(0u, result.errors);
+	std::string content = readFile(databasePath);
+
+	// The file does not depend on the number of threads
+	GameDatabase::build(pgnPath, databasePath, 3);
+	EXPECT_EQ(content, readFile(databasePath));
+
+	GameDatabase gameDatabase(databasePath);
+	EXPECT_EQ(5u, gameDatabase.getGameCount());
+	EXPECT_EQ(20u, gameDatabase.size());
+
+	std::remove(pgnPath.c_str());
+	std::remove(databasePath.c_str());
+}
+
+TEST(gamedatabasetest, testIllegalStartPosition) {
+	{
+		std::ofstream file(pgnPath, std::ios::binary | std::ios::trunc);
+		file << "[Event \"Broken\"]\n[FEN \"4k3/8/8/8/8/8/8/4K3 x - - 0 1\"]\n\n1. e4 e5 1-0\n\n"
+			 << "[Event \"Crowded\"]\n[FEN \"PPPPPPPP/PPPPPPPP/PPPPPPPP/PPPPPPPP/PPPPPPPP/8/8/k6K w - - 0 1\"]\n\n1-0\n\n"
+			 << "[Event \"Good\"]\n\n1. e4 e5 1-0\n";
+	}
+
+	// We don't replace a start position we cannot read
+	GameDatabase::Result result = GameDatabase::build(pgnPath, databasePath, 1);
+	EXPECT_EQ(1u, result.games);
+	EXPECT_EQ(3u, result.positions);
+	EXPECT_EQ(2u, result.errors);
+
+	std::remove(pgnPath.c_str());
+	std::remove(databasePath.c_str());
+}
+
+TEST(gamedatabasetest, testQuery) {
+	writePgn();
+	GameDatabase::build(pgnPath, databasePath, 2);
+	GameDatabase gameDatabase(databasePath);
+
+	Position position = notation::toPosition(notation::STANDARDPOSITION);
+	GameDatabase::Statistics statistics = gameDatabase.getStatistics(position);
+	EXPECT_EQ(4u, statistics.games);
+	EXPECT_EQ(1u, statistics.whiteWins);
+	EXPECT_EQ(2u, statistics.draws);
+	EXPECT_EQ(1u, statistics.blackWins);
+	ASSERT_EQ(3u, statistics.continuations.size());
+	EXPECT_EQ("e4", notation::fromMove(position, statistics.continuations[0].move));
+	EXPECT_EQ(2u, statistics.continuations[0].games);
+	EXPECT_EQ(1u, statistics.continuations[0].whiteWins);
+	EXPECT_EQ(1u, statistics.continuations[0].blackWins);
+	EXPECT_EQ(1u, statistics.continuations[1].games);
+	EXPECT_EQ(std::vector<uint64_t>({0, 1}), gameDatabase.findGames(position, 2));
+
+	// Both move orders reach this position
+	position = notation::toPosition("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+	EXPECT_EQ(std::vector<uint64_t>({0, 4}), gameDatabase.findGames(position));
+	statistics = gameDatabase.getStatistics(position);
+	EXPECT_EQ(2u, statistics.games);
+	ASSERT_EQ(1u, statistics.continuations.size());
+	EXPECT_EQ("Bb5", notation::fromMove(position, statistics.continuations[0].move));
+
+	position = notation::toPosition("8/8/8/8/8/8/8/K6k w - - 0 1");
+	EXPECT_TRUE(gameDatabase.findGames(position).empty());
+	EXPECT_EQ(0u, gameDatabase.getStatistics(position).games);
+
+	std::remove(pgnPath.c_str());
+	std::remove(databasePath.c_str());
+}
+
+TEST(gamedatabasetest, testGetGame) {
+	writePgn();
+	GameDatabase::build(pgnPath, databasePath, 1);
+	GameDatabase gameDatabase(databasePath);
+
+	Game game = gameDatabase.getGame(3);
+	EXPECT_EQ("4k3/P7/8/8/8/8/8/4K3 w - - 0 1", notation::fromPosition(game.position));
+	ASSERT_EQ(2u, game.moves.size());
+	EXPECT_EQ(+piecetype::QUEEN, move::getPromotion(game.moves[0]));
+	EXPECT_EQ(+PackedPosition::WHITEWINS, game.result);
+
+	game = gameDatabase.getGame(4);
+	EXPECT_EQ(notation::STANDARDPOSITION, notation::fromPosition(game.position));
+	EXPECT_EQ(5u, game.moves.size());
+	EXPECT_EQ(+PackedPosition::DRAW, game.result);
+	EXPECT_TRUE(game.error.empty());
+
+	EXPECT_THROW(gameDatabase.getGame(5), std::out_of_range);
+	EXPECT_THROW(GameDatabase database(pgnPath), std::runtime_error);
+
+	std::remove(pgnPath.c_str());
+	std::remove(databasePath.c_str());
+}
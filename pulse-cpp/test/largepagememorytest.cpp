@@ -0,0 +1,25 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "largepagememory.h"
+
+#include "gtest/gtest.h"
+
+using namespace pulse;
+
+TEST(largepagememorytest, testAllocate) {
+	LargePageMemory memory(3 * 1024 * 1024 + 5);
+
+	EXPECT_NE(nullptr, memory.data());
+	EXPECT_EQ(3u * 1024 * 1024 + 5, memory.size());
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(memory.data()) % 64);
+	EXPECT_FALSE(LargePageMemory::toString(memory.getKind()).empty());
+
+	// Memory is zeroed and writable
+	for (uint64_t i = 0; i < memory.size(); i += 4096) {
+		EXPECT_EQ(0, memory.data()[i]);
+		memory.data()[i] = 1;
+	}
+}
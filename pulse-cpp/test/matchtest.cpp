@@ -0,0 +1,78 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "match.h"
+#include "notation.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace pulse;
+
+TEST(matchtest, testParse) {
+	Match::Engine engine = Match::Engine::parse("Hash=64,SearchMode=MonteCarlo,Threads=2");
+	EXPECT_EQ(64u, engine.hashSize);
+	EXPECT_EQ(+Match::MONTECARLO, engine.searchMode);
+	EXPECT_EQ(2, engine.threads);
+	EXPECT_TRUE(engine.tablebasePath.empty());
+
+	engine = Match::Engine::parse("default");
+	EXPECT_EQ(16u, engine.hashSize);
+	EXPECT_EQ(+Match::ALPHABETA, engine.searchMode);
+
+	EXPECT_THROW(Match::Engine::parse("Hash"), std::invalid_argument);
+	EXPECT_THROW(Match::Engine::parse("Ponder=true"), std::invalid_argument);
+	EXPECT_THROW(Match::Engine::parse("SearchMode=Random"), std::invalid_argument);
+	EXPECT_THROW(Match::Engine::parse("Threads=0"), std::invalid_argument);
+}
+
+TEST(matchtest, testSprt) {
+	Match::Sprt sprt;
+	EXPECT_NEAR(-2.944, sprt.getLowerBound(), 0.001);
+	EXPECT_NEAR(2.944, sprt.getUpperBound(), 0.001);
+
+	EXPECT_EQ(0, sprt.getLlr(0, 0, 0));
+	EXPECT_EQ(0, sprt.getLlr(0, 10, 0));
+
+	// Results in favor of elo1 raise the ratio, results in favor of elo0 lower it
+	EXPECT_GT(sprt.getLlr(600, 200, 400), sprt.getUpperBound());
+	EXPECT_LT(sprt.getLlr(400, 200, 600), sprt.getLowerBound());
+	EXPECT_LT(std::abs(sprt.getLlr(51, 100, 49)), 1);
+}
+
+TEST(matchtest, testResult) {
+	Match::Result result;
+	result.wins = 30;
+	result.draws = 40;
+	result.losses = 30;
+	EXPECT_EQ(100u, result.getGames());
+	EXPECT_DOUBLE_EQ(0.5, result.getScore());
+	EXPECT_NEAR(0, result.getElo(), 1e-9);
+	EXPECT_GT(result.getEloError(), 0);
+
+	// A score of 75% is about 191 Elo
+	result.wins = 50;
+	result.draws = 50;
+	result.losses = 0;
+	EXPECT_NEAR(190.8, result.getElo(), 0.1);
+}
+
+TEST(matchtest, testRun) {
+	Match::Engine first = Match::Engine::parse("default");
+	Match::Engine second = Match::Engine::parse("Hash=1");
+	Match::Limits limits;
+	limits.nodes = 200;
+
+	std::vector<Position> openings = Match::createOpenings(2, 1);
+	ASSERT_EQ(2u, openings.size());
+
+	std::unique_ptr<Match> match(new Match());
+	Match::Result result = match->run(first, second, openings, 4, limits, Match::Sprt(), 2);
+	EXPECT_EQ(4u, result.getGames());
+	EXPECT_EQ(0u, result.timeLosses);
+	EXPECT_EQ(+Match::UNDECIDED, result.verdict);
+}
@@ -6,6 +6,7 @@
 #include "notation.h"
 #include "model/file.h"
 #include "model/rank.h"
+#include "model/move.h"
 
 #include "gtest/gtest.h"
 
@@ -79,3 +80,31 @@ TEST(notationtest, testStandardPosition) {
 	// Test full move number
 	EXPECT_EQ(1, position.getFullmoveNumber());
 }
+
+TEST(notationtest, testStandardAlgebraicNotation) {
+	Position position(notation::toPosition(notation::STANDARDPOSITION));
+	int pawnMove = notation::toMove(position, "e4");
+	EXPECT_EQ(+square::e2, move::getOriginSquare(pawnMove));
+	EXPECT_EQ(+square::e4, move::getTargetSquare(pawnMove));
+	EXPECT_EQ("e4", notation::fromMove(position, pawnMove));
+	EXPECT_EQ("Nf3", notation::fromMove(position, notation::toMove(position, "Nf3!?")));
+	EXPECT_THROW(notation::toMove(position, "Ke2"), std::invalid_argument);
+
+	position = notation::toPosition("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+	EXPECT_EQ("exd5", notation::fromMove(position, notation::toMove(position, "exd5")));
+
+	position = notation::toPosition("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+	EXPECT_EQ("O-O", notation::fromMove(position, notation::toMove(position, "0-0")));
+	EXPECT_EQ("O-O-O", notation::fromMove(position, notation::toMove(position, "O-O-O")));
+
+	position = notation::toPosition("1k5K/8/8/8/R7/8/8/R6R w - - 0 1");
+	EXPECT_EQ("R1a2", notation::fromMove(position, notation::toMove(position, "R1a2")));
+	EXPECT_EQ("Rad1", notation::fromMove(position, notation::toMove(position, "Rad1")));
+	EXPECT_THROW(notation::toMove(position, "Ra2"), std::invalid_argument);
+
+	position = notation::toPosition("6k1/5ppp/8/8/8/8/1p6/R5K1 w - - 0 1");
+	EXPECT_EQ("Ra8#", notation::fromMove(position, notation::toMove(position, "Ra8")));
+
+	position = notation::toPosition("6k1/1P6/8/8/8/8/8/6K1 w - - 0 1");
+	EXPECT_EQ("b8=Q+", notation::fromMove(position, notation::toMove(position, "b8=Q")));
+}
@@ -0,0 +1,82 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "packedposition.h"
+#include "notation.h"
+#include "model/move.h"
+#include "model/value.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace pulse;
+
+namespace {
+const std::string path = "packedpositiontest.bin";
+
+const std::vector<std::string> fens = {
+		notation::STANDARDPOSITION,
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+		"4r1k1/1q3ppp/p7/1p1Qp3/4P3/1P3P2/P5PP/3R2K1 b - - 3 28",
+		"8/8/8/8/8/8/8/K1k5 w - - 99 150"
+};
+}
+
+TEST(packedpositiontest, testPackAndUnpack) {
+	for (auto& fen: fens) {
+		Position position(notation::toPosition(fen));
+		PackedPosition packedPosition = PackedPosition::pack(position);
+		EXPECT_EQ(+PackedPosition::NORESULT, packedPosition.result);
+		EXPECT_EQ(+value::NOVALUE, packedPosition.score);
+		EXPECT_EQ(+move::NOMOVE, packedPosition.move);
+
+		Position unpacked = packedPosition.unpack();
+		EXPECT_EQ(fen, notation::fromPosition(unpacked));
+		EXPECT_EQ(position.zobristKey, unpacked.zobristKey);
+		EXPECT_TRUE(position == unpacked);
+	}
+}
+
+TEST(packedpositiontest, testWriteAndRead) {
+	std::vector<PackedPosition> packedPositions;
+	{
+		PackedPositionWriter writer(path);
+		for (unsigned int i = 0; i < fens.size(); i++) {
+			PackedPosition packedPosition = PackedPosition::pack(notation::toPosition(fens[i]));
+			packedPosition.score = static_cast<int32_t>(i) * 10;
+			packedPosition.result = PackedPosition::DRAW;
+			writer.write(packedPosition);
+			packedPositions.push_back(packedPosition);
+		}
+		writer.close();
+	}
+	{
+		PackedPositionWriter writer(path, true);
+		writer.write(packedPositions[0]);
+		writer.close();
+	}
+
+	{
+		PackedPositionReader reader(path);
+		ASSERT_EQ(fens.size() + 1, reader.size());
+		for (unsigned int i = 0; i < fens.size(); i++) {
+			EXPECT_TRUE(packedPositions[i] == reader[i]);
+			EXPECT_EQ(fens[i], notation::fromPosition(reader.getPosition(i)));
+		}
+		EXPECT_TRUE(packedPositions[0] == reader[fens.size()]);
+	}
+
+	// A partial record means the file is not ours
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::app);
+		file.put(0);
+	}
+	EXPECT_THROW(PackedPositionReader reader(path), std::runtime_error);
+
+	std::remove(path.c_str());
+}
@@ -0,0 +1,36 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "perfcounters.h"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+using namespace pulse;
+
+TEST(perfcounterstest, testCount) {
+	PerfCounters counters;
+
+	counters.start();
+	volatile uint64_t sum = 0;
+	for (uint64_t i = 0; i < 1000000; i++) {
+		sum = sum + i;
+	}
+	counters.stop();
+
+	// Virtual machines often have no counters at all
+	if (counters.isSupported(PerfCounters::INSTRUCTIONS)) {
+		EXPECT_GT(counters.get(PerfCounters::INSTRUCTIONS), 1000000u);
+	} else {
+		EXPECT_EQ(0u, counters.get(PerfCounters::INSTRUCTIONS));
+	}
+
+	std::ostringstream output;
+	counters.print(output, 1000);
+	for (int counter = 0; counter < PerfCounters::VALUES_SIZE; counter++) {
+		EXPECT_NE(std::string::npos, output.str().find(PerfCounters::toString(counter) + ": "));
+	}
+}
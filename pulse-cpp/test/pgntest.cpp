@@ -0,0 +1,99 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "pgn.h"
+#include "notation.h"
+#include "model/move.h"
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+
+using namespace pulse;
+
+namespace {
+const std::string games =
+		"[Event \"First\"]\n"
+		"[White \"A \\\"quoted\\\" name\"]\n"
+		"\n"
+		"1. e4 {best by test} e5 2.Nf3 (2. f4 exf4 (2... d5)) Nc6 $1 3. Bb5 a6; Ruy Lopez\n"
+		"4. Ba4 Nf6 5. O-O 1-0\n"
+		"\n"
+		"[Event \"Second\"]\n"
+		"[FEN \"4k3/P7/8/8/8/8/8/4K3 w - - 0 1\"]\n"
+		"\n"
+		"1. a8=Q+ Kd7 1/2-1/2\n"
+		"\n"
+		"[Event \"Third\"]\n"
+		"\n"
+		"1. e4 e5 2. Ke3 Nc6 *\n"
+		"[Event \"Fourth\"]\n"
+		"1. d4\n";
+}
+
+TEST(pgntest, testRead) {
+	std::istringstream input(games);
+	PgnReader reader(input);
+	Game game;
+
+	ASSERT_TRUE(reader.next(game));
+	EXPECT_EQ("First", game.getTag("Event"));
+	EXPECT_EQ("A \"quoted\" name", game.getTag("White"));
+	EXPECT_EQ("", game.getTag("Black"));
+	EXPECT_EQ(9u, game.moves.size());
+	EXPECT_EQ(+PackedPosition::WHITEWINS, game.result);
+	EXPECT_TRUE(game.error.empty());
+
+	Position position = game.position;
+	for (auto move: game.moves) {
+		position.makeMove(move);
+	}
+	EXPECT_EQ("r1bqkb1r/1ppp1ppp/p1n2n2/4p3/B3P3/5N2/PPPP1PPP/RNBQ1RK1 b kq - 3 5",
+			  notation::fromPosition(position));
+
+	ASSERT_TRUE(reader.next(game));
+	EXPECT_EQ("Second", game.getTag("Event"));
+	EXPECT_EQ("4k3/P7/8/8/8/8/8/4K3 w - - 0 1", notation::fromPosition(game.position));
+	EXPECT_EQ(2u, game.moves.size());
+	EXPECT_EQ(+piecetype::QUEEN, move::getPromotion(game.moves[0]));
+	EXPECT_EQ(+PackedPosition::DRAW, game.result);
+
+	// We keep the moves in front of an illegal one
+	ASSERT_TRUE(reader.next(game));
+	EXPECT_EQ(2u, game.moves.size());
+	EXPECT_EQ("Illegal move Ke3", game.error);
+	EXPECT_EQ(+PackedPosition::NORESULT, game.result);
+
+	// A game without termination marker ends at the end of the input
+	ASSERT_TRUE(reader.next(game));
+	EXPECT_EQ("Fourth", game.getTag("Event"));
+	EXPECT_EQ(1u, game.moves.size());
+	EXPECT_TRUE(game.error.empty());
+
+	EXPECT_FALSE(reader.next(game));
+}
+
+TEST(pgntest, testChunks) {
+	std::istringstream input(games);
+	uint64_t second = games.find("[Event \"Second\"]");
+	uint64_t third = games.find("[Event \"Third\"]");
+
+	EXPECT_EQ(second, PgnReader::findGameStart(input, 10));
+	EXPECT_EQ(third, PgnReader::findGameStart(input, second));
+
+	// Every game belongs to exactly one chunk
+	std::vector<std::string> events;
+	for (auto range: {std::make_pair<uint64_t, uint64_t>(0, +second),
+					  std::make_pair<uint64_t, uint64_t>(+second, games.size())}) {
+		std::istringstream chunk(games);
+		chunk.seekg(static_cast<std::streamoff>(range.first));
+		PgnReader reader(chunk, range.first, range.second);
+		Game game;
+		while (reader.next(game)) {
+			events.push_back(game.getTag("Event"));
+		}
+	}
+	EXPECT_EQ((std::vector<std::string>{"First", "Second", "Third", "Fourth"}), events);
+}
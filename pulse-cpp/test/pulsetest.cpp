@@ -0,0 +1,175 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "pulse.h"
+#include "notation.h"
+#include "movegenerator.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+using namespace pulse;
+
+namespace {
+/**
+ * Runs the engine on the commands and returns its output lines.
+ */
+std::vector<std::string> run(const std::string& commands) {
+	std::istringstream input(commands);
+	std::ostringstream output;
+	std::streambuf* cin = std::cin.rdbuf(input.rdbuf());
+	std::streambuf* cout = std::cout.rdbuf(output.rdbuf());
+	{
+		std::unique_ptr<Pulse> pulse(new Pulse());
+		pulse->run();
+	}
+	std::cin.rdbuf(cin);
+	std::cout.rdbuf(cout);
+
+	std::vector<std::string> lines;
+	std::istringstream result(output.str());
+	std::string line;
+	while (std::getline(result, line)) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+std::vector<std::string> getBestMoves(const std::vector<std::string>& lines) {
+	std::vector<std::string> bestMoves;
+	for (auto& line: lines) {
+		std::istringstream input(line);
+		std::string token;
+		if (input >> token && token == "bestmove" && input >> token) {
+			bestMoves.push_back(token);
+		}
+	}
+	return bestMoves;
+}
+
+bool isLegal(Position position, const std::string& move) {
+	MoveGenerator moveGenerator;
+	MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+	for (int i = 0; i < moves.size; i++) {
+		if (Pulse::fromMove(moves.entries[i]->move) == move) {
+			return true;
+		}
+	}
+	return false;
+}
+}
+
+TEST(pulsetest, testSupersededPosition) {
+	Pulse::CommandQueue commands;
+	commands.push("position startpos");
+	commands.push("position startpos moves e2e4");
+	commands.push("go depth 1");
+
+	// Only the last position before the go is executed
+	EXPECT_EQ("position startpos moves e2e4", commands.pop());
+	EXPECT_TRUE(commands.contains("go"));
+	EXPECT_EQ("go depth 1", commands.pop());
+	EXPECT_FALSE(commands.contains("go"));
+}
+
+TEST(pulsetest, testPositionBeforeGo) {
+	Pulse::CommandQueue commands;
+	commands.push("position startpos");
+	commands.push("go depth 1");
+	commands.push("position startpos moves e2e4");
+	commands.push("go depth 1");
+
+	// A position followed by a go is searched, so we keep it
+	EXPECT_EQ("position startpos", commands.pop());
+	EXPECT_EQ("go depth 1", commands.pop());
+	EXPECT_EQ("position startpos moves e2e4", commands.pop());
+	EXPECT_EQ("go depth 1", commands.pop());
+}
+
+TEST(pulsetest, testPositionBeforeQuit) {
+	Pulse::CommandQueue commands;
+	commands.push("position startpos");
+	commands.push("quit");
+
+	EXPECT_EQ("quit", commands.pop());
+}
+
+TEST(pulsetest, testQueuedGo) {
+	std::vector<std::string> lines = run(
+			"position startpos\n"
+			"go infinite\n"
+			"position startpos moves e2e4\n"
+			"go depth 1\n");
+
+	// Both searches are answered with a legal move of their position
+	std::vector<std::string> bestMoves = getBestMoves(lines);
+	ASSERT_EQ(2u, bestMoves.size());
+	Position position = notation::toPosition(notation::STANDARDPOSITION);
+	EXPECT_TRUE(isLegal(position, bestMoves[0]));
+	position.makeMove(notation::toMove(position, "e4"));
+	EXPECT_TRUE(isLegal(position, bestMoves[1]));
+}
+
+TEST(pulsetest, testReadyWhilePositionPending) {
+	std::vector<std::string> lines = run(
+			"position startpos\n"
+			"go infinite\n"
+			"position startpos moves e2e4\n"
+			"isready\n"
+			"stop\n");
+
+	// The infinite search only ends with the stop after the isready
+	auto ready = std::find(lines.begin(), lines.end(), "readyok");
+	ASSERT_NE(lines.end(), ready);
+	for (auto line = lines.begin(); line != ready; ++line) {
+		EXPECT_NE(0u, line->find("bestmove"));
+	}
+	EXPECT_EQ(1u, getBestMoves(lines).size());
+}
+
+TEST(pulsetest, testReadyAfterSetOption) {
+	std::vector<std::string> lines = run(
+			"setoption name Hash value 64\n"
+			"isready\n");
+
+	// The ready answer waits for the option in front of it
+	auto hash = std::find_if(lines.begin(), lines.end(), [](const std::string& line) {
+		return line.find("Using hash") != std::string::npos;
+	});
+	auto ready = std::find(lines.begin(), lines.end(), "readyok");
+	ASSERT_NE(lines.end(), hash);
+	ASSERT_NE(lines.end(), ready);
+	EXPECT_LT(hash, ready);
+}
+
+TEST(pulsetest, testIllegalOption) {
+	std::vector<std::string> lines = run(
+			"setoption\n"
+			"setoption name Hash value many\n"
+			"setoption name Hash value -1\n"
+			"setoption name Hash value 65537\n"
+			"setoption name AnalysisCacheSize value 0\n"
+			"setoption name Threads value 0\n"
+			"setoption name Threads value 257\n"
+			"setoption name Workers value 1.5\n"
+			"isready\n");
+
+	// We complain about every command and keep running
+	std::vector<std::string> expected = {
+			"info string Missing option name",
+			"info string Illegal value: many",
+			"info string Illegal value: -1",
+			"info string Illegal value: 65537",
+			"info string Illegal value: 0",
+			"info string Illegal value: 0",
+			"info string Illegal value: 257",
+			"info string Illegal value: 1.5",
+			"readyok"
+	};
+	EXPECT_EQ(expected, lines);
+}
@@ -0,0 +1,43 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "scaling.h"
+
+#include "gtest/gtest.h"
+
+#include <iostream>
+#include <sstream>
+
+using namespace pulse;
+
+TEST(scalingtest, testRun) {
+	std::ostringstream output;
+	std::streambuf* cout = std::cout.rdbuf(output.rdbuf());
+	{
+		std::unique_ptr<Scaling> scaling(new Scaling());
+		scaling->run(2, 20, 5, 1);
+	}
+	std::cout.rdbuf(cout);
+
+	std::istringstream input(output.str());
+	std::string line;
+	ASSERT_TRUE(std::getline(input, line));
+	EXPECT_EQ("threads,nodes,nps,npsscaling,timetonodes,speedup,agreement", line);
+
+	// One line per thread count with a value for every column
+	for (int threads = 1; threads <= 2; threads++) {
+		ASSERT_TRUE(std::getline(input, line));
+		std::istringstream values(line);
+		std::string value;
+		std::vector<std::string> row;
+		while (std::getline(values, value, ',')) {
+			row.push_back(value);
+		}
+		ASSERT_EQ(7u, row.size());
+		EXPECT_EQ(std::to_string(threads), row[0]);
+		EXPECT_GT(std::stoull(row[1]), 0u);
+	}
+	EXPECT_FALSE(std::getline(input, line));
+}
@@ -0,0 +1,82 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "search.h"
+#include "notation.h"
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace pulse;
+
+namespace {
+class TestProtocol final : public Protocol {
+public:
+	std::mutex mutex;
+	std::condition_variable condition;
+	int bestMoves = 0;
+
+	void sendBestMove(int bestMove, int ponderMove) override {
+		std::unique_lock<std::mutex> lock(mutex);
+		bestMoves++;
+		condition.notify_all();
+	}
+
+	void sendStatus(int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+					int currentMoveNumber) override {
+	}
+
+	void sendStatus(bool force, int currentDepth, int currentMaxDepth, uint64_t totalNodes, int currentMove,
+					int currentMoveNumber) override {
+	}
+
+	void sendMove(RootEntry entry, int currentDepth, int currentMaxDepth, uint64_t totalNodes) override {
+	}
+
+	void sendInfo(const std::string& message) override {
+	}
+
+	void sendDebug(const std::string& message) override {
+	}
+};
+
+/**
+ * Searches the standard position to depth 2 and returns the hash hits.
+ */
+uint64_t getHashHits(bool isShared) {
+	TestProtocol protocol;
+	Search search(protocol);
+
+	Position position = notation::toPosition(notation::STANDARDPOSITION);
+	search.newDepthSearch(position, 2);
+
+	// Another process has searched 1. e4 e5 from here
+	if (isShared) {
+		Position child = position;
+		child.makeMove(notation::toMove(child, "e4"));
+		search.addSharedEntry(child.zobristKey, notation::toMove(child, "e5"), 20, 4, 1);
+	}
+
+	search.start();
+	{
+		std::unique_lock<std::mutex> lock(protocol.mutex);
+		EXPECT_TRUE(protocol.condition.wait_for(lock, std::chrono::seconds(30), [&] { return protocol.bestMoves > 0; }));
+	}
+	search.stop();
+	uint64_t hashHits = search.getStatistics().hashHits;
+	search.quit();
+	return hashHits;
+}
+}
+
+TEST(searchtest, testSharedEntry) {
+	// The first iteration stores nothing our second iteration probes, so
+	// only the shared entry is found.
+	EXPECT_EQ(0u, getHashHits(false));
+	EXPECT_EQ(1u, getHashHits(true));
+}
@@ -0,0 +1,63 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "selfplay.h"
+#include "movegenerator.h"
+#include "model/move.h"
+#include "model/value.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace pulse;
+
+namespace {
+const std::string path = "selfplaytest.bin";
+
+std::vector<PackedPosition> play(int threads) {
+	std::unique_ptr<SelfPlay> selfPlay(new SelfPlay());
+	selfPlay->run(path, 4, 1, 0, threads, 1);
+
+	std::vector<PackedPosition> packedPositions;
+	{
+		PackedPositionReader reader(path);
+		for (size_t i = 0; i < reader.size(); i++) {
+			packedPositions.push_back(reader[i]);
+		}
+	}
+	std::remove(path.c_str());
+	return packedPositions;
+}
+}
+
+TEST(selfplaytest, testPositions) {
+	std::vector<PackedPosition> packedPositions = play(2);
+	ASSERT_FALSE(packedPositions.empty());
+
+	MoveGenerator moveGenerator;
+	for (auto& packedPosition: packedPositions) {
+		EXPECT_NE(+PackedPosition::NORESULT, packedPosition.result);
+		EXPECT_NE(+value::NOVALUE, packedPosition.score);
+
+		// Every recorded move must be legal in its position
+		Position position = packedPosition.unpack();
+		MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+		bool isLegal = false;
+		for (int i = 0; i < moves.size; i++) {
+			if (moves.entries[i]->move == packedPosition.move) {
+				isLegal = true;
+			}
+		}
+		EXPECT_TRUE(isLegal);
+	}
+}
+
+TEST(selfplaytest, testSeed) {
+	// A depth search is deterministic, so the games only depend on the seed
+	std::vector<PackedPosition> first = play(1);
+	std::vector<PackedPosition> second = play(1);
+	EXPECT_TRUE(first == second);
+}
@@ -0,0 +1,43 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "suite.h"
+#include "notation.h"
+#include "model/move.h"
+
+#include "gtest/gtest.h"
+
+using namespace pulse;
+
+TEST(suitetest, testParse) {
+	Suite::Entry entry = Suite::parse(
+			"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - bm e4 d2d4; am a3; id \"start.001\";");
+	EXPECT_EQ("start.001", entry.id);
+	EXPECT_EQ(notation::fromPosition(notation::toPosition(notation::STANDARDPOSITION)),
+			  notation::fromPosition(entry.position));
+	EXPECT_EQ(2u, entry.bestMoves.size());
+	EXPECT_EQ(1u, entry.avoidMoves.size());
+
+	Position position = entry.position;
+	EXPECT_TRUE(entry.isSolution(notation::toMove(position, "e4")));
+	EXPECT_TRUE(entry.isSolution(notation::toMove(position, "d4")));
+	EXPECT_FALSE(entry.isSolution(notation::toMove(position, "Nf3")));
+	EXPECT_FALSE(entry.isSolution(notation::toMove(position, "a3")));
+	EXPECT_FALSE(entry.isSolution(+move::NOMOVE));
+}
+
+TEST(suitetest, testAvoidMove) {
+	Suite::Entry entry = Suite::parse("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - am f3 g4;");
+	Position position = entry.position;
+	EXPECT_TRUE(entry.isSolution(notation::toMove(position, "e4")));
+	EXPECT_FALSE(entry.isSolution(notation::toMove(position, "g4")));
+}
+
+TEST(suitetest, testInvalid) {
+	EXPECT_THROW(Suite::parse("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - id \"x\";"),
+				 std::invalid_argument);
+	EXPECT_THROW(Suite::parse("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - bm Ke2;"),
+				 std::invalid_argument);
+}
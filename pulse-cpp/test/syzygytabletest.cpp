@@ -0,0 +1,555 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "syzygytable.h"
+#include "tablebasegenerator.h"
+#include "tablebases.h"
+#include "mappedfile.h"
+#include "notation.h"
+#include "model/color.h"
+#include "model/move.h"
+#include "model/piece.h"
+#include "model/piecetype.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <queue>
+#include <set>
+
+using namespace pulse;
+
+namespace {
+const std::string directory = "syzygytabletest";
+const std::string generatedDirectory = directory + "/generated";
+const std::string syzygyDirectory = directory + "/syzygy";
+
+constexpr int NOVALUE = -1;
+
+// The piece codes of the Syzygy format
+int getCode(int piece) {
+	static const std::array<int, piecetype::VALUES_SIZE> codes = {1, 2, 3, 4, 5, 6};
+	return codes[piece::getType(piece)] | (piece::getColor(piece) == color::BLACK ? 8 : 0);
+}
+
+void writeShort(std::vector<uint8_t>& data, int value) {
+	data.push_back(static_cast<uint8_t>(value));
+	data.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void writeInt(std::vector<uint8_t>& data, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+	}
+}
+
+void align(std::vector<uint8_t>& data, size_t alignment) {
+	while (data.size() % alignment != 0) {
+		data.push_back(0);
+	}
+}
+
+/**
+ * The compressed values of one side to move and one pawn file. We pair the
+ * most frequent value with itself and give every symbol a canonical Huffman
+ * code like the Syzygy generator does.
+ */
+class Compressed final {
+public:
+	static const int BLOCK_BITS = 6;
+	static const int SPAN_BITS = 10;
+
+	std::vector<uint8_t> sizes;
+	std::vector<uint8_t> sparseIndex;
+	std::vector<uint8_t> blockLengths;
+	std::vector<uint8_t> data;
+
+	Compressed(const std::vector<int>& values, int flags) {
+		// Symbols are the values plus one pair
+		std::map<int, int> counts;
+		for (int value: values) {
+			counts[value]++;
+		}
+		int paired = std::max_element(counts.begin(), counts.end(), [](auto& a, auto& b) {
+			return a.second < b.second;
+		})->first;
+		std::vector<int> leaves;
+		for (auto& count: counts) {
+			leaves.push_back(count.first);
+		}
+		int pairSymbol = static_cast<int>(leaves.size());
+		int pairedSymbol = static_cast<int>(std::find(leaves.begin(), leaves.end(), paired) - leaves.begin());
+
+		std::vector<int> symbols;
+		for (size_t i = 0; i < values.size(); i++) {
+			if (values[i] == paired && i + 1 < values.size() && values[i + 1] == paired) {
+				symbols.push_back(pairSymbol);
+				i++;
+			} else {
+				symbols.push_back(static_cast<int>(std::find(leaves.begin(), leaves.end(), values[i]) - leaves.begin()));
+			}
+		}
+
+		// Huffman code lengths
+		int symbolCount = pairSymbol + 1;
+		std::vector<uint64_t> frequencies(symbolCount, 1);
+		for (int symbol: symbols) {
+			frequencies[symbol]++;
+		}
+		std::vector<int> parents(2 * symbolCount, -1);
+		using Node = std::pair<uint64_t, int>;
+		std::priority_queue<Node, std::vector<Node>, std::greater<>> queue;
+		for (int symbol = 0; symbol < symbolCount; symbol++) {
+			queue.emplace(frequencies[symbol], symbol);
+		}
+		int next = symbolCount;
+		while (queue.size() > 1) {
+			Node first = queue.top();
+			queue.pop();
+			Node second = queue.top();
+			queue.pop();
+			parents[first.second] = next;
+			parents[second.second] = next;
+			queue.emplace(first.first + second.first, next++);
+		}
+		std::vector<int> lengths(symbolCount, 0);
+		for (int symbol = 0; symbol < symbolCount; symbol++) {
+			for (int node = symbol; parents[node] != -1; node = parents[node]) {
+				lengths[symbol]++;
+			}
+		}
+		int minLength = *std::min_element(lengths.begin(), lengths.end());
+		int maxLength = *std::max_element(lengths.begin(), lengths.end());
+
+		// Longer codes get lower ids and lower codes
+		std::vector<int> order(symbolCount);
+		for (int symbol = 0; symbol < symbolCount; symbol++) {
+			order[symbol] = symbol;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return lengths[a] > lengths[b]; });
+		std::vector<int> ids(symbolCount);
+		for (int id = 0; id < symbolCount; id++) {
+			ids[order[id]] = id;
+		}
+
+		std::vector<int> lowest(maxLength + 2, 0);
+		std::vector<uint64_t> bases(maxLength + 2, 0);
+		for (int length = maxLength - 1; length >= minLength; length--) {
+			int longer = static_cast<int>(std::count(lengths.begin(), lengths.end(), length + 1));
+			lowest[length] = lowest[length + 1] + longer;
+			bases[length] = (bases[length + 1] + longer) / 2;
+		}
+		std::vector<uint64_t> codes(symbolCount);
+		for (int id = 0; id < symbolCount; id++) {
+			int length = lengths[order[id]];
+			codes[order[id]] = bases[length] + (id - lowest[length]);
+		}
+
+		sizes.push_back(static_cast<uint8_t>(flags));
+		sizes.push_back(BLOCK_BITS);
+		sizes.push_back(SPAN_BITS);
+		sizes.push_back(0);
+		size_t blockCountOffset = sizes.size();
+		writeInt(sizes, 0);
+		sizes.push_back(static_cast<uint8_t>(maxLength));
+		sizes.push_back(static_cast<uint8_t>(minLength));
+		for (int length = minLength; length <= maxLength; length++) {
+			writeShort(sizes, lowest[length]);
+		}
+		writeShort(sizes, symbolCount);
+		for (int id = 0; id < symbolCount; id++) {
+			int left = order[id] == pairSymbol ? ids[pairedSymbol] : leaves[order[id]];
+			int right = order[id] == pairSymbol ? ids[pairedSymbol] : 0xFFF;
+			sizes.push_back(static_cast<uint8_t>(left));
+			sizes.push_back(static_cast<uint8_t>((left >> 8) | (right & 0xF) << 4));
+			sizes.push_back(static_cast<uint8_t>(right >> 4));
+		}
+		align(sizes, 2);
+
+		// Fill the blocks with whole symbols
+		std::vector<uint64_t> blockStarts;
+		uint64_t valueIndex = 0;
+		int bits = 1 << (BLOCK_BITS + 3);
+		std::vector<uint8_t> block;
+		uint64_t buffer = 0;
+		int bufferSize = 0;
+		int blockValues = 0;
+		auto flushBlock = [&]() {
+			if (bufferSize > 0) {
+				block.push_back(static_cast<uint8_t>(buffer << (8 - bufferSize)));
+			}
+			block.resize(size_t(1) << BLOCK_BITS, 0);
+			data.insert(data.end(), block.begin(), block.end());
+			writeShort(blockLengths, blockValues - 1);
+			block.clear();
+			buffer = 0;
+			bufferSize = 0;
+			blockValues = 0;
+		};
+		int usedBits = 0;
+		for (int symbol: symbols) {
+			int length = lengths[symbol];
+			if (usedBits + length > bits) {
+				flushBlock();
+				usedBits = 0;
+			}
+			if (blockValues == 0) {
+				blockStarts.push_back(valueIndex);
+			}
+			for (int i = length - 1; i >= 0; i--) {
+				buffer = buffer << 1 | ((codes[symbol] >> i) & 1);
+				if (++bufferSize == 8) {
+					block.push_back(static_cast<uint8_t>(buffer));
+					buffer = 0;
+					bufferSize = 0;
+				}
+			}
+			usedBits += length;
+			int size = symbol == pairSymbol ? 2 : 1;
+			blockValues += size;
+			valueIndex += size;
+		}
+		flushBlock();
+
+		uint32_t blockCount = static_cast<uint32_t>(blockStarts.size());
+		for (int i = 0; i < 4; i++) {
+			sizes[blockCountOffset + i] = static_cast<uint8_t>(blockCount >> (8 * i));
+		}
+
+		// Every entry points to the middle of its span
+		uint64_t span = uint64_t(1) << SPAN_BITS;
+		for (uint64_t start = 0; start < values.size(); start += span) {
+			uint64_t index = std::min<uint64_t>(start + span / 2, values.size() - 1);
+			uint32_t block = static_cast<uint32_t>(
+					std::upper_bound(blockStarts.begin(), blockStarts.end(), index) - blockStarts.begin() - 1);
+			writeInt(sparseIndex, block);
+			writeShort(sparseIndex, static_cast<int>(start + span / 2 - blockStarts[block]));
+		}
+	}
+};
+
+/**
+ * Writes a table in the Syzygy format from the values of a generated
+ * table. This lets us check the decoder without downloading tables.
+ */
+class Writer final {
+public:
+	explicit Writer(const std::string& name)
+			: name(name), table(name) {
+		hasPawns = name.find('P') != std::string::npos;
+		files = hasPawns ? 4 : 1;
+
+		// The pawns lead, otherwise the kings and the unique piece
+		std::vector<int> pawns;
+		std::vector<int> others;
+		size_t separator = name.find('v');
+		for (int color: color::values) {
+			std::string side = color == color::WHITE ? name.substr(0, separator) : name.substr(separator + 1);
+			for (char letter: side.substr(1)) {
+				int piece = piece::valueOf(color, static_cast<int>(std::string("PNBRQ").find(letter)));
+				(piece::getType(piece) == piecetype::PAWN ? pawns : others).push_back(piece);
+			}
+		}
+		pieces = pawns;
+		pieces.push_back(piece::WHITE_KING);
+		pieces.push_back(piece::BLACK_KING);
+		pieces.insert(pieces.end(), others.begin(), others.end());
+
+		// Index the values with a table of single values
+		std::vector<uint8_t> header = write(false, {});
+		if (!table.setWdl(header.data(), header.size())) {
+			throw std::runtime_error("Invalid header");
+		}
+	}
+
+	/**
+	 * Stores the values of the generated table. Positions with the same
+	 * index must have the same value.
+	 */
+	bool setValues(const uint8_t* generatedValues) {
+		GeneratedTable generated(name, generatedValues);
+		for (int side = 0; side < 2; side++) {
+			for (int file = 0; file < files; file++) {
+				wdl[side][file].assign(table.getSize(false, side, file), NOVALUE);
+				dtz[side][file].assign(table.getSize(false, side, file), NOVALUE);
+			}
+		}
+
+		Position position;
+		std::array<int, GeneratedTable::MAX_PIECES> squares;
+		for (uint64_t index = 0; index < generated.getSize(); index++) {
+			if (!generated.setup(index, position, squares)) {
+				continue;
+			}
+
+			int wdlValue;
+			int dtzValue = 0;
+			if (!position.isCheck(color::opposite(position.activeColor))
+				&& generated.probeWdl(position, false, wdlValue)) {
+				generated.probeDtz(position, false, wdlValue, dtzValue);
+				int side;
+				int file;
+				uint64_t tableIndex = table.getIndex(position, false, false, side, file);
+				if (!set(wdl[side][file][tableIndex], wdlValue + 2)
+					|| !set(dtz[side][file][tableIndex], std::max(dtzValue - 1, 0))) {
+					return false;
+				}
+			}
+
+			for (int i = 0; i < static_cast<int>(pieces.size()); i++) {
+				position.remove(squares[i]);
+			}
+		}
+
+		return true;
+	}
+
+	void write(const std::string& path, bool isDtz) {
+		std::vector<uint8_t> data = write(isDtz, isDtz ? dtz : wdl);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	}
+
+private:
+	using Values = std::array<std::array<std::vector<int>, 4>, 2>;
+
+	std::string name;
+	SyzygyTable table;
+	bool hasPawns;
+	int files;
+	std::vector<int> pieces;
+	Values wdl;
+	Values dtz;
+
+	static bool set(int& value, int newValue) {
+		if (value != NOVALUE && value != newValue) {
+			return false;
+		}
+		value = newValue;
+		return true;
+	}
+
+	/**
+	 * Returns the file bytes. Without values every table stores a single
+	 * value. The DTZ file stores white to move and maps its win values.
+	 */
+	std::vector<uint8_t> write(bool isDtz, const Values& values) const {
+		static const std::array<uint8_t, 4> wdlMagic = {0x71, 0xE8, 0x23, 0x5D};
+		static const std::array<uint8_t, 4> dtzMagic = {0xD7, 0x66, 0x0C, 0xA5};
+		int sides = isDtz ? 1 : 2;
+
+		std::vector<uint8_t> data(isDtz ? dtzMagic.begin() : wdlMagic.begin(),
+								  isDtz ? dtzMagic.end() : wdlMagic.end());
+		data.push_back(static_cast<uint8_t>(1 | (hasPawns ? 2 : 0)));
+		for (int file = 0; file < files; file++) {
+			data.push_back(0);
+			for (int piece: pieces) {
+				data.push_back(static_cast<uint8_t>(getCode(piece) | getCode(piece) << 4));
+			}
+		}
+		align(data, 2);
+
+		std::vector<Compressed> compressed;
+		std::vector<int> map;
+		for (int file = 0; file < files; file++) {
+			for (int side = 0; side < sides; side++) {
+				if (values[side][file].empty()) {
+					data.push_back(SyzygyTable::SINGLEVALUE);
+					data.push_back(0);
+					continue;
+				}
+
+				std::vector<int> stored = values[side][file];
+				int flags = 0;
+				if (isDtz) {
+					// Store the win values by their position in the map
+					flags = SyzygyTable::MAPPED | SyzygyTable::WINPLIES | SyzygyTable::LOSSPLIES;
+					for (int& value: stored) {
+						if (value != NOVALUE && std::find(map.begin(), map.end(), value) == map.end()) {
+							map.push_back(value);
+						}
+					}
+				}
+				for (int& value: stored) {
+					value = value == NOVALUE ? 0
+											 : (isDtz ? static_cast<int>(std::find(map.begin(), map.end(), value) - map.begin())
+													  : value);
+				}
+				compressed.emplace_back(stored, flags);
+				data.insert(data.end(), compressed.back().sizes.begin(), compressed.back().sizes.end());
+			}
+		}
+
+		if (isDtz && !compressed.empty()) {
+			for (int file = 0; file < files; file++) {
+				for (int list = 0; list < 4; list++) {
+					if (list == 0) {
+						data.push_back(static_cast<uint8_t>(map.size()));
+						data.insert(data.end(), map.begin(), map.end());
+					} else {
+						data.push_back(0);
+					}
+				}
+			}
+			align(data, 2);
+		}
+
+		for (auto& table: compressed) {
+			data.insert(data.end(), table.sparseIndex.begin(), table.sparseIndex.end());
+		}
+		for (auto& table: compressed) {
+			data.insert(data.end(), table.blockLengths.begin(), table.blockLengths.end());
+		}
+		for (auto& table: compressed) {
+			align(data, 64);
+			data.insert(data.end(), table.data.begin(), table.data.end());
+		}
+
+		data.resize(data.size() + 8, 0);
+		while (data.size() % 64 != 16) {
+			data.push_back(0);
+		}
+		return data;
+	}
+};
+
+void generate(const std::vector<std::string>& names) {
+	TablebaseGenerator tablebaseGenerator;
+	tablebaseGenerator.run(generatedDirectory, names, 1, TablebaseGenerator::DEFAULT_MEMORY);
+	std::filesystem::create_directories(syzygyDirectory);
+
+	for (const std::string& name: names) {
+		MappedFile file(generatedDirectory + "/" + name + GeneratedTable::EXTENSION, MappedFile::READONLY);
+		Writer writer(name);
+		ASSERT_TRUE(writer.setValues(file.data() + sizeof(GeneratedTable::Header)));
+		writer.write(syzygyDirectory + "/" + name + SyzygyTable::WDL_EXTENSION, false);
+
+		// Only without pawns the distance to mate is the dtz
+		if (name.find('P') == std::string::npos) {
+			writer.write(syzygyDirectory + "/" + name + SyzygyTable::DTZ_EXTENSION, true);
+		}
+	}
+}
+
+std::set<int> getRootMoves(Tablebases& tablebases, Position& position) {
+	MoveGenerator moveGenerator;
+	MoveList<RootEntry> rootMoves;
+	MoveList<MoveEntry>& moves = moveGenerator.getLegalMoves(position, 1, position.isCheck());
+	for (int i = 0; i < moves.size; i++) {
+		rootMoves.entries[rootMoves.size++]->move = moves.entries[i]->move;
+	}
+
+	std::set<int> result;
+	if (tablebases.filterRootMoves(position, rootMoves, moveGenerator)) {
+		for (int i = 0; i < rootMoves.size; i++) {
+			result.insert(rootMoves.entries[i]->move);
+		}
+	}
+	return result;
+}
+}
+
+TEST(syzygytabletest, testSize) {
+	// The kings and the queen lead
+	SyzygyTable table("KQvK");
+	std::vector<uint8_t> data = {0x71, 0xE8, 0x23, 0x5D, 0x01, 0x00, 0x66, 0xEE, 0x55, 0x00};
+	data.insert(data.end(), {SyzygyTable::SINGLEVALUE, 4, SyzygyTable::SINGLEVALUE, 0});
+	data.resize(80, 0);
+	ASSERT_TRUE(table.setWdl(data.data(), data.size()));
+	EXPECT_EQ(31332u, table.getSize(false, 0, 0));
+
+	int wdl;
+	Position position = notation::toPosition("8/8/8/4k3/8/8/2Q5/4K3 w - - 0 1");
+	ASSERT_TRUE(table.probeWdl(position, false, wdl));
+	EXPECT_EQ(+Tablebases::WIN, wdl);
+	ASSERT_TRUE(table.probeWdl(notation::toPosition("8/8/8/4k3/8/8/2Q5/4K3 b - - 0 1"), false, wdl));
+	EXPECT_EQ(+Tablebases::LOSS, wdl);
+	EXPECT_FALSE(table.probeWdl(notation::toPosition("8/8/8/4k3/8/8/2QQ4/4K3 w - - 0 1"), false, wdl));
+
+	// Only the kings lead, the rooks are a group of two
+	SyzygyTable rooks("KRRvK");
+	data = {0x71, 0xE8, 0x23, 0x5D, 0x01, 0x00, 0x66, 0xEE, 0x44, 0x44};
+	data.insert(data.end(), {SyzygyTable::SINGLEVALUE, 4, SyzygyTable::SINGLEVALUE, 0});
+	data.resize(80, 0);
+	ASSERT_TRUE(rooks.setWdl(data.data(), data.size()));
+	EXPECT_EQ(462u * 1891u, rooks.getSize(false, 0, 0));
+
+	// Broken files
+	EXPECT_FALSE(rooks.setWdl(data.data(), data.size() - 1));
+	data[0] = 0;
+	EXPECT_FALSE(rooks.setWdl(data.data(), data.size()));
+	EXPECT_THROW(SyzygyTable("KQQQQvKRRR"), std::invalid_argument);
+}
+
+TEST(syzygytabletest, testProbe) {
+	std::filesystem::remove_all(directory);
+	generate({"KQvK", "KRvK", "KPvK"});
+
+	Tablebases generated;
+	generated.setPath(generatedDirectory);
+	Tablebases syzygy;
+	syzygy.setPath(syzygyDirectory);
+	EXPECT_EQ(3u, syzygy.getTableCount());
+	EXPECT_EQ(3, syzygy.getMaxPieces());
+
+	// Legal positions have the same result in both tables. Without captures
+	// and pawn moves the dtz is the distance to mate.
+	for (const std::string& name: {"KQvK", "KRvK", "KPvK"}) {
+		GeneratedTable table(name);
+		Position position;
+		std::array<int, GeneratedTable::MAX_PIECES> squares;
+		for (uint64_t index = 0; index < table.getSize(); index += 7) {
+			if (!table.setup(index, position, squares)) {
+				continue;
+			}
+
+			int expected;
+			int actual;
+			if (!position.isCheck(color::opposite(position.activeColor))) {
+				ASSERT_TRUE(generated.probeWdl(position, expected));
+				ASSERT_TRUE(syzygy.probeWdl(position, actual)) << name << " " << index;
+				ASSERT_EQ(expected, actual) << name << " " << index;
+
+				if (std::string(name) != "KPvK" && generated.probeDtz(position, expected)) {
+					ASSERT_TRUE(syzygy.probeDtz(position, actual)) << name << " " << index;
+					ASSERT_EQ(expected, actual) << name << " " << index;
+				}
+			}
+
+			for (int i = 0; i < 3; i++) {
+				position.remove(squares[i]);
+			}
+		}
+	}
+
+	// Black can capture the pawn
+	int wdl;
+	Position position = notation::toPosition("8/8/8/8/8/3k4/3P4/7K b - - 0 1");
+	ASSERT_TRUE(syzygy.probeWdl(position, wdl));
+	EXPECT_EQ(+Tablebases::DRAW, wdl);
+
+	// We keep the fastest mates
+	position = notation::toPosition("8/8/8/8/8/2k5/7R/K7 w - - 0 1");
+	std::set<int> rootMoves = getRootMoves(syzygy, position);
+	EXPECT_FALSE(rootMoves.empty());
+	EXPECT_EQ(getRootMoves(generated, position), rootMoves);
+
+	// A queen stalemates. There is no KBvK or KNvK table and no DTZ file of
+	// KPvK, so the search decides about the other moves.
+	position = notation::toPosition("8/k1P5/8/1K6/8/8/8/8 w - - 0 1");
+	std::map<int, int> promotions;
+	for (int move: getRootMoves(syzygy, position)) {
+		promotions[move::getPromotion(move)]++;
+	}
+	EXPECT_EQ(0, promotions[piecetype::QUEEN]);
+	EXPECT_EQ(1, promotions[piecetype::ROOK]);
+	EXPECT_EQ(1, promotions[piecetype::BISHOP]);
+	EXPECT_EQ(1, promotions[piecetype::KNIGHT]);
+
+	std::filesystem::remove_all(directory);
+}
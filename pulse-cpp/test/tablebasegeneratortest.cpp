@@ -0,0 +1,115 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "tablebasegenerator.h"
+#include "tablebases.h"
+#include "notation.h"
+
+#include "gtest/gtest.h"
+
+#include <filesystem>
+
+using namespace pulse;
+
+namespace {
+const std::string directory = "tablebasegeneratortest";
+}
+
+TEST(tablebasegeneratortest, testNames) {
+	EXPECT_EQ("KQvK", GeneratedTable::getCanonicalName("KvKQ"));
+	EXPECT_EQ("KRvKN", GeneratedTable::getCanonicalName("KNvKR"));
+	EXPECT_EQ("KRPvKR", GeneratedTable::getCanonicalName("KRvKPR"));
+
+	EXPECT_TRUE(GeneratedTable::isDrawn("KvK"));
+	EXPECT_TRUE(GeneratedTable::isDrawn("KBvKN"));
+	EXPECT_FALSE(GeneratedTable::isDrawn("KNNvK"));
+	EXPECT_FALSE(GeneratedTable::isDrawn("KPvK"));
+
+	EXPECT_EQ(std::vector<std::string>({"KQvK", "KRvK"}), GeneratedTable::getSuccessors("KQvKR"));
+	EXPECT_EQ(std::vector<std::string>({"KQvK", "KRvK"}), GeneratedTable::getSuccessors("KPvK"));
+}
+
+TEST(tablebasegeneratortest, testIndex) {
+	GeneratedTable table("KRvKP");
+	Position position;
+	std::array<int, GeneratedTable::MAX_PIECES> squares;
+	for (uint64_t index = 0; index < table.getSize(); index += 997) {
+		if (table.setup(index, position, squares)) {
+			EXPECT_EQ(index, table.getIndex(position, false));
+			for (int i = 0; i < 4; i++) {
+				position.remove(squares[i]);
+			}
+		}
+	}
+
+	// The same position with the colors swapped
+	Position white = notation::toPosition("8/8/8/4k3/8/1p6/2R5/4K3 w - - 0 1");
+	Position black = notation::toPosition("4k3/2r5/1P6/8/4K3/8/8/8 b - - 0 1");
+	EXPECT_EQ(table.getIndex(white, false), table.getIndex(black, true));
+
+	// Mirrored along the d/e files
+	Position mirrored = notation::toPosition("8/8/8/3k4/8/6p1/5R2/3K4 w - - 0 1");
+	EXPECT_EQ(table.getIndex(white, false), table.getIndex(mirrored, false));
+
+	EXPECT_EQ(+GeneratedTable::NOINDEX, table.getIndex(white, true));
+}
+
+TEST(tablebasegeneratortest, testDrawnValue) {
+	MoveGenerator moveGenerator;
+
+	// Bishops cannot force a mate, but White is mated here
+	Position position = notation::toPosition("8/8/8/4b3/8/8/B1k5/K7 w - - 0 1");
+	EXPECT_EQ(+GeneratedTable::LOSS, TablebaseGenerator::getDrawnValue(position, moveGenerator));
+
+	position = notation::toPosition("8/8/8/4b3/8/8/B1k5/K7 b - - 0 1");
+	EXPECT_EQ(+GeneratedTable::DRAW, TablebaseGenerator::getDrawnValue(position, moveGenerator));
+}
+
+TEST(tablebasegeneratortest, testGenerate) {
+	std::filesystem::remove_all(directory);
+
+	TablebaseGenerator tablebaseGenerator;
+	std::vector<TablebaseGenerator::Result> results = tablebaseGenerator.run(directory, {"KvKQ", "KRvK"}, 2,
+																			 TablebaseGenerator::DEFAULT_MEMORY);
+	ASSERT_EQ(2u, results.size());
+	EXPECT_EQ("KQvK", results[0].name);
+	EXPECT_EQ(10, results[0].longestMate);
+	EXPECT_EQ("KRvK", results[1].name);
+	EXPECT_EQ(16, results[1].longestMate);
+	EXPECT_EQ(results[1].positions, results[1].wins + results[1].losses + results[1].draws);
+	EXPECT_GT(results[1].draws, 0u);
+
+	// Existing tables are loaded
+	TablebaseGenerator again;
+	EXPECT_TRUE(again.run(directory, {"KQvK"}, 1, TablebaseGenerator::DEFAULT_MEMORY).empty());
+	EXPECT_THROW(again.run(directory, {"KQRvK"}, 1, 1024), std::runtime_error);
+
+	Tablebases tablebases;
+	tablebases.setPath(directory);
+	EXPECT_EQ(2u, tablebases.getTableCount());
+	EXPECT_EQ(3, tablebases.getMaxPieces());
+
+	int wdl;
+	int dtz;
+	Position position = notation::toPosition("k7/8/1K6/8/8/8/8/6Q1 w - - 0 1");
+	ASSERT_TRUE(tablebases.probeWdl(position, wdl));
+	EXPECT_EQ(+Tablebases::WIN, wdl);
+	ASSERT_TRUE(tablebases.probeDtz(position, dtz));
+	EXPECT_EQ(1, dtz);
+
+	// Black captures the queen
+	position = notation::toPosition("8/8/8/8/8/8/1k6/1Q5K b - - 0 1");
+	ASSERT_TRUE(tablebases.probeWdl(position, wdl));
+	EXPECT_EQ(+Tablebases::DRAW, wdl);
+
+	// The black rook mates in two moves
+	position = notation::toPosition("8/8/8/8/8/1k6/7r/K7 w - - 0 1");
+	ASSERT_TRUE(tablebases.probeDtz(position, dtz));
+	EXPECT_EQ(-2, dtz);
+	ASSERT_TRUE(tablebases.probeWdl(position, wdl));
+	EXPECT_EQ(+Tablebases::LOSS, wdl);
+
+	std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,74 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "tablebases.h"
+#include "notation.h"
+#include "model/color.h"
+
+#include "gtest/gtest.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace pulse;
+
+namespace {
+const std::string directory = "tablebasestest";
+
+void writeFile(const std::string& name, const std::string& content) {
+	std::ofstream file(directory + "/" + name, std::ios::binary | std::ios::trunc);
+	file << content;
+}
+}
+
+TEST(tablebasestest, testMaterialKey) {
+	Position position = notation::toPosition("8/8/8/4k3/8/8/2Q5/4K3 w - - 0 1");
+	EXPECT_EQ(3, Tablebases::getPieceCount(position));
+	EXPECT_EQ(Tablebases::getMaterialKey("KQvK"), Tablebases::getMaterialKey(position, color::WHITE));
+	EXPECT_EQ(Tablebases::getMaterialKey("KvKQ"), Tablebases::getMaterialKey(position, color::BLACK));
+	EXPECT_NE(Tablebases::getMaterialKey("KQvK"), Tablebases::getMaterialKey("KvKQ"));
+	EXPECT_NE(Tablebases::getMaterialKey("KQvK"), Tablebases::getMaterialKey("KRvK"));
+
+	position = notation::toPosition("8/8/1r6/4k3/8/3P4/2R5/4K3 b - - 0 1");
+	EXPECT_EQ(Tablebases::getMaterialKey("KRPvKR"), Tablebases::getMaterialKey(position, color::WHITE));
+
+	EXPECT_EQ(0u, Tablebases::getMaterialKey("KQK"));
+	EXPECT_EQ(0u, Tablebases::getMaterialKey("KQvKvK"));
+	EXPECT_EQ(0u, Tablebases::getMaterialKey("QvK"));
+	EXPECT_EQ(0u, Tablebases::getMaterialKey("KXvK"));
+}
+
+TEST(tablebasestest, testSetPath) {
+	std::filesystem::create_directory(directory);
+	writeFile("KQvK.rtbw", std::string("\x71\xE8\x23\x5D", 4));
+	writeFile("KQvK.rtbz", std::string("\xD7\x66\x0C\xA5", 4));
+	writeFile("KRvK.ptb", "");
+	writeFile("KRvKN.rtbw", "");
+	writeFile("KRvKN.ptb", "");
+	writeFile("KRvKN.txt", "");
+	writeFile("README.rtbw", "");
+
+	// KQvK and KRvK must not share a material key
+	Tablebases tablebases;
+	tablebases.setPath(directory);
+	EXPECT_EQ(3u, tablebases.getTableCount());
+	EXPECT_EQ(4, tablebases.getMaxPieces());
+
+	// A broken table never answers
+	Position position = notation::toPosition("8/8/8/4k3/8/8/2Q5/4K3 w - - 0 1");
+	int wdl;
+	EXPECT_FALSE(tablebases.probeWdl(position, wdl));
+
+	// Two kings are always a draw
+	position = notation::toPosition("8/8/8/4k3/8/8/8/4K3 w - - 0 1");
+	ASSERT_TRUE(tablebases.probeWdl(position, wdl));
+	EXPECT_EQ(+Tablebases::DRAW, wdl);
+
+	tablebases.setPath("");
+	EXPECT_EQ(0u, tablebases.getTableCount());
+	EXPECT_EQ(0, tablebases.getMaxPieces());
+
+	std::filesystem::remove_all(directory);
+}
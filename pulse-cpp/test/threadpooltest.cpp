@@ -16,3 +16,19 @@ TEST(threadpooltest, test) {
 	});
 	EXPECT_EQ(result.get(), 42);
 }
+
+TEST(threadpooltest, testThreads) {
+	ThreadPool threadPool(4);
+	std::vector<std::future<int>> results;
+	for (int i = 0; i < 100; i++) {
+		results.push_back(threadPool.submit([i] {
+			return i;
+		}));
+	}
+
+	int sum = 0;
+	for (auto& result: results) {
+		sum += result.get();
+	}
+	EXPECT_EQ(4950, sum);
+}
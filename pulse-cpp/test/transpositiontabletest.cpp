@@ -0,0 +1,68 @@
+// Copyright 2013-2023 Phokham Nonava
+//
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "transpositiontable.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace pulse;
+
+TEST(transpositiontabletest, testStoreAndProbe) {
+	TranspositionTable table(1);
+	EXPECT_EQ(65536u, table.getCapacity());
+
+	TranspositionTable::Entry entry;
+	EXPECT_FALSE(table.probe(0x123456789ABCDEF0ULL, entry));
+
+	table.store(0x123456789ABCDEF0ULL, 42, -17, 5, TranspositionTable::EXACT);
+	EXPECT_TRUE(table.probe(0x123456789ABCDEF0ULL, entry));
+	EXPECT_EQ(42, entry.move);
+	EXPECT_EQ(-17, entry.value);
+	EXPECT_EQ(5, entry.depth);
+	EXPECT_EQ(+TranspositionTable::EXACT, entry.bound);
+
+	// Same bucket, different key
+	EXPECT_FALSE(table.probe(0x023456789ABCDEF0ULL, entry));
+
+	table.clear();
+	EXPECT_FALSE(table.probe(0x123456789ABCDEF0ULL, entry));
+}
+
+TEST(transpositiontabletest, testSaveAndMap) {
+	const std::string path = "transpositiontabletest.bin";
+
+	TranspositionTable table(1);
+	table.store(0x123456789ABCDEF0ULL, 42, -17, 5, TranspositionTable::LOWER);
+	table.save(path);
+	{
+		TranspositionTable mapped(path, MappedFile::READONLY);
+		EXPECT_TRUE(mapped.isMapped());
+		EXPECT_EQ(table.getCapacity(), mapped.getCapacity());
+
+		TranspositionTable::Entry entry;
+		EXPECT_TRUE(mapped.probe(0x123456789ABCDEF0ULL, entry));
+		EXPECT_EQ(42, entry.move);
+		EXPECT_EQ(+TranspositionTable::LOWER, entry.bound);
+
+		// Read-only tables ignore stores
+		mapped.store(0x0EDCBA987654321FULL, 1, 2, 3, TranspositionTable::UPPER);
+		EXPECT_FALSE(mapped.probe(0x0EDCBA987654321FULL, entry));
+	}
+	{
+		TranspositionTable mapped(path, MappedFile::COPYONWRITE);
+		TranspositionTable::Entry entry;
+		mapped.store(0x0EDCBA987654321FULL, 1, 2, 3, TranspositionTable::UPPER);
+		EXPECT_TRUE(mapped.probe(0x0EDCBA987654321FULL, entry));
+	}
+	{
+		// Copy-on-write stores never reach the file
+		TranspositionTable mapped(path, MappedFile::READONLY);
+		TranspositionTable::Entry entry;
+		EXPECT_FALSE(mapped.probe(0x0EDCBA987654321FULL, entry));
+	}
+	std::remove(path.c_str());
+}